@@ -0,0 +1,188 @@
+#include <components/biquad.h>
+
+#include <math.h>
+
+#define BUTTERWORTH_Q 0.70710678f
+
+static int32_t biquad_quantize(double coeff)
+{
+    double scaled = round(coeff * (1 << BIQUAD_COEFF_BITS));
+
+    if (scaled > INT32_MAX)
+        scaled = INT32_MAX;
+    else if (scaled < INT32_MIN)
+        scaled = INT32_MIN;
+
+    return (int32_t)scaled;
+}
+
+// Shared tail of the RBJ cookbook designs: divide through by a0 and quantize
+static void biquad_set(struct biquad_t *bq,
+                       double b0, double b1, double b2,
+                       double a0, double a1, double a2)
+{
+    bq->b0 = biquad_quantize(b0 / a0);
+    bq->b1 = biquad_quantize(b1 / a0);
+    bq->b2 = biquad_quantize(b2 / a0);
+    bq->a1 = biquad_quantize(a1 / a0);
+    bq->a2 = biquad_quantize(a2 / a0);
+}
+
+// c * v / 2^(16 + shift), rounded, from the coefficient's two halves: the
+// M0+ only keeps the low 32 bits of a product, and |v| <= 2^15 keeps each
+// half's below 2^31. Rounding rather than truncating matters: a bias of a
+// fraction of a step is amplified by the DC gain of poles near z = 1
+static inline int32_t biquad_mul(int32_t c, int32_t v, int shift)
+{
+    const int32_t product = (c >> 16) * v + (((c & 0xFFFF) * v + (1 << 15)) >> 16);
+    return (product + ((1 << shift) >> 1)) >> shift;
+}
+
+void biquad_design_lowpass(struct biquad_t *bq, float cutoff_hz, float q)
+{
+    const double w0 = 2.0 * M_PI * cutoff_hz / SAMPLE_RATE_HZ;
+    const double cos_w0 = cos(w0);
+    const double alpha = sin(w0) / (2.0 * q);
+
+    biquad_set(bq,
+               (1.0 - cos_w0) / 2.0, 1.0 - cos_w0, (1.0 - cos_w0) / 2.0,
+               1.0 + alpha, -2.0 * cos_w0, 1.0 - alpha);
+}
+
+void biquad_design_highpass(struct biquad_t *bq, float cutoff_hz, float q)
+{
+    const double w0 = 2.0 * M_PI * cutoff_hz / SAMPLE_RATE_HZ;
+    const double cos_w0 = cos(w0);
+    const double alpha = sin(w0) / (2.0 * q);
+
+    biquad_set(bq,
+               (1.0 + cos_w0) / 2.0, -(1.0 + cos_w0), (1.0 + cos_w0) / 2.0,
+               1.0 + alpha, -2.0 * cos_w0, 1.0 - alpha);
+}
+
+void biquad_design_bandpass(struct biquad_t *bq, float center_hz, float q)
+{
+    // Constant 0 dB peak gain variant
+    const double w0 = 2.0 * M_PI * center_hz / SAMPLE_RATE_HZ;
+    const double cos_w0 = cos(w0);
+    const double alpha = sin(w0) / (2.0 * q);
+
+    biquad_set(bq,
+               alpha, 0.0, -alpha,
+               1.0 + alpha, -2.0 * cos_w0, 1.0 - alpha);
+}
+
+void biquad_cascade_init(struct biquad_cascade_t *cascade)
+{
+    cascade->num_stages = 0;
+    biquad_cascade_reset(cascade);
+}
+
+void biquad_cascade_init_band(struct biquad_cascade_t *cascade, float low_hz, float high_hz)
+{
+    struct biquad_t bq;
+
+    biquad_cascade_init(cascade);
+
+    // A corner at or beyond the band edges disables that side
+    if (low_hz > 0.0f)
+    {
+        biquad_design_highpass(&bq, low_hz, BUTTERWORTH_Q);
+        biquad_cascade_push(cascade, &bq);
+    }
+
+    if (high_hz > 0.0f && high_hz < SAMPLE_RATE_HZ / 2)
+    {
+        biquad_design_lowpass(&bq, high_hz, BUTTERWORTH_Q);
+        biquad_cascade_push(cascade, &bq);
+    }
+}
+
+bool biquad_cascade_push(struct biquad_cascade_t *cascade, const struct biquad_t *bq)
+{
+    if (cascade->num_stages >= BIQUAD_MAX_STAGES)
+        return false;
+
+    cascade->stages[cascade->num_stages] = *bq;
+    cascade->z1[cascade->num_stages] = 0;
+    cascade->z2[cascade->num_stages] = 0;
+    cascade->num_stages++;
+
+    return true;
+}
+
+void biquad_cascade_reset(struct biquad_cascade_t *cascade)
+{
+    for (int i = 0; i < BIQUAD_MAX_STAGES; i++)
+    {
+        cascade->z1[i] = 0;
+        cascade->z2[i] = 0;
+    }
+}
+
+void biquad_cascade_process(struct biquad_cascade_t *cascade, struct buffer_t *buf)
+{
+    biquad_cascade_filter(cascade, buf->buffer, buf->size);
+}
+
+void biquad_cascade_filter(struct biquad_cascade_t *cascade, sample_t *samples, int count)
+{
+    // Run the whole block through one section at a time so the
+    // coefficients and state stay in registers.
+    //
+    // The sums are kept in Q14 of the sample scale shifted down by
+    // BIQUAD_HEADROOM_BITS. Every coefficient is below 2 in magnitude
+    // (2^15 in Q14), so a product with a full-scale sample (2^15) is below
+    // 2^28 at that scale. The fed-back output y is kept at the reduced
+    // scale, |y| <= BIQUAD_SIGNAL_MAX (2^14), so its products are below
+    // 2^29: z2 stays below 1.5 * 2^29, z1 below 1.5 * 2^30 and the output
+    // sum below 1.75 * 2^30; the residue terms add less than 2^14 to
+    // either state. The input and the stored output keep all 16 bits.
+    for (int stage = 0; stage < cascade->num_stages; stage++)
+    {
+        const int32_t b0 = cascade->stages[stage].b0;
+        const int32_t b1 = cascade->stages[stage].b1;
+        const int32_t b2 = cascade->stages[stage].b2;
+        const int32_t a1 = cascade->stages[stage].a1;
+        const int32_t a2 = cascade->stages[stage].a2;
+
+        int32_t z1 = cascade->z1[stage];
+        int32_t z2 = cascade->z2[stage];
+
+        for (int i = 0; i < count; i++)
+        {
+            const int32_t x = samples[i];
+
+            const int32_t acc = biquad_mul(b0, x, BIQUAD_HEADROOM_BITS) + z1;
+            int32_t y = (acc + (1 << (BIQUAD_ACC_BITS - 1))) >> BIQUAD_ACC_BITS;
+
+            // Rounding residue of y, fed back with the poles so the recursion
+            // keeps full state precision (poles near z = 1 amplify it otherwise)
+            const int32_t e = acc - y * (1 << BIQUAD_ACC_BITS);
+
+            // The stored output is rounded from acc at full scale
+            int32_t out = (acc + (1 << (BIQUAD_ACC_BITS - BIQUAD_HEADROOM_BITS - 1))) >>
+                          (BIQUAD_ACC_BITS - BIQUAD_HEADROOM_BITS);
+
+            if (y > BIQUAD_SIGNAL_MAX)
+                y = BIQUAD_SIGNAL_MAX;
+            else if (y < -BIQUAD_SIGNAL_MAX)
+                y = -BIQUAD_SIGNAL_MAX;
+
+            if (out > INT16_MAX)
+                out = INT16_MAX;
+            else if (out < INT16_MIN)
+                out = INT16_MIN;
+
+            z1 = biquad_mul(b1, x, BIQUAD_HEADROOM_BITS) - biquad_mul(a1, y, 0) + z2 -
+                 biquad_mul(a1, e, BIQUAD_ACC_BITS);
+            z2 = biquad_mul(b2, x, BIQUAD_HEADROOM_BITS) - biquad_mul(a2, y, 0) -
+                 biquad_mul(a2, e, BIQUAD_ACC_BITS);
+
+            samples[i] = (sample_t)out;
+        }
+
+        cascade->z1[stage] = z1;
+        cascade->z2[stage] = z2;
+    }
+}
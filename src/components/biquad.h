@@ -0,0 +1,57 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+
+#define BIQUAD_MAX_STAGES 4
+
+// Coefficients are Q2.30: a1 of a stable section approaches -2 at low
+// corners, so it needs two integer bits, and below a few hundred hertz
+// 1 + a1 + a2 is smaller than a Q2.14 step, which moves the poles by
+// decibels. Products are formed from the coefficient's 16-bit halves
+// (biquad_mul), so the M0+ needs no 64-bit multiply
+#define BIQUAD_COEFF_BITS 30
+
+// Fraction bits of the filter's sums, which biquad_mul leaves at Q14
+#define BIQUAD_ACC_BITS (BIQUAD_COEFF_BITS - 16)
+
+// Products and the fed-back output are scaled down by this much inside
+// the cascade so that every intermediate sum of a stable section provably
+// fits in 32 bits
+#define BIQUAD_HEADROOM_BITS 2
+
+// The fed-back output may reach twice full scale before it is clamped, so
+// a section overshooting on full-scale input keeps its exact state while
+// the stored output saturates
+#define BIQUAD_SIGNAL_MAX ((2 * INT16_MAX + 1) >> BIQUAD_HEADROOM_BITS)
+
+struct biquad_t
+{
+    // Normalized so that a0 == 1
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+};
+
+struct biquad_cascade_t
+{
+    int num_stages;
+    struct biquad_t stages[BIQUAD_MAX_STAGES];
+
+    // Direct-form-II-transposed state, carried from one block to the next
+    int32_t z1[BIQUAD_MAX_STAGES];
+    int32_t z2[BIQUAD_MAX_STAGES];
+};
+
+void biquad_design_lowpass(struct biquad_t *bq, float cutoff_hz, float q);
+void biquad_design_highpass(struct biquad_t *bq, float cutoff_hz, float q);
+void biquad_design_bandpass(struct biquad_t *bq, float center_hz, float q);
+
+void biquad_cascade_init(struct biquad_cascade_t *cascade);
+void biquad_cascade_init_band(struct biquad_cascade_t *cascade, float low_hz, float high_hz);
+bool biquad_cascade_push(struct biquad_cascade_t *cascade, const struct biquad_t *bq);
+void biquad_cascade_reset(struct biquad_cascade_t *cascade);
+
+void biquad_cascade_process(struct biquad_cascade_t *cascade, struct buffer_t *buf);
+
+// Same on a bare block, for streams that never form a frame
+void biquad_cascade_filter(struct biquad_cascade_t *cascade, sample_t *samples, int count);
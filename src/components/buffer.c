@@ -1,25 +1,78 @@
 #include <components/buffer.h>
 #include <components/window_function.h>
+#include <components/dot_product.h>
+
+#include <assert.h>
+
+// buffer_window_onset keeps the onset itself inside the gated span
+static_assert(ONSET_PRE_SAMPLES <= ONSET_SPAN_SAMPLES, "onset window starts too far ahead of its span");
 
 void buffer_window(struct buffer_t *buf)
 {
-    for (int i = 0; i < BUFFER_SIZE; i++)
+    for (int i = 0; i < buf->size; i++)
     {
-        int32_t tmp = (int32_t)buf->buffer[i] * WINDOW_FUNCTION[i << (10 - BUFFER_SIZE_BITS)];
+        // Stretch or decimate the fixed table to the current frame length
+        const int w = (i << WINDOW_FUNCTION_SIZE_BITS) >> buf->size_bits;
+        int32_t tmp = (int32_t)buf->buffer[i] * WINDOW_FUNCTION[w];
         buf->buffer[i] = (int16_t)(tmp >> 15);
     }
+
+    buf->start = 0;
+    buf->end = buf->size;
+}
+
+void buffer_window_onset(struct buffer_t *buf, int onset, int pre_samples, int span)
+{
+    const int half = 1 << (WINDOW_FUNCTION_SIZE_BITS - 1);
+
+    // No onset: nothing to gate on, so keep the whole frame
+    if (onset < 0)
+    {
+        buffer_window(buf);
+        return;
+    }
+
+    int start = onset - pre_samples;
+    if (start < 0)
+        start = 0;
+
+    int end = start + span;
+    if (end > buf->size)
+        end = buf->size;
+
+    const int rise = onset - start;
+    const int fall = end - onset;
+
+    for (int i = 0; i < start; i++)
+        buf->buffer[i] = 0;
+
+    // Short rising half of the window up to the onset, then a long
+    // falling half over the direct path and early reflections
+    for (int i = start; i < end; i++)
+    {
+        const int w = (i < onset ? ((i - start) * half) / rise
+                                 : half + ((i - onset) * half) / fall);
+        int32_t tmp = (int32_t)buf->buffer[i] * WINDOW_FUNCTION[w];
+        buf->buffer[i] = (int16_t)(tmp >> 15);
+    }
+
+    for (int i = end; i < buf->size; i++)
+        buf->buffer[i] = 0;
+
+    buf->start = start;
+    buf->end = end;
 }
 
 void buffer_normalize_range(struct buffer_t *buf)
 {
-    for (int i = 0; i < BUFFER_SIZE; i++)
+    for (int i = 0; i < buf->size; i++)
         buf->buffer[i] <<= 8;
 
     return;
 
     int32_t max = INT16_MIN;
 
-    for (int i = 0; i < BUFFER_SIZE; i++)
+    for (int i = 0; i < buf->size; i++)
     {
         int32_t sample = buf->buffer[i];
         sample = (sample < 0 ? -sample : sample);
@@ -31,7 +84,7 @@ void buffer_normalize_range(struct buffer_t *buf)
     if (max > 0)
     {
         int64_t scale = ((int64_t)INT16_MAX << 15) / max;
-        for (int i = 0; i < BUFFER_SIZE; i++)
+        for (int i = 0; i < buf->size; i++)
         {
             int64_t tmp = ((int64_t)buf->buffer[i] * scale) >> 15;
             if (tmp > INT16_MAX)
@@ -43,7 +96,69 @@ void buffer_normalize_range(struct buffer_t *buf)
     }
     else
     {
-        for (int i = 0; i < BUFFER_SIZE; i++)
+        for (int i = 0; i < buf->size; i++)
             buf->buffer[i] = 0;
     }
 }
+
+int buffer_find_onset(const struct buffer_t *const bufs[], int num_bufs)
+{
+    const int size = bufs[0]->size;
+
+    int32_t peak = 0;
+    for (int b = 0; b < num_bufs; b++)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            int32_t sample = bufs[b]->buffer[i];
+            sample = (sample < 0 ? -sample : sample);
+
+            if (sample > peak)
+                peak = sample;
+        }
+    }
+
+    // Earliest sample on any channel within 12 dB of the frame peak
+    const int32_t threshold = peak >> 2;
+    int onset = size;
+    for (int b = 0; b < num_bufs; b++)
+    {
+        for (int i = 0; i < onset; i++)
+        {
+            int32_t sample = bufs[b]->buffer[i];
+            sample = (sample < 0 ? -sample : sample);
+
+            if (sample > threshold)
+            {
+                onset = i;
+                break;
+            }
+        }
+    }
+
+    return (onset < size ? onset : -1);
+}
+
+int32_t buffer_peak(const struct buffer_t *buf)
+{
+    int32_t peak = 0;
+
+    for (int i = buf->start; i < buf->end; i++)
+    {
+        int32_t sample = buf->buffer[i];
+        sample = (sample < 0 ? -sample : sample);
+
+        if (sample > peak)
+            peak = sample;
+    }
+
+    return peak;
+}
+
+power_t buffer_energy(const struct buffer_t *buf)
+{
+    const int32_t peak = buffer_peak(buf);
+    const sample_t *x = buf->buffer + buf->start;
+
+    return dot_product(x, x, buf->end - buf->start, dot_product_headroom(peak, peak));
+}
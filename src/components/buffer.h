@@ -2,14 +2,38 @@
 
 #include <components/constants.h>
 
-#define BUFFER_SIZE_BITS 10
-#define BUFFER_SIZE (1 << BUFFER_SIZE_BITS)
+// Frame length is chosen at runtime between these bounds; storage is
+// always sized for the largest frame
+#define BUFFER_MIN_SIZE_BITS 8
+#define BUFFER_MAX_SIZE_BITS 12
+#define BUFFER_DEFAULT_SIZE_BITS 10
+#define BUFFER_MAX_SIZE (1 << BUFFER_MAX_SIZE_BITS)
 
 struct buffer_t
 {
-    sample_t buffer[BUFFER_SIZE];
+    int size_bits;
+    int size;
+
+    // Samples outside [start, end) are known to be zero
+    int start;
+    int end;
+
+    sample_t buffer[BUFFER_MAX_SIZE];
     power_t power;
 };
 
 void buffer_window(struct buffer_t *buf);
+// Keeps span samples from pre_samples before onset, tapered, and zeroes
+// the rest; the whole frame with buffer_window when onset is negative
+void buffer_window_onset(struct buffer_t *buf, int onset, int pre_samples, int span);
 void buffer_normalize_range(struct buffer_t *buf);
+
+// Largest magnitude inside the active span
+int32_t buffer_peak(const struct buffer_t *buf);
+
+// Sum of squares over the active span
+power_t buffer_energy(const struct buffer_t *buf);
+
+// Earliest sample on any channel within 12 dB of the frames' peak; -1 for
+// silent frames
+int buffer_find_onset(const struct buffer_t *const bufs[], int num_bufs);
@@ -5,18 +5,166 @@
 
 typedef int64_t power_t;
 typedef int16_t sample_t;
+typedef uint8_t raw_sample_t;
 
 // Audio sampling
 #define SAMPLE_RATE_HZ 50000 // 50 kHz sample rate
 #define SAMPLE_PERIOD_US (1000000 / SAMPLE_RATE_HZ)
-#define MAX_SHIFT_SAMPLES (SAMPLE_RATE_HZ * 32 / 34300)
 // Physical constants
 #define SPEED_OF_SOUND_MPS 343.0f // m/s
+#define SPEED_OF_SOUND_MMPS 343000 // mm/s
 
-// Geometry (meters)
-#define MIC_DIST_AB_M 0.132f   // Mic A ↔ B
-#define MIC_DIST_BC_M 0.15f // Mic B ↔ C
-#define MIC_DIST_CA_M 0.20f // Mic C ↔ A
+// Geometry (millimetres, so lag bounds stay integer constants)
+#define MIC_DIST_AB_MM 132 // Mic A ↔ B
+#define MIC_DIST_BC_MM 150 // Mic B ↔ C
+#define MIC_DIST_CA_MM 200 // Mic C ↔ A
+#define MIC_DIST_AB_M (MIC_DIST_AB_MM / 1000.0f)
+#define MIC_DIST_BC_M (MIC_DIST_BC_MM / 1000.0f)
+#define MIC_DIST_CA_M (MIC_DIST_CA_MM / 1000.0f)
+
+// Each pair only searches the lags sound can take to cross it, rounded up,
+// plus CORRELATION_LAG_MARGIN_SAMPLES for placement error
+#define CORRELATION_LAG_MARGIN_SAMPLES 2
+#define PAIR_MAX_SHIFT_SAMPLES(dist_mm) \
+    ((SAMPLE_RATE_HZ * (dist_mm) + SPEED_OF_SOUND_MMPS - 1) / SPEED_OF_SOUND_MMPS + CORRELATION_LAG_MARGIN_SAMPLES)
+#define MAX_SHIFT_AB_SAMPLES PAIR_MAX_SHIFT_SAMPLES(MIC_DIST_AB_MM)
+#define MAX_SHIFT_AC_SAMPLES PAIR_MAX_SHIFT_SAMPLES(MIC_DIST_CA_MM)
+#define MAX_SHIFT_BC_SAMPLES PAIR_MAX_SHIFT_SAMPLES(MIC_DIST_BC_MM)
+
+// The widest pair's range sizes the correlation storage
+#define MAX_SHIFT_MAX2(a, b) ((a) > (b) ? (a) : (b))
+#define MAX_SHIFT_SAMPLES \
+    MAX_SHIFT_MAX2(MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_MAX2(MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES))
+
+// Band-pass pre-filter corners (0 disables that side). Off by default;
+// 300 Hz and 8000 Hz keep the band claps and voices carry. Corners down
+// to 100 Hz stay within 2 LSB of an exact filter
+#define PREFILTER_HIGHPASS_HZ 0.0f
+#define PREFILTER_LOWPASS_HZ 0.0f
+
+// LPC pre-whitening model order (0 disables it). Off by default: order 4
+// halves the peak width of resonant sources on the unweighted engines and
+// resolves close reflections at high SNR, but it lifts the background
+// noise along with the source and loses accuracy below about 20 dB
+#define PREWHITEN_LPC_ORDER 0
+
+// Spectral subtraction of stationary background noise, relearned from an
+// untriggered frame every SPECTRAL_NOISE_INTERVAL_US
+#define SPECTRAL_SUBTRACTION false
+#define SPECTRAL_NOISE_INTERVAL_US 1000000
+
+// Onset-gated analysis window: correlate only ONSET_SPAN_SAMPLES starting
+// ONSET_PRE_SAMPLES before the detected onset, dropping the reverberant tail
+#define ONSET_GATED_WINDOW false
+#define ONSET_PRE_SAMPLES 32
+#define ONSET_SPAN_SAMPLES 256
+
+// Cross-correlation engine: direct lag loop, or fixed-point FFT whose cost
+// does not grow with the lag range
+#define CORRELATION_ENGINE_DIRECT 0
+#define CORRELATION_ENGINE_FFT 1
+#define CORRELATION_ENGINE CORRELATION_ENGINE_FFT
+
+// Direct engine only: find the peak on 4x decimated copies first and
+// compute full-rate lags just around it
+#define CORRELATION_COARSE_TO_FINE true
+
+// Direct engine only, where coarse-to-fine is off or gives up: find the
+// exact best shift by branch and bound, abandoning lags whose energy
+// bound shows they cannot win. Lags given up early hold that bound,
+// marked as estimates
+#define CORRELATION_PRUNED_SEARCH false
+
+// Correlate only the samples' signs, a bit each, and fall back to the
+// full engine unless every pair's peak-to-sidelobe ratio (Q8) reaches
+// SIGN_CORRELATION_MIN_PSR_Q8. Pays off for clear impulsive events that
+// fill the window, so best with ONSET_GATED_WINDOW; needs GCC_WEIGHTING_NONE
+#define SIGN_CORRELATION false
+#define SIGN_CORRELATION_MIN_PSR_Q8 (8 * 256)
+
+// Window whole frames, and correlate them on the direct engine with the
+// C++ kernels of dsp_core.hpp specialised per frame length and pair range.
+// Off until measured to beat the C sweep on the device at full-scale
+// samples, whose headroom is only 1 or 2
+#define DSP_CORE_TEMPLATES false
+
+// Spread the pair correlations over both RP2040 cores. The direct
+// engine splits each pair's lags between the cores, except under
+// CORRELATION_COARSE_TO_FINE, CORRELATION_PRUNED_SEARCH or
+// DSP_CORE_TEMPLATES, where each core takes whole pairs
+#define DUAL_CORE_CORRELATION true
+
+// Generalized cross-correlation weighting of the cross-spectrum (FFT engine
+// only): phase transform, smoothed coherence transform (1 / sqrt(Saa Sbb)
+// with the auto-spectra averaged over bands of four bins), or maximum
+// likelihood from the per-band coherence
+#define GCC_WEIGHTING_NONE 0
+#define GCC_WEIGHTING_PHAT 1
+#define GCC_WEIGHTING_SCOT 2
+#define GCC_WEIGHTING_ML 3
+#define GCC_WEIGHTING GCC_WEIGHTING_PHAT
+
+// Weighted peaks are sharp enough to need neither the Gaussian prior
+// around the best shift nor a long running average
+#define CORRELATION_PRIOR (GCC_WEIGHTING == GCC_WEIGHTING_NONE)
+#define CORRELATION_AVERAGE_TAU_S (GCC_WEIGHTING == GCC_WEIGHTING_NONE ? 0.5f : 0.15f)
+
+// A frame arriving this long after the last one restarts the average
+#define CORRELATION_AVERAGE_RESET_S (5 * CORRELATION_AVERAGE_TAU_S)
+#define CORRELATION_AVERAGE_RESET_US ((uint32_t)(CORRELATION_AVERAGE_RESET_S * 1e6f))
+
+// FFT engine only: average each pair's cross-spectrum over frames,
+// forgetting 2^-CROSS_SPECTRUM_FORGET_BITS of it per frame, and correlate
+// the average instead of the frame. Stationary sources get the SNR of
+// many frames for one inverse transform per pair, on core 0; needs
+// GCC_WEIGHTING NONE or PHAT. Costs about 24 KB
+#define CROSS_SPECTRUM_AVERAGING false
+#define CROSS_SPECTRUM_FORGET_BITS 3
+
+// The prior scales the lag d away from the best shift by
+// exp(-(d / CORRELATION_PRIOR_WIDTH_SAMPLES)^2)
+#define CORRELATION_PRIOR_WIDTH_SAMPLES 6.0f
+
+// Continuous-source mode: instead of triggered frames, keep a sliding
+// window correlation up to date every STREAMING_BLOCK_SIZE samples and
+// redraw at most every STREAMING_DISPLAY_INTERVAL_US. Core 1 processes
+// each block while core 0 samples the next, so a block's work must fit
+// in STREAMING_BLOCK_SIZE sample periods; blocks that overrun restart the
+// sampling clock and are counted over stdio. Costs about 8 KB
+#define STREAMING_CORRELATION false
+#define STREAMING_BLOCK_SIZE 64
+#define STREAMING_DISPLAY_INTERVAL_US 100000
+
+// Streaming only: sum each block's products once with dot_product and
+// keep those lag sums until the block leaves the window, dropping them
+// with one subtraction per lag rather than recomputing them. Needs a
+// power-of-two STREAMING_BLOCK_SIZE; costs about 19 KB more, so off
+// until the saving is measured on the device
+#define STREAMING_OVERLAP_SAVE false
+
+// Choose the three pair shifts together, keeping shift_ab + shift_bc =
+// shift_ac and only lag pairs the geometry allows, with a tolerance of
+// JOINT_LAG_MARGIN_SAMPLES for near sources and mic placement
+#define JOINT_LAG_SEARCH true
+#define JOINT_LAG_MARGIN_SAMPLES 2
+
+// Peaks listed per pair, at least CORRELATION_PEAK_SEPARATION lags apart;
+// the main peak's sidelobes are the lags outside that distance. Frames
+// whose pairs' peak-to-sidelobe ratio (Q8) at the chosen shift is below
+// CORRELATION_MIN_PSR_Q8 are neither averaged nor drawn; 0 keeps every
+// frame, the default until a threshold is measured on the device
+#define CORRELATION_MAX_PEAKS 3
+#define CORRELATION_PEAK_SEPARATION 4
+#define CORRELATION_MIN_PSR_Q8 0
+
+// Sub-sample refinement of the correlation peak: a parabola through the
+// peak and its neighbours, the same on log values (exact for a Gaussian
+// peak), or the maximum of the windowed-sinc reconstruction
+#define PEAK_INTERPOLATION_NONE 0
+#define PEAK_INTERPOLATION_PARABOLIC 1
+#define PEAK_INTERPOLATION_GAUSSIAN 2
+#define PEAK_INTERPOLATION_SINC 3
+#define PEAK_INTERPOLATION PEAK_INTERPOLATION_GAUSSIAN
 
 // ADC channels (GPIO26→ADC0, 27→ADC1, 28→ADC2)
 #define MIC_A_ADC_CH 0
@@ -1,63 +1,894 @@
 #include <components/correlations.h>
+#include <components/correlations_simd.h>
+#include <components/dot_product.h>
+#include <components/fixed_math.h>
 #include <math.h>
 
-void correlations_init(struct correlations_t *corr,
-                       const struct buffer_t *buf_a,
-                       const struct buffer_t *buf_b) {
-  power_t best_score = INT64_MIN;
+// Coarse-to-fine search: correlate copies decimated by COARSE_DECIMATION
+// over the whole lag range, then compute full-rate lags only within
+// COARSE_REFINE_RADIUS of the best coarse peaks
+#define COARSE_DECIMATION_BITS 2
+#define COARSE_DECIMATION (1 << COARSE_DECIMATION_BITS)
+#define COARSE_MAX_SHIFT ((MAX_SHIFT_SAMPLES + COARSE_DECIMATION - 1) >> COARSE_DECIMATION_BITS)
+#define COARSE_BUFFER_SIZE (2 * COARSE_MAX_SHIFT + 1)
+#define COARSE_REFINE_RADIUS (COARSE_DECIMATION - 1)
+
+// A second coarse peak at least this high relative to the best (Q8) is
+// refined as well; a third one makes the coarse result ambiguous
+#define COARSE_CANDIDATE_Q8 128
+
+struct coarse_buffer_t {
+  int start;
+  int end;
+  sample_t buffer[BUFFER_MAX_SIZE >> COARSE_DECIMATION_BITS];
+};
+
+// Gaussian prior by distance from the best shift, Q15
+static uint16_t correlation_prior_q15[CORRELATION_BUFFER_SIZE];
+
+// Running-average blend weight 1 - exp(-dt / tau) in Q16 at dt = i steps
+// of 2^average_step_bits us, up to the reset gap; linear in between
+#define AVERAGE_STEPS 256
+static uint32_t average_decay_q16[AVERAGE_STEPS + 1];
+static int average_step_bits;
+
+// Pruned search: lag sums are built CHUNK samples at a time and checked
+// against the best so far between chunks
+#define PRUNE_CHUNK_BITS 5
+#define PRUNE_CHUNKS ((BUFFER_MAX_SIZE >> PRUNE_CHUNK_BITS) + 1)
+
+// Work room of correlations_init, one per core so both can search
+// different pairs at once
+struct search_scratch_t {
+  struct coarse_buffer_t coarse_a;
+  struct coarse_buffer_t coarse_b;
+
+  // Rounded-up square roots of each channel's energy from every chunk
+  // boundary to the end of its span
+  uint32_t prune_root_a[PRUNE_CHUNKS];
+  uint32_t prune_root_b[PRUNE_CHUNKS];
+};
+
+static struct search_scratch_t search_scratch[2];
+
+
+// Peak interpolation works on the correlations around the peak scaled
+// to within +-2^INTERP_VALUE_BITS, so sinc taps sum inside 32 bits
+#define INTERP_VALUE_BITS 14
+#define INTERP_SINC_RADIUS 3
+#define INTERP_SINC_TAPS (2 * INTERP_SINC_RADIUS + 1)
+#define INTERP_SINC_PHASES_BITS 4
+#define INTERP_SINC_PHASES (1 << INTERP_SINC_PHASES_BITS)
+
+// Hann-windowed sinc over +-3 samples in Q15, normalised to unit gain,
+// for offsets -1/2, -7/16 .. +1/2 from the integer peak
+static const int16_t INTERP_SINC[INTERP_SINC_PHASES + 1][INTERP_SINC_TAPS] = {
+    {281, -3502, 19604, 19604, -3502, 281, 0},
+    {207, -3081, 16770, 22332, -3817, 356, 0},
+    {141, -2594, 13912, 24873, -3986, 422, 0},
+    {86, -2079, 11106, 27155, -3969, 468, 0},
+    {46, -1568, 8426, 29109, -3728, 482, 0},
+    {20, -1087, 5932, 30683, -3232, 452, 0},
+    {6, -658, 3674, 31833, -2456, 368, 0},
+    {1, -293, 1689, 32533, -1382, 219, 0},
+    {0, 0, 0, 32767, 0, 0, 0},
+    {0, 219, -1382, 32533, 1689, -293, 1},
+    {0, 368, -2456, 31833, 3674, -658, 6},
+    {0, 452, -3232, 30683, 5932, -1087, 20},
+    {0, 482, -3728, 29109, 8426, -1568, 46},
+    {0, 468, -3969, 27155, 11106, -2079, 86},
+    {0, 422, -3986, 24873, 13912, -2594, 141},
+    {0, 356, -3817, 22332, 16770, -3081, 207},
+    {0, 281, -3502, 19604, 19604, -3502, 281},
+};
+
+// Vertex of the parabola through (-1, ym), (0, y0), (1, yp) in Q8,
+// within +-1/2 when y0 is the largest
+static int parabola_vertex_q8(int32_t ym, int32_t y0, int32_t yp) {
+  const int32_t curvature = ym - 2 * y0 + yp;
+  if (curvature >= 0)
+    return 0;
+
+  int32_t vertex = ((ym - yp) * 128) / curvature;
+  return (vertex > 128 ? 128 : vertex < -128 ? -128 : vertex);
+}
+
+// Copies the correlations within +-INTERP_SINC_RADIUS of the peak, scaled
+// down to INTERP_VALUE_BITS; lags past the ends read as the edge value
+static void correlations_interp_values(const struct correlations_t *corr,
+                                       int32_t values[INTERP_SINC_TAPS]) {
+  power_t raw[INTERP_SINC_TAPS];
+  power_t peak = 0;
+
+  for (int k = 0; k < INTERP_SINC_TAPS; k++) {
+    int s = corr->best_shift + k - INTERP_SINC_RADIUS;
+    s = (s < -corr->max_shift ? -corr->max_shift : s > corr->max_shift ? corr->max_shift : s);
+
+    raw[k] = corr->correlations[s + MAX_SHIFT_SAMPLES];
+
+    const power_t magnitude = (raw[k] < 0 ? -raw[k] : raw[k]);
+    if (magnitude > peak)
+      peak = magnitude;
+  }
+
+  int shift = 0;
+  while ((peak >> shift) >= ((power_t)1 << INTERP_VALUE_BITS))
+    shift++;
+
+  for (int k = 0; k < INTERP_SINC_TAPS; k++)
+    values[k] = (int32_t)(raw[k] >> shift);
+}
+
+// Offset of the peak of the windowed-sinc reconstruction from the
+// integer peak, Q8: best of INTERP_SINC_PHASES + 1 offsets, then a
+// parabola between the neighbouring offsets
+static int sinc_peak_q8(const int32_t values[INTERP_SINC_TAPS]) {
+  int32_t curve[INTERP_SINC_PHASES + 1];
+  int best = 0;
+
+  for (int j = 0; j <= INTERP_SINC_PHASES; j++) {
+    int32_t acc = 0;
+    for (int k = 0; k < INTERP_SINC_TAPS; k++)
+      acc += values[k] * INTERP_SINC[j][k];
+
+    // Leaves room for the parabola's products
+    curve[j] = acc >> 8;
+    if (curve[j] > curve[best])
+      best = j;
+  }
 
-  for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++) {
-    power_t score = 0;
-    const sample_t *p = (s < 0 ? buf_a->buffer - s : buf_a->buffer);
-    const sample_t *q = (s < 0 ? buf_b->buffer : buf_b->buffer + s);
-    int n = BUFFER_SIZE - (s < 0 ? -s : s);
+  int offset = (best - INTERP_SINC_PHASES / 2) * (256 >> INTERP_SINC_PHASES_BITS);
+  if (best > 0 && best < INTERP_SINC_PHASES)
+    offset += parabola_vertex_q8(curve[best - 1], curve[best], curve[best + 1]) >> INTERP_SINC_PHASES_BITS;
 
-    for (int i = 0; i < n; i++, p++, q++)
-      score += (int32_t)(*p) * (int32_t)(*q);
+  return offset;
+}
+
+// Sets best_shift_q8 from best_shift and the correlations around it
+static void correlations_interpolate(struct correlations_t *corr) {
+  corr->best_shift_q8 = corr->best_shift * 256;
+
+  if (PEAK_INTERPOLATION == PEAK_INTERPOLATION_NONE ||
+      corr->best_shift == -corr->max_shift ||
+      corr->best_shift == corr->max_shift)
+    return;
+
+  int32_t values[INTERP_SINC_TAPS];
+  correlations_interp_values(corr, values);
+
+  const int32_t ym = values[INTERP_SINC_RADIUS - 1];
+  const int32_t y0 = values[INTERP_SINC_RADIUS];
+  const int32_t yp = values[INTERP_SINC_RADIUS + 1];
+
+  int offset;
+  if (PEAK_INTERPOLATION == PEAK_INTERPOLATION_SINC)
+    offset = sinc_peak_q8(values);
+  else if (PEAK_INTERPOLATION == PEAK_INTERPOLATION_GAUSSIAN && ym > 0 && yp > 0)
+    offset = parabola_vertex_q8(fixed_log2_q16(ym), fixed_log2_q16(y0), fixed_log2_q16(yp));
+  else
+    offset = parabola_vertex_q8(ym, y0, yp);
+
+  corr->best_shift_q8 += offset;
+}
+
+// Peak-to-sidelobe statistics square the correlations after scaling them
+// below 2^PSR_VALUE_BITS, which keeps the sum of squares inside 64 bits
+#define PSR_VALUE_BITS 24
+
+static void correlations_find_peaks(struct correlations_t *corr) {
+  const int first = MAX_SHIFT_SAMPLES - corr->max_shift;
+  const int last = MAX_SHIFT_SAMPLES + corr->max_shift;
+
+  bool suppressed[CORRELATION_BUFFER_SIZE];
+  for (int i = first; i <= last; i++)
+    suppressed[i] = false;
+
+  // Greedy non-maximum suppression over local maxima
+  corr->num_peaks = 0;
+  while (corr->num_peaks < CORRELATION_MAX_PEAKS) {
+    int best = -1;
+
+    for (int i = first; i <= last; i++) {
+      const power_t value = corr->correlations[i];
+
+      if (suppressed[i] || corr->estimated[i] ||
+          (i > first && corr->correlations[i - 1] > value) ||
+          (i < last && corr->correlations[i + 1] > value))
+        continue;
+
+      if (best < 0 || value > corr->correlations[best])
+        best = i;
+    }
+
+    if (best < 0)
+      break;
+
+    corr->peaks[corr->num_peaks].shift = best - MAX_SHIFT_SAMPLES;
+    corr->peaks[corr->num_peaks].height = corr->correlations[best];
+    corr->num_peaks++;
+
+    const int lo = (best - CORRELATION_PEAK_SEPARATION > first ? best - CORRELATION_PEAK_SEPARATION : first);
+    const int hi = (best + CORRELATION_PEAK_SEPARATION < last ? best + CORRELATION_PEAK_SEPARATION : last);
+    for (int i = lo; i <= hi; i++)
+      suppressed[i] = true;
+  }
+}
+
+// Peak-to-sidelobe ratio and height at the best shift, wherever it was
+// chosen; an estimated lag has neither
+static void correlations_measure_peak(struct correlations_t *corr) {
+  const int best = corr->best_shift + MAX_SHIFT_SAMPLES;
+  const power_t peak = corr->correlations[best];
+  const int first = MAX_SHIFT_SAMPLES - corr->max_shift;
+  const int last = MAX_SHIFT_SAMPLES + corr->max_shift;
+
+  corr->peak_to_sidelobe_q8 = 0;
+  corr->peak_height_q15 = 0;
+  if (corr->estimated[best])
+    return;
+
+  power_t largest = 0;
+  for (int i = first; i <= last; i++) {
+    const power_t magnitude = (corr->correlations[i] < 0 ? -corr->correlations[i] : corr->correlations[i]);
+    if (magnitude > largest)
+      largest = magnitude;
+  }
+
+  int shift = 0;
+  while ((largest >> shift) >= ((power_t)1 << PSR_VALUE_BITS))
+    shift++;
+
+  // Sidelobes are every exact lag outside the main peak's suppression zone
+  power_t sum = 0;
+  power_t sum_squares = 0;
+  int count = 0;
+  for (int i = first; i <= last; i++) {
+    if ((i >= best - CORRELATION_PEAK_SEPARATION && i <= best + CORRELATION_PEAK_SEPARATION) ||
+        corr->estimated[i])
+      continue;
+
+    const power_t value = corr->correlations[i] >> shift;
+    sum += value;
+    sum_squares += value * value;
+    count++;
+  }
 
-    corr->correlations[s + MAX_SHIFT_SAMPLES] = score;
+  if (count > 1) {
+    const power_t mean = sum / count;
+    const power_t variance = sum_squares / count - mean * mean;
+    const power_t deviation = fixed_isqrt64(variance > 0 ? (uint64_t)variance : 0);
+    const power_t excess = (peak >> shift) - mean;
 
-    if (score > best_score) {
+    if (deviation > 0) {
+      const power_t ratio = (excess << 8) / deviation;
+      corr->peak_to_sidelobe_q8 = (int32_t)(ratio > INT32_MAX ? INT32_MAX : ratio);
+    } else if (excess > 0) {
+      corr->peak_to_sidelobe_q8 = INT32_MAX;
+    }
+  }
+
+  if (corr->coherent_peak > 0) {
+    // Bring both down until the quotient's numerator fits comfortably
+    power_t num = peak;
+    power_t den = corr->coherent_peak;
+    while (den >= ((power_t)1 << 31)) {
+      num >>= 1;
+      den >>= 1;
+    }
+
+    const power_t height = (num << 15) / den;
+    corr->peak_height_q15 = (int32_t)(height > INT16_MAX ? INT16_MAX : height < INT16_MIN ? INT16_MIN : height);
+  }
+}
+
+static void correlations_find_best(struct correlations_t *corr) {
+  power_t best_score = INT64_MIN;
+
+  for (int s = -corr->max_shift; s <= corr->max_shift; s++) {
+    power_t score = corr->correlations[s + MAX_SHIFT_SAMPLES];
+
+    if (score > best_score && !corr->estimated[s + MAX_SHIFT_SAMPLES]) {
       best_score = score;
       corr->best_shift = s;
     }
   }
 
-  for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++) {
-    int diff = s - corr->best_shift;
-    diff *= diff;
+  correlations_interpolate(corr);
+}
 
-    const float scale = exp(-diff / 36.f);
-    corr->correlations[s + MAX_SHIFT_SAMPLES] =
-        corr->correlations[s + MAX_SHIFT_SAMPLES] * scale;
+// Box low-pass and decimation in one step; the mean of
+// COARSE_DECIMATION samples always fits a sample
+static void coarse_decimate(struct coarse_buffer_t *dst, const struct buffer_t *src) {
+  dst->start = src->start >> COARSE_DECIMATION_BITS;
+  dst->end = (src->end + COARSE_DECIMATION - 1) >> COARSE_DECIMATION_BITS;
+
+  for (int k = dst->start; k < dst->end; k++) {
+    const sample_t *x = src->buffer + (k << COARSE_DECIMATION_BITS);
+
+    int32_t sum = 0;
+    for (int i = 0; i < COARSE_DECIMATION; i++)
+      sum += x[i];
+
+    dst->buffer[k] = (sample_t)(sum >> COARSE_DECIMATION_BITS);
+  }
+}
+
+static void coarse_correlate(power_t *coarse, int max_shift,
+                             const struct coarse_buffer_t *a,
+                             const struct coarse_buffer_t *b, int headroom) {
+  for (int s = -max_shift; s <= max_shift; s++) {
+    int lo = (a->start > b->start - s ? a->start : b->start - s);
+    int hi = (a->end < b->end - s ? a->end : b->end - s);
+
+    coarse[s + COARSE_MAX_SHIFT] =
+        (hi > lo ? dot_product(a->buffer + lo, b->buffer + lo + s, hi - lo, headroom) : 0);
+  }
+}
+
+// Up to two coarse shifts worth refining, best first. Returns how many,
+// or 0 when there is no single clear peak
+static int coarse_candidates(const power_t *coarse, int max_shift, int candidates[2]) {
+  power_t peaks[3] = {INT64_MIN, INT64_MIN, INT64_MIN};
+  int shifts[3] = {0, 0, 0};
+
+  const int first = COARSE_MAX_SHIFT - max_shift;
+  const int last = COARSE_MAX_SHIFT + max_shift;
+  for (int i = first; i <= last; i++) {
+    const bool rising = (i == first || coarse[i] > coarse[i - 1]);
+    const bool falling = (i == last || coarse[i] >= coarse[i + 1]);
+
+    if (!rising || !falling)
+      continue;
+
+    // Keep the three highest local maxima in order
+    int j = 3;
+    while (j > 0 && coarse[i] > peaks[j - 1])
+      j--;
+
+    for (int k = 2; k > j; k--) {
+      peaks[k] = peaks[k - 1];
+      shifts[k] = shifts[k - 1];
+    }
+
+    if (j < 3) {
+      peaks[j] = coarse[i];
+      shifts[j] = i - COARSE_MAX_SHIFT;
+    }
   }
 
+  if (peaks[0] <= 0)
+    return 0;
+
+  const power_t threshold = (peaks[0] >> 8) * COARSE_CANDIDATE_Q8;
+  if (peaks[2] >= threshold)
+    return 0;
+
+  candidates[0] = shifts[0];
+  candidates[1] = shifts[1];
+  return (peaks[1] >= threshold ? 2 : 1);
+}
+
+// Coarse search, then full-rate lags around the candidates. The lags in
+// between are filled in from the coarse correlation, below the refined
+// peak and marked estimated, so the whole curve can still be drawn.
+// Returns false, leaving the best shift unset, when the coarse peak is
+// ambiguous or the refined peak lies on the edge of its neighbourhood
+static bool correlations_coarse_to_fine(struct correlations_t *corr,
+                                        const struct buffer_t *buf_a,
+                                        const struct buffer_t *buf_b,
+                                        int headroom,
+                                        struct search_scratch_t *scratch) {
+  power_t coarse[COARSE_BUFFER_SIZE];
+  int candidates[2];
+
+  const int max_shift = corr->max_shift;
+  const int coarse_max_shift = (max_shift + COARSE_DECIMATION - 1) >> COARSE_DECIMATION_BITS;
+
+  coarse_decimate(&scratch->coarse_a, buf_a);
+  coarse_decimate(&scratch->coarse_b, buf_b);
+
+  // Decimated samples never exceed the originals' peaks
+  coarse_correlate(coarse, coarse_max_shift, &scratch->coarse_a, &scratch->coarse_b, headroom);
+
+  const int count = coarse_candidates(coarse, coarse_max_shift, candidates);
+  if (count == 0)
+    return false;
+
+  // correlations_compute_range clears the mark of the lags it refines
+  for (int s = -max_shift; s <= max_shift; s++)
+    corr->estimated[s + MAX_SHIFT_SAMPLES] = true;
+
+  power_t best_score = INT64_MIN;
+  for (int c = 0; c < count; c++) {
+    const int centre = candidates[c] * COARSE_DECIMATION;
+    const int first = (centre - COARSE_REFINE_RADIUS > -max_shift ? centre - COARSE_REFINE_RADIUS : -max_shift);
+    const int last = (centre + COARSE_REFINE_RADIUS < max_shift ? centre + COARSE_REFINE_RADIUS : max_shift);
+
+    correlations_compute_range(corr, buf_a, buf_b, first, last, headroom);
+
+    for (int s = first; s <= last; s++) {
+      if (corr->correlations[s + MAX_SHIFT_SAMPLES] > best_score) {
+        best_score = corr->correlations[s + MAX_SHIFT_SAMPLES];
+        corr->best_shift = s;
+      }
+    }
+  }
+
+  // A peak still climbing at the edge was not bracketed by the search
+  const int best = corr->best_shift + MAX_SHIFT_SAMPLES;
+  if ((corr->best_shift > -max_shift && corr->estimated[best - 1]) ||
+      (corr->best_shift < max_shift && corr->estimated[best + 1]))
+    return false;
+
+  // Each coarse product stands for COARSE_DECIMATION full-rate ones, which
+  // cancels the interpolation weights' denominator. The decimated copies
+  // lose the peak's fine structure, so a fill can overshoot the refined
+  // peak; it is held just below it
+  for (int s = -max_shift; s <= max_shift; s++) {
+    if (!corr->estimated[s + MAX_SHIFT_SAMPLES])
+      continue;
+
+    const int k = (s >> COARSE_DECIMATION_BITS) + COARSE_MAX_SHIFT;
+    const int frac = s & (COARSE_DECIMATION - 1);
+    const power_t fill = coarse[k] * (COARSE_DECIMATION - frac) + (frac ? coarse[k + 1] * frac : 0);
+
+    corr->correlations[s + MAX_SHIFT_SAMPLES] = (fill < best_score ? fill : best_score - 1);
+  }
+
+  return true;
+}
+
+static void prune_roots(uint32_t *roots, const struct buffer_t *buf) {
+  const int chunks = (buf->size >> PRUNE_CHUNK_BITS) + 1;
+  power_t energy = 0;
+
+  for (int g = chunks - 1; g >= 0; g--) {
+    const int lo = (g << PRUNE_CHUNK_BITS > buf->start ? g << PRUNE_CHUNK_BITS : buf->start);
+    const int hi = ((g + 1) << PRUNE_CHUNK_BITS < buf->end ? (g + 1) << PRUNE_CHUNK_BITS : buf->end);
+
+    for (int i = lo; i < hi; i++)
+      energy += (int32_t)buf->buffer[i] * buf->buffer[i];
+
+    uint32_t root = fixed_isqrt64(energy);
+    roots[g] = ((power_t)root * root < energy ? root + 1 : root);
+  }
+}
+
+// One lag's sum, abandoned once the Cauchy-Schwarz bound on the products
+// still to come cannot lift it to best. Returns true with the exact sum,
+// or false with that bound, which lies below best, marked estimated
+static bool prune_lag(struct correlations_t *corr, const struct buffer_t *buf_a,
+                      const struct buffer_t *buf_b, int s, int headroom,
+                      bool have_best, power_t best,
+                      const struct search_scratch_t *scratch) {
+  const int n = correlations_overlap(buf_a, buf_b, s);
+  const int lo = (buf_a->start > buf_b->start - s ? buf_a->start : buf_b->start - s);
+  const int hi = lo + n;
+
+  power_t sum = 0;
+  for (int i = lo; i < hi;) {
+    const power_t bound = (power_t)scratch->prune_root_a[i >> PRUNE_CHUNK_BITS] *
+                          scratch->prune_root_b[(i + s) >> PRUNE_CHUNK_BITS];
+
+    if (have_best && sum + bound < best) {
+      corr->correlations[s + MAX_SHIFT_SAMPLES] = sum + bound;
+      corr->estimated[s + MAX_SHIFT_SAMPLES] = true;
+      return false;
+    }
+
+    const int next = ((i >> PRUNE_CHUNK_BITS) + 1) << PRUNE_CHUNK_BITS;
+    const int end = (next < hi ? next : hi);
+
+    sum += dot_product(buf_a->buffer + i, buf_b->buffer + i + s, end - i, headroom);
+    i = end;
+  }
+
+  corr->correlations[s + MAX_SHIFT_SAMPLES] = sum;
+  corr->estimated[s + MAX_SHIFT_SAMPLES] = false;
+  return true;
+}
+
+// Branch-and-bound search for the exact best shift. Lags are visited
+// outwards from the previous frame's best shift, and each is abandoned as
+// soon as it provably cannot beat the best found so far. The best shift
+// and the lags the peak interpolation reads are exact, so the result
+// picks the same shift as the full search; abandoned lags hold their
+// bound, marked estimated
+static void correlations_pruned_search(struct correlations_t *corr,
+                                       const struct buffer_t *buf_a,
+                                       const struct buffer_t *buf_b,
+                                       int headroom,
+                                       struct search_scratch_t *scratch) {
+  const int max_shift = corr->max_shift;
+
+  prune_roots(scratch->prune_root_a, buf_a);
+  prune_roots(scratch->prune_root_b, buf_b);
+
+  int start = corr->best_shift;
+  start = (start < -max_shift ? -max_shift : start > max_shift ? max_shift : start);
+
+  bool have_best = false;
+  power_t best = 0;
+  int best_shift = start;
+
+  // start, start + 1, start - 1, start + 2, ... within the range
+  for (int step = 0; step <= 2 * max_shift; step++) {
+    for (int side = 0; side < 2; side++) {
+      if (step == 0 && side == 1)
+        continue;
+
+      const int s = (side == 0 ? start + step : start - step);
+      if (s < -max_shift || s > max_shift)
+        continue;
+
+      const bool exact = prune_lag(corr, buf_a, buf_b, s, headroom, have_best, best, scratch);
+
+      const power_t value = corr->correlations[s + MAX_SHIFT_SAMPLES];
+      if (exact &&
+          (!have_best || value > best || (value == best && s < best_shift))) {
+        have_best = true;
+        best = value;
+        best_shift = s;
+      }
+    }
+  }
+
+  // The interpolation reads the peak's neighbours
+  for (int s = best_shift - INTERP_SINC_RADIUS; s <= best_shift + INTERP_SINC_RADIUS; s++) {
+    if (s >= -max_shift && s <= max_shift && corr->estimated[s + MAX_SHIFT_SAMPLES])
+      prune_lag(corr, buf_a, buf_b, s, headroom, false, 0, scratch);
+  }
+}
+
+// Prior and timestamp once the best shift is known. With the joint
+// search the prior has to wait until that has picked the final shifts
+static void correlations_settle(struct correlations_t *corr) {
+  if (!JOINT_LAG_SEARCH)
+    correlations_apply_prior(corr);
+
   corr->last_update = get_absolute_time();
 }
 
+void correlations_set_range(struct correlations_t *corr, int max_shift) {
+  corr->max_shift = (max_shift < MAX_SHIFT_SAMPLES ? max_shift : MAX_SHIFT_SAMPLES);
+
+  for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++) {
+    corr->correlations[i] = 0;
+    corr->estimated[i] = false;
+  }
+}
+
+void correlations_init(struct correlations_t *corr,
+                       const struct buffer_t *buf_a,
+                       const struct buffer_t *buf_b) {
+  correlations_init_on(0, corr, buf_a, buf_b);
+}
+
+void correlations_init_on(int core,
+                          struct correlations_t *corr,
+                          const struct buffer_t *buf_a,
+                          const struct buffer_t *buf_b) {
+  struct search_scratch_t *scratch = &search_scratch[core];
+  const int headroom = dot_product_headroom(buffer_peak(buf_a), buffer_peak(buf_b));
+
+  correlations_set_energies(corr, buffer_energy(buf_a), buffer_energy(buf_b));
+
+  if (CORRELATION_COARSE_TO_FINE &&
+      correlations_coarse_to_fine(corr, buf_a, buf_b, headroom, scratch)) {
+    correlations_interpolate(corr);
+    correlations_find_peaks(corr);
+    correlations_measure_peak(corr);
+    correlations_settle(corr);
+    return;
+  }
+
+  if (CORRELATION_PRUNED_SEARCH)
+    correlations_pruned_search(corr, buf_a, buf_b, headroom, scratch);
+  else
+    correlations_compute_range(corr, buf_a, buf_b,
+                               -corr->max_shift, corr->max_shift, headroom);
+  correlations_finish(corr);
+}
+
+int correlations_overlap(const struct buffer_t *buf_a,
+                         const struct buffer_t *buf_b, int shift) {
+  // Only the overlap of both active spans can contribute
+  int lo = (buf_a->start > buf_b->start - shift ? buf_a->start : buf_b->start - shift);
+  int hi = (buf_a->end < buf_b->end - shift ? buf_a->end : buf_b->end - shift);
+
+  return (hi > lo ? hi - lo : 0);
+}
+
+void correlations_compute_range(struct correlations_t *corr,
+                                const struct buffer_t *buf_a,
+                                const struct buffer_t *buf_b,
+                                int first_shift, int last_shift, int headroom) {
+  for (int s = first_shift; s <= last_shift; s++) {
+    int lo = (buf_a->start > buf_b->start - s ? buf_a->start : buf_b->start - s);
+
+    corr->correlations[s + MAX_SHIFT_SAMPLES] =
+        dot_product(buf_a->buffer + lo, buf_b->buffer + lo + s,
+                    correlations_overlap(buf_a, buf_b, s), headroom);
+    corr->estimated[s + MAX_SHIFT_SAMPLES] = false;
+  }
+}
+
+// Lags of all three pairs that one sweep over the samples computes
+#define FUSED_LAGS 4
+
+// Lags s0 .. s0 + FUSED_LAGS - 1 of pairs ab, ac and bc in one sweep:
+// each step loads a[i], b[i] and one new sample each of the b and c
+// windows, then does twelve multiply-accumulates. Partial sums stay in
+// int32 for headroom samples at a time
+static void fused_block(power_t sums[3][FUSED_LAGS],
+                        const sample_t *a, const sample_t *b, const sample_t *c,
+                        int s0, int lo, int hi, int headroom) {
+  for (int i = lo; i < hi;) {
+    const int end = (hi - i > headroom ? i + headroom : hi);
+
+    int32_t ab0 = 0, ab1 = 0, ab2 = 0, ab3 = 0;
+    int32_t ac0 = 0, ac1 = 0, ac2 = 0, ac3 = 0;
+    int32_t bc0 = 0, bc1 = 0, bc2 = 0, bc3 = 0;
+
+    // Windows b[i + s0 ..] and c[i + s0 ..] slide along with i
+    int32_t b0 = b[i + s0], b1 = b[i + s0 + 1], b2 = b[i + s0 + 2];
+    int32_t c0 = c[i + s0], c1 = c[i + s0 + 1], c2 = c[i + s0 + 2];
+
+    for (; i < end; i++) {
+      const int32_t b3 = b[i + s0 + 3];
+      const int32_t c3 = c[i + s0 + 3];
+      const int32_t ai = a[i];
+      const int32_t bi = b[i];
+
+      ab0 += ai * b0;
+      ab1 += ai * b1;
+      ab2 += ai * b2;
+      ab3 += ai * b3;
+      ac0 += ai * c0;
+      ac1 += ai * c1;
+      ac2 += ai * c2;
+      ac3 += ai * c3;
+      bc0 += bi * c0;
+      bc1 += bi * c1;
+      bc2 += bi * c2;
+      bc3 += bi * c3;
+
+      b0 = b1;
+      b1 = b2;
+      b2 = b3;
+      c0 = c1;
+      c1 = c2;
+      c2 = c3;
+    }
+
+    sums[0][0] += ab0;
+    sums[0][1] += ab1;
+    sums[0][2] += ab2;
+    sums[0][3] += ab3;
+    sums[1][0] += ac0;
+    sums[1][1] += ac1;
+    sums[1][2] += ac2;
+    sums[1][3] += ac3;
+    sums[2][0] += bc0;
+    sums[2][1] += bc1;
+    sums[2][2] += bc2;
+    sums[2][3] += bc3;
+  }
+}
+
+// The same products one at a time near the frame ends, where some of the
+// block's lags would read outside the frame
+static void fused_edge(power_t sums[3][FUSED_LAGS],
+                       const sample_t *a, const sample_t *b, const sample_t *c,
+                       int s0, int lo, int hi, int size) {
+  for (int i = lo; i < hi; i++) {
+    for (int k = 0; k < FUSED_LAGS; k++) {
+      const int j = i + s0 + k;
+      if (j < 0 || j >= size)
+        continue;
+
+      sums[0][k] += (int32_t)a[i] * b[j];
+      sums[1][k] += (int32_t)a[i] * c[j];
+      sums[2][k] += (int32_t)b[i] * c[j];
+    }
+  }
+}
+
+// Every pair's lags from s0 on, FUSED_LAGS of them, exactly as
+// correlations_compute_range would give them
+static void correlations_fused_lags(struct correlations_t *const corrs[3],
+                                    const struct buffer_t *const bufs[3],
+                                    int s0, int headroom) {
+  const struct buffer_t *buf_a = bufs[0];
+  const struct buffer_t *buf_b = bufs[1];
+  const struct buffer_t *buf_c = bufs[2];
+  const int size = buf_a->size;
+
+  // a and b are read at i, b and c at i + s0 + k. Samples outside their
+  // spans are zero, so only i that reach both spans matter
+  const int x_lo = (buf_a->start < buf_b->start ? buf_a->start : buf_b->start);
+  const int x_hi = (buf_a->end > buf_b->end ? buf_a->end : buf_b->end);
+  const int y_lo = (buf_b->start < buf_c->start ? buf_b->start : buf_c->start);
+  const int y_hi = (buf_b->end > buf_c->end ? buf_b->end : buf_c->end);
+
+  const int lo = (x_lo > y_lo - s0 - (FUSED_LAGS - 1) ? x_lo : y_lo - s0 - (FUSED_LAGS - 1));
+  const int hi = (x_hi < y_hi - s0 ? x_hi : y_hi - s0);
+
+  // Where all of the block's reads stay inside the frame, kept within
+  // lo .. hi so the three parts never overlap
+  int inner_lo = (lo > -s0 ? lo : -s0);
+  inner_lo = (inner_lo < hi ? inner_lo : hi);
+  int inner_hi = (hi < size - s0 - (FUSED_LAGS - 1) ? hi : size - s0 - (FUSED_LAGS - 1));
+  inner_hi = (inner_hi > inner_lo ? inner_hi : inner_lo);
+
+  power_t sums[3][FUSED_LAGS] = {{0}};
+  if (hi > lo) {
+    fused_edge(sums, buf_a->buffer, buf_b->buffer, buf_c->buffer, s0, lo, inner_lo, size);
+    fused_block(sums, buf_a->buffer, buf_b->buffer, buf_c->buffer, s0, inner_lo, inner_hi, headroom);
+    fused_edge(sums, buf_a->buffer, buf_b->buffer, buf_c->buffer, s0, inner_hi, hi, size);
+  }
+
+  for (int p = 0; p < 3; p++)
+    for (int k = 0; k < FUSED_LAGS; k++) {
+      corrs[p]->correlations[s0 + k + MAX_SHIFT_SAMPLES] = sums[p][k];
+      corrs[p]->estimated[s0 + k + MAX_SHIFT_SAMPLES] = false;
+    }
+}
+
+void correlations_compute_pairs(struct correlations_t *const corrs[3],
+                                const struct buffer_t *const bufs[3],
+                                int first_shift, int last_shift) {
+  static const int pair_a[3] = {0, 0, 1};
+  static const int pair_b[3] = {1, 2, 2};
+
+  int32_t peaks[3];
+  for (int c = 0; c < 3; c++)
+    peaks[c] = buffer_peak(bufs[c]);
+
+  int headrooms[3];
+  int common = MAX_SHIFT_SAMPLES;
+  int headroom = INT32_MAX;
+  for (int p = 0; p < 3; p++) {
+    headrooms[p] = dot_product_headroom(peaks[pair_a[p]], peaks[pair_b[p]]);
+    headroom = (headrooms[p] < headroom ? headrooms[p] : headroom);
+    common = (corrs[p]->max_shift < common ? corrs[p]->max_shift : common);
+  }
+
+  // Whole blocks of the lags every pair has go through the fused sweep
+  const int fused_first = (first_shift > -common ? first_shift : -common);
+  const int fused_last = (last_shift < common ? last_shift : common);
+  const int blocks = (fused_last >= fused_first ? (fused_last - fused_first + 1) / FUSED_LAGS : 0);
+  const int fused_end = fused_first + blocks * FUSED_LAGS;
+
+  for (int s0 = fused_first; s0 < fused_end; s0 += FUSED_LAGS)
+    correlations_fused_lags(corrs, bufs, s0, headroom);
+
+  // The rest one pair and one lag at a time
+  for (int p = 0; p < 3; p++) {
+    const int lo = (first_shift > -corrs[p]->max_shift ? first_shift : -corrs[p]->max_shift);
+    const int hi = (last_shift < corrs[p]->max_shift ? last_shift : corrs[p]->max_shift);
+    const struct buffer_t *x = bufs[pair_a[p]];
+    const struct buffer_t *y = bufs[pair_b[p]];
+
+    if (blocks == 0) {
+      correlations_compute_range(corrs[p], x, y, lo, hi, headrooms[p]);
+      continue;
+    }
+
+    correlations_compute_range(corrs[p], x, y, lo, fused_first - 1, headrooms[p]);
+    correlations_compute_range(corrs[p], x, y, fused_end, hi, headrooms[p]);
+  }
+}
+
+void correlations_init_pairs(struct correlations_t *const corrs[3],
+                             const struct buffer_t *const bufs[3]) {
+  static const int pair_a[3] = {0, 0, 1};
+  static const int pair_b[3] = {1, 2, 2};
+
+  if (CORRELATIONS_SIMD)
+    correlations_simd_compute_pairs(corrs, bufs);
+  else
+    correlations_compute_pairs(corrs, bufs, -MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES);
+
+  for (int p = 0; p < 3; p++) {
+    correlations_set_energies(corrs[p], buffer_energy(bufs[pair_a[p]]), buffer_energy(bufs[pair_b[p]]));
+    correlations_finish(corrs[p]);
+  }
+}
+
+void correlations_finish(struct correlations_t *corr) {
+  correlations_find_best(corr);
+  correlations_find_peaks(corr);
+  correlations_measure_peak(corr);
+  correlations_settle(corr);
+}
+
+void correlations_set_energies(struct correlations_t *corr, power_t energy_a, power_t energy_b) {
+  corr->coherent_peak = (power_t)fixed_isqrt64(energy_a) * fixed_isqrt64(energy_b);
+}
+
+bool correlations_confident(const struct correlations_t *corr) {
+  return CORRELATION_MIN_PSR_Q8 <= 0 || corr->peak_to_sidelobe_q8 >= CORRELATION_MIN_PSR_Q8;
+}
+
+void correlations_set_best(struct correlations_t *corr, int best_shift) {
+  corr->best_shift = best_shift;
+  correlations_interpolate(corr);
+  correlations_measure_peak(corr);
+}
+
+void correlations_tables_init(void) {
+  for (int d = 0; d < CORRELATION_BUFFER_SIZE; d++) {
+    const float x = d / CORRELATION_PRIOR_WIDTH_SAMPLES;
+    correlation_prior_q15[d] = (uint16_t)lroundf(expf(-x * x) * 32768.0f);
+  }
+
+  // Smallest step that spreads the reset gap over the table
+  const uint32_t reset_us = CORRELATION_AVERAGE_RESET_US;
+  average_step_bits = 0;
+  while ((reset_us >> average_step_bits) >= AVERAGE_STEPS)
+    average_step_bits++;
+
+  for (int i = 0; i <= AVERAGE_STEPS; i++) {
+    const float dt = (float)((uint32_t)i << average_step_bits) * 1e-6f;
+    average_decay_q16[i] = (uint32_t)lroundf((1.0f - expf(-dt / CORRELATION_AVERAGE_TAU_S)) * 65536.0f);
+  }
+}
+
+void correlations_apply_prior(struct correlations_t *corr) {
+  if (CORRELATION_PRIOR) {
+    for (int s = -corr->max_shift; s <= corr->max_shift; s++) {
+      const int diff = (s > corr->best_shift ? s - corr->best_shift : corr->best_shift - s);
+
+      // Correlations stay below 2^47, so the product fits in 64 bits
+      power_t *value = &corr->correlations[s + MAX_SHIFT_SAMPLES];
+      *value = (*value * correlation_prior_q15[diff] + (1 << 14)) >> 15;
+    }
+  }
+}
+
 void correlations_average(struct correlations_t *estimate,
                            struct correlations_t *new_data) {
   absolute_time_t now_us = get_absolute_time();
 
-  float dt = (now_us - estimate->last_update) / 1e6f;
-  float decay = 1.f - exp(-dt / 0.5f);
+  const uint64_t dt = now_us - estimate->last_update;
 
-  for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++) {
-    power_t est = estimate->correlations[i];
-    power_t new = new_data->correlations[i];
+  // After a long gap the old estimate says nothing about the new source.
+  // The table only interpolates the decay below that gap, which its
+  // power-of-two steps always cover
+  if (dt >= CORRELATION_AVERAGE_RESET_US) {
+    for (int s = -estimate->max_shift; s <= estimate->max_shift; s++) {
+      estimate->correlations[s + MAX_SHIFT_SAMPLES] = new_data->correlations[s + MAX_SHIFT_SAMPLES];
+      estimate->estimated[s + MAX_SHIFT_SAMPLES] = new_data->estimated[s + MAX_SHIFT_SAMPLES];
+    }
+  } else {
+    const uint32_t step = (uint32_t)(dt >> average_step_bits);
+    const int32_t lo = (int32_t)average_decay_q16[step];
+    const int32_t hi = (int32_t)average_decay_q16[step + 1];
+    const int32_t frac = (int32_t)(dt & ((1u << average_step_bits) - 1));
+    const int32_t decay = lo + (((hi - lo) * frac) >> average_step_bits);
 
-    estimate->correlations[i] += (new - est) * decay;
-  }
+    // Differences stay below 2^47, so the product fits in 64 bits. A
+    // frame's estimated lags leave the average alone, and its exact ones
+    // replace an average that only held estimates
+    for (int i = MAX_SHIFT_SAMPLES - estimate->max_shift; i <= MAX_SHIFT_SAMPLES + estimate->max_shift; i++) {
+      power_t est = estimate->correlations[i];
+      power_t new = new_data->correlations[i];
 
-  power_t best_score = INT64_MIN;
-  for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++) {
-    power_t score = estimate->correlations[s + MAX_SHIFT_SAMPLES];
+      if (new_data->estimated[i])
+        continue;
 
-    if (score > best_score) {
-      best_score = score;
-      estimate->best_shift = s;
+      if (estimate->estimated[i]) {
+        estimate->correlations[i] = new;
+        estimate->estimated[i] = false;
+        continue;
+      }
+
+      estimate->correlations[i] += ((new - est) * decay) >> 16;
     }
   }
 
+  correlations_find_best(estimate);
+
   estimate->last_update = now_us;
 }
\ No newline at end of file
@@ -7,19 +7,117 @@
 
 #define CORRELATION_BUFFER_SIZE (2 * MAX_SHIFT_SAMPLES + 1)
 
+struct correlation_peak_t
+{
+    int shift;
+    power_t height;
+};
+
 struct correlations_t
 {
+    // Lags -max_shift..max_shift of the pair; the storage outside them,
+    // up to the widest pair's range, stays zero
+    int max_shift;
     power_t correlations[CORRELATION_BUFFER_SIZE];
     int best_shift;
 
+    // Lags holding estimates rather than exact sums: the coarse-to-fine
+    // fill between the refined lags, and the bound of lags the pruned
+    // search gave up on. Kept below the peak for drawing and the joint
+    // search, but never listed as peaks, counted as sidelobes or averaged
+    bool estimated[CORRELATION_BUFFER_SIZE];
+
+    // Best shift refined between samples by PEAK_INTERPOLATION, in Q8
+    int best_shift_q8;
+
+    // Height a peak would reach if both signals were fully coherent, set
+    // by the engine before correlations_finish; 0 when unknown
+    power_t coherent_peak;
+
+    // Highest local maxima at least CORRELATION_PEAK_SEPARATION apart,
+    // best first, before the prior
+    int num_peaks;
+    struct correlation_peak_t peaks[CORRELATION_MAX_PEAKS];
+
+    // Main peak over the mean of the lags outside it, in standard
+    // deviations of those lags, Q8; at the best shift finally chosen
+    int32_t peak_to_sidelobe_q8;
+
+    // Main peak over coherent_peak, Q15; 1.0 for identical signals
+    int32_t peak_height_q15;
+
     absolute_time_t last_update;
 };
 
+// Sets the pair's lag range, at most MAX_SHIFT_SAMPLES, and clears the
+// correlations; call once before the first frame
+void correlations_set_range(struct correlations_t *corr, int max_shift);
+
 void correlations_init(
     struct correlations_t *corr,
     const struct buffer_t *buf_a,
     const struct buffer_t *buf_b);
 
+// correlations_init with the work room of core 0 or 1, so the cores can
+// each search their own pairs at the same time
+void correlations_init_on(
+    int core,
+    struct correlations_t *corr,
+    const struct buffer_t *buf_a,
+    const struct buffer_t *buf_b);
+
+// Raw correlations for shifts first_shift..last_shift only, so the lag
+// range can be split between cores; headroom as for dot_product
+void correlations_compute_range(
+    struct correlations_t *corr,
+    const struct buffer_t *buf_a,
+    const struct buffer_t *buf_b,
+    int first_shift, int last_shift, int headroom);
+
+// Raw correlations of pairs (0, 1), (0, 2) and (1, 2) of bufs for shifts
+// first_shift..last_shift, within each pair's range. Blocks of lags that
+// all three pairs share are computed together in one sweep over the
+// samples, reusing every loaded sample across lags and pairs
+void correlations_compute_pairs(
+    struct correlations_t *const corrs[3],
+    const struct buffer_t *const bufs[3],
+    int first_shift, int last_shift);
+
+// All three pairs over their whole lag ranges, finished; the same as
+// correlations_init on each pair without CORRELATION_COARSE_TO_FINE
+void correlations_init_pairs(
+    struct correlations_t *const corrs[3],
+    const struct buffer_t *const bufs[3]);
+
+// Number of products that contribute at a shift
+int correlations_overlap(
+    const struct buffer_t *buf_a,
+    const struct buffer_t *buf_b,
+    int shift);
+
+// coherent_peak from the energies of the two signals, by Cauchy-Schwarz
+void correlations_set_energies(struct correlations_t *corr, power_t energy_a, power_t energy_b);
+
+// True when the frame's main peak stands out enough to be used
+bool correlations_confident(const struct correlations_t *corr);
+
+// Picks the best shift of freshly computed correlations[], lists its
+// peaks and their confidence, refines the shift between samples and
+// applies the prior around it (unless the joint lag search will pick the
+// shift); every correlation engine ends with this
+void correlations_finish(struct correlations_t *corr);
+
+// Overrides the best shift, refines it between samples and measures the
+// peak-to-sidelobe ratio and peak height there
+void correlations_set_best(struct correlations_t *corr, int best_shift);
+
+// Builds the prior and running-average lookup tables; call once before
+// any correlation
+void correlations_tables_init(void);
+
+// Gaussian prior around the best shift when CORRELATION_PRIOR is set
+void correlations_apply_prior(struct correlations_t *corr);
+
 void correlations_average(
     struct correlations_t *estimate,
     struct correlations_t *new_data);
\ No newline at end of file
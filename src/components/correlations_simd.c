@@ -0,0 +1,140 @@
+#include <components/correlations_simd.h>
+#include <components/dot_product.h>
+
+#if CORRELATIONS_SIMD
+
+#include <immintrin.h>
+
+// Pairwise multiply-adds of 16-bit samples leave two products in each
+// 32-bit lane, so a lane may take headroom / 2 of them before it has to
+// be widened into the 64-bit sums. A headroom below 2 means even one
+// pair of products can overflow; those frames stay scalar
+typedef power_t (*simd_dot_t)(const sample_t *a, const sample_t *b, int n, int headroom);
+
+__attribute__((target("avx2")))
+static power_t dot_avx2(const sample_t *a, const sample_t *b, int n, int headroom)
+{
+    const int per_spill = headroom / 2;
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+
+    while (i + 16 <= n)
+    {
+        __m256i lanes = _mm256_setzero_si256();
+        for (int k = 0; k < per_spill && i + 16 <= n; k++, i += 16)
+        {
+            const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+            const __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+            lanes = _mm256_add_epi32(lanes, _mm256_madd_epi16(x, y));
+        }
+
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(lanes)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(lanes, 1)));
+    }
+
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    power_t sum = _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+
+    return sum + dot_product_c(a + i, b + i, n - i, headroom);
+}
+
+__attribute__((target("sse4.1")))
+static power_t dot_sse41(const sample_t *a, const sample_t *b, int n, int headroom)
+{
+    const int per_spill = headroom / 2;
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+
+    while (i + 8 <= n)
+    {
+        __m128i lanes = _mm_setzero_si128();
+        for (int k = 0; k < per_spill && i + 8 <= n; k++, i += 8)
+        {
+            const __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+            const __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+            lanes = _mm_add_epi32(lanes, _mm_madd_epi16(x, y));
+        }
+
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(lanes));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_unpackhi_epi64(lanes, lanes)));
+    }
+
+    power_t sum = _mm_cvtsi128_si64(acc) + _mm_extract_epi64(acc, 1);
+
+    return sum + dot_product_c(a + i, b + i, n - i, headroom);
+}
+
+static simd_dot_t simd_dot;
+static const char *simd_name;
+
+static void simd_select(void)
+{
+    if (simd_dot)
+        return;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        simd_dot = dot_avx2;
+        simd_name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse4.1"))
+    {
+        simd_dot = dot_sse41;
+        simd_name = "sse4.1";
+    }
+    else
+    {
+        simd_dot = dot_product_c;
+        simd_name = "scalar";
+    }
+}
+
+void correlations_simd_compute_pairs(struct correlations_t *const corrs[3],
+                                     const struct buffer_t *const bufs[3])
+{
+    static const int pair_a[3] = {0, 0, 1};
+    static const int pair_b[3] = {1, 2, 2};
+
+    simd_select();
+
+    for (int p = 0; p < 3; p++)
+    {
+        const struct buffer_t *x = bufs[pair_a[p]];
+        const struct buffer_t *y = bufs[pair_b[p]];
+        const int headroom = dot_product_headroom(buffer_peak(x), buffer_peak(y));
+        const simd_dot_t dot = (headroom >= 2 ? simd_dot : dot_product_c);
+
+        // The same overlap and start as correlations_compute_range
+        for (int s = -corrs[p]->max_shift; s <= corrs[p]->max_shift; s++)
+        {
+            const int lo = (x->start > y->start - s ? x->start : y->start - s);
+            const int n = correlations_overlap(x, y, s);
+
+            corrs[p]->correlations[s + MAX_SHIFT_SAMPLES] =
+                (n > 0 ? dot(x->buffer + lo, y->buffer + lo + s, n, headroom) : 0);
+            corrs[p]->estimated[s + MAX_SHIFT_SAMPLES] = false;
+        }
+    }
+}
+
+const char *correlations_simd_backend(void)
+{
+    simd_select();
+    return simd_name;
+}
+
+#else
+
+void correlations_simd_compute_pairs(struct correlations_t *const corrs[3],
+                                     const struct buffer_t *const bufs[3])
+{
+    correlations_compute_pairs(corrs, bufs, -MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES);
+}
+
+const char *correlations_simd_backend(void)
+{
+    return "scalar";
+}
+
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+#include <components/correlations.h>
+
+// x86-64 hosts replaying field recordings through the same pipeline get
+// AVX2 or SSE4.1 lag kernels, picked at run time from what the CPU
+// supports; the RP2040 keeps the scalar and Thumb-1 paths
+#if defined(__x86_64__)
+#define CORRELATIONS_SIMD 1
+#else
+#define CORRELATIONS_SIMD 0
+#endif
+
+// Raw correlations of pairs (0, 1), (0, 2) and (1, 2) of bufs over each
+// pair's whole lag range, bit-exact with correlations_compute_pairs,
+// which it falls back to without CORRELATIONS_SIMD
+void correlations_simd_compute_pairs(
+    struct correlations_t *const corrs[3],
+    const struct buffer_t *const bufs[3]);
+
+// Kernel the CPU dispatch settled on: "avx2", "sse4.1" or "scalar"
+const char *correlations_simd_backend(void);
@@ -0,0 +1,109 @@
+#include <components/dot_product.h>
+
+// Products per 32-bit block in the unrolled kernels
+#define DOT_PRODUCT_BLOCK 8
+
+// Never need to prove more than this
+#define DOT_PRODUCT_MAX_HEADROOM (1 << 16)
+
+#if DOT_PRODUCT_ASM
+// n is a positive multiple of DOT_PRODUCT_BLOCK and a is word aligned.
+// aligned8 and mixed8 need a headroom of 8, aligned2 of 2. mixed8 takes b
+// one halfword off alignment and reads b[-1] and b[n] as well: the other
+// halves of the words holding b[0] and b[n - 1], so no read leaves a word
+// the caller's samples occupy
+power_t dot_product_m0_aligned8(const sample_t *a, const sample_t *b, int n);
+power_t dot_product_m0_aligned2(const sample_t *a, const sample_t *b, int n);
+power_t dot_product_m0_mixed8(const sample_t *a, const sample_t *b, int n);
+#endif
+
+int dot_product_headroom(int32_t peak_a, int32_t peak_b)
+{
+    const uint32_t worst = (uint32_t)peak_a * (uint32_t)peak_b;
+
+    if (worst <= INT32_MAX / DOT_PRODUCT_MAX_HEADROOM)
+        return DOT_PRODUCT_MAX_HEADROOM;
+
+    return (int)(INT32_MAX / worst);
+}
+
+power_t dot_product_c(const sample_t *a, const sample_t *b, int n, int headroom)
+{
+    power_t acc = 0;
+    int i = 0;
+
+    if (headroom >= DOT_PRODUCT_BLOCK)
+    {
+        for (; i + DOT_PRODUCT_BLOCK <= n; i += DOT_PRODUCT_BLOCK)
+        {
+            int32_t block = 0;
+            for (int j = i; j < i + DOT_PRODUCT_BLOCK; j++)
+                block += (int32_t)a[j] * (int32_t)b[j];
+            acc += block;
+        }
+    }
+    else if (headroom >= 2)
+    {
+        for (; i + 2 <= n; i += 2)
+            acc += (int32_t)a[i] * (int32_t)b[i] + (int32_t)a[i + 1] * (int32_t)b[i + 1];
+    }
+
+    for (; i < n; i++)
+        acc += (int32_t)a[i] * (int32_t)b[i];
+
+    return acc;
+}
+
+power_t dot_product(const sample_t *a, const sample_t *b, int n, int headroom)
+{
+    if (n <= 0)
+        return 0;
+
+#if DOT_PRODUCT_ASM
+    power_t acc = 0;
+
+    // Both off by a halfword: one sample puts both on word boundaries
+    if (((uintptr_t)a & 2) && ((uintptr_t)b & 2))
+    {
+        acc += (int32_t)a[0] * (int32_t)b[0];
+        a++;
+        b++;
+        n--;
+    }
+
+    // The kernels want a aligned; the sum does not care which is which
+    if ((uintptr_t)a & 2)
+    {
+        const sample_t *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    int blocks = 0;
+    if ((uintptr_t)b & 2)
+    {
+        // Leave the last sample to C so the kernel's read of b[n] stays
+        // among the caller's samples; its read of b[-1] shares b[0]'s word
+        if (headroom >= DOT_PRODUCT_BLOCK)
+        {
+            blocks = (n - 1) & ~(DOT_PRODUCT_BLOCK - 1);
+            if (blocks > 0)
+                acc += dot_product_m0_mixed8(a, b, blocks);
+        }
+    }
+    else
+    {
+        blocks = n & ~(DOT_PRODUCT_BLOCK - 1);
+        if (blocks > 0 && headroom >= DOT_PRODUCT_BLOCK)
+            acc += dot_product_m0_aligned8(a, b, blocks);
+        else if (blocks > 0 && headroom >= 2)
+            acc += dot_product_m0_aligned2(a, b, blocks);
+        else
+            blocks = 0;
+    }
+
+    return acc + dot_product_c(a + blocks, b + blocks, n - blocks, headroom);
+#else
+    return dot_product_c(a, b, n, headroom);
+#endif
+}
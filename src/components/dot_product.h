@@ -0,0 +1,25 @@
+#pragma once
+
+#include <components/constants.h>
+
+// The hand-scheduled Thumb-1 kernels in dot_product_m0.S are used on the
+// RP2040; everywhere else the portable C path runs on its own. A host test
+// sets it ahead of this header to run the kernels in a model of the core
+#ifndef DOT_PRODUCT_ASM
+#if defined(__ARM_ARCH_6M__)
+#define DOT_PRODUCT_ASM 1
+#else
+#define DOT_PRODUCT_ASM 0
+#endif
+#endif
+
+// How many products of samples bounded by peak_a and peak_b are certain
+// to sum inside int32; the kernels spill to 64 bits no later than that
+int dot_product_headroom(int32_t peak_a, int32_t peak_b);
+
+// Exact sum of a[i] * b[i] for 0 <= i < n. headroom must come from
+// dot_product_headroom for bounds that hold over the n samples
+power_t dot_product(const sample_t *a, const sample_t *b, int n, int headroom);
+
+// Portable version of the same blocking; gives identical results
+power_t dot_product_c(const sample_t *a, const sample_t *b, int n, int headroom);
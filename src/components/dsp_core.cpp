@@ -0,0 +1,156 @@
+#include <components/dsp_core.hpp>
+
+extern "C"
+{
+#include <components/dsp_core.h>
+#include <components/dot_product.h>
+}
+
+namespace
+{
+
+// Pair p correlates channel PAIR_A[p] with channel PAIR_B[p]
+constexpr int PAIR_A[3] = {0, 0, 1};
+constexpr int PAIR_B[3] = {1, 2, 2};
+
+// Calls Kernel::run<SizeBits>(args...) for the run-time size_bits, one
+// instantiation per supported frame length; false when none matches
+template <typename Kernel, int SizeBits = BUFFER_MIN_SIZE_BITS, typename... Args>
+bool dispatch(int size_bits, Args... args)
+{
+    if (size_bits == SizeBits)
+    {
+        Kernel::template run<SizeBits>(args...);
+        return true;
+    }
+
+    if constexpr (SizeBits < BUFFER_MAX_SIZE_BITS)
+        return dispatch<Kernel, SizeBits + 1>(size_bits, args...);
+    else
+        return false;
+}
+
+struct window_kernel
+{
+    template <int SizeBits>
+    static void run(sample_t *x)
+    {
+        dsp::window<SizeBits>(x);
+    }
+};
+
+struct pairs_kernel
+{
+    template <int SizeBits>
+    static void run(power_t *const *corrs, const sample_t *const *xs,
+                    const sample_t *const *ys, const int *headrooms)
+    {
+        dsp::correlate_pairs<SizeBits, MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES>(
+            corrs, xs, ys, headrooms);
+    }
+};
+
+template <int MaxShift>
+struct pair_kernel
+{
+    template <int SizeBits>
+    static void run(power_t *corr, const sample_t *x, const sample_t *y, int headroom)
+    {
+        dsp::correlate_pair<SizeBits, MaxShift>(corr, x, y, headroom);
+    }
+};
+
+// Both frames whole and of one compiled length
+bool whole_frames(const struct buffer_t *const bufs[], int count)
+{
+    for (int c = 0; c < count; c++)
+    {
+        if (bufs[c]->size_bits != bufs[0]->size_bits || bufs[c]->start != 0 || bufs[c]->end != bufs[c]->size)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+extern "C" void dsp_core_window(struct buffer_t *buf)
+{
+    if (!dispatch<window_kernel>(buf->size_bits, buf->buffer))
+    {
+        buffer_window(buf);
+        return;
+    }
+
+    buf->start = 0;
+    buf->end = buf->size;
+}
+
+extern "C" bool dsp_core_init_pairs(struct correlations_t *const corrs[3],
+                                    const struct buffer_t *const bufs[3])
+{
+    static const int compiled[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+    const int size_bits = bufs[0]->size_bits;
+    if (!whole_frames(bufs, 3))
+        return false;
+
+    power_t *out[3];
+    const sample_t *xs[3];
+    const sample_t *ys[3];
+    int headrooms[3];
+
+    for (int p = 0; p < 3; p++)
+    {
+        if (corrs[p]->max_shift != compiled[p])
+            return false;
+
+        const struct buffer_t *x = bufs[PAIR_A[p]];
+        const struct buffer_t *y = bufs[PAIR_B[p]];
+
+        out[p] = corrs[p]->correlations;
+        xs[p] = x->buffer;
+        ys[p] = y->buffer;
+        headrooms[p] = dot_product_headroom(buffer_peak(x), buffer_peak(y));
+    }
+
+    if (!dispatch<pairs_kernel>(size_bits, out, xs, ys, headrooms))
+        return false;
+
+    for (int p = 0; p < 3; p++)
+    {
+        correlations_set_energies(corrs[p], buffer_energy(bufs[PAIR_A[p]]), buffer_energy(bufs[PAIR_B[p]]));
+        correlations_finish(corrs[p]);
+    }
+
+    return true;
+}
+
+extern "C" bool dsp_core_init_pair(struct correlations_t *corr,
+                                   const struct buffer_t *buf_a,
+                                   const struct buffer_t *buf_b)
+{
+    const struct buffer_t *const bufs[2] = {buf_a, buf_b};
+    if (!whole_frames(bufs, 2))
+        return false;
+
+    const int size_bits = buf_a->size_bits;
+    const int headroom = dot_product_headroom(buffer_peak(buf_a), buffer_peak(buf_b));
+
+    power_t *out = corr->correlations;
+    bool done = false;
+
+    if (corr->max_shift == MAX_SHIFT_AB_SAMPLES)
+        done = dispatch<pair_kernel<MAX_SHIFT_AB_SAMPLES>>(size_bits, out, buf_a->buffer, buf_b->buffer, headroom);
+    else if (corr->max_shift == MAX_SHIFT_AC_SAMPLES)
+        done = dispatch<pair_kernel<MAX_SHIFT_AC_SAMPLES>>(size_bits, out, buf_a->buffer, buf_b->buffer, headroom);
+    else if (corr->max_shift == MAX_SHIFT_BC_SAMPLES)
+        done = dispatch<pair_kernel<MAX_SHIFT_BC_SAMPLES>>(size_bits, out, buf_a->buffer, buf_b->buffer, headroom);
+
+    if (!done)
+        return false;
+
+    correlations_set_energies(corr, buffer_energy(buf_a), buffer_energy(buf_b));
+    correlations_finish(corr);
+    return true;
+}
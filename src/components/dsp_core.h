@@ -0,0 +1,35 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+#include <components/correlations.h>
+
+// C entry points to the compile-time specialised kernels in dsp_core.hpp,
+// instantiated for every frame length from BUFFER_MIN_SIZE_BITS to
+// BUFFER_MAX_SIZE_BITS and the pairs' MAX_SHIFT_*_SAMPLES ranges
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// buffer_window, with the frame length fixed at compile time
+void dsp_core_window(struct buffer_t *buf);
+
+// correlations_init_pairs for pairs (0, 1), (0, 2) and (1, 2). Returns
+// false, leaving corrs untouched, unless every frame spans its whole
+// length and each pair has its compiled lag range
+bool dsp_core_init_pairs(
+    struct correlations_t *const corrs[3],
+    const struct buffer_t *const bufs[3]);
+
+// correlations_init for one pair, by the same rules, for when the pairs
+// are shared out between the cores
+bool dsp_core_init_pair(
+    struct correlations_t *corr,
+    const struct buffer_t *buf_a,
+    const struct buffer_t *buf_b);
+
+#ifdef __cplusplus
+}
+#endif
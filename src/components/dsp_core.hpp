@@ -0,0 +1,121 @@
+#pragma once
+
+// Header-only DSP kernels specialised at compile time on the frame
+// length, lag range and number of pairs. Every loop bound is a constant,
+// so the compiler can unroll and fold the index arithmetic that the C
+// path has to recompute from struct fields at run time
+
+#include <stdint.h>
+#include <utility>
+
+extern "C"
+{
+#include <components/constants.h>
+#include <components/window_function.h>
+}
+
+namespace dsp
+{
+
+// Products summed in int32 before each spill to 64 bits, as in
+// dot_product_c; 1 spills every product, which is always exact, and 2
+// suits full-scale ADC samples
+constexpr int SAFE_BLOCK = 1;
+constexpr int PAIR_BLOCK = 2;
+constexpr int FAST_BLOCK = 8;
+
+// Window table stretched or decimated to 2^SizeBits samples, in place
+template <int SizeBits>
+inline void window(sample_t *x)
+{
+    constexpr int size = 1 << SizeBits;
+
+    for (int i = 0; i < size; i++)
+    {
+        int w;
+        if constexpr (SizeBits <= WINDOW_FUNCTION_SIZE_BITS)
+            w = i << (WINDOW_FUNCTION_SIZE_BITS - SizeBits);
+        else
+            w = i >> (SizeBits - WINDOW_FUNCTION_SIZE_BITS);
+
+        x[i] = (sample_t)(((int32_t)x[i] * WINDOW_FUNCTION[w]) >> 15);
+    }
+}
+
+// Exact sum of a[i] * b[i] for 0 <= i < n, Block products at a time in
+// int32; Block must not exceed the pair's dot_product_headroom
+template <int Block>
+inline power_t dot(const sample_t *a, const sample_t *b, int n)
+{
+    power_t acc = 0;
+    int i = 0;
+
+    if constexpr (Block > 1)
+    {
+        for (; i + Block <= n; i += Block)
+        {
+            int32_t block = 0;
+            for (int j = 0; j < Block; j++)
+                block += (int32_t)a[i + j] * b[i + j];
+            acc += block;
+        }
+    }
+
+    for (; i < n; i++)
+        acc += (int32_t)a[i] * b[i];
+
+    return acc;
+}
+
+// corr[s + Centre] = sum of a[i] * b[i + s] over a whole frame of
+// 2^SizeBits samples, for -MaxShift <= s <= MaxShift
+template <int SizeBits, int MaxShift, int Block, int Centre = MAX_SHIFT_SAMPLES>
+inline void correlate(power_t *corr, const sample_t *a, const sample_t *b)
+{
+    constexpr int size = 1 << SizeBits;
+    static_assert(MaxShift <= Centre, "lag range exceeds the correlation storage");
+    static_assert(MaxShift < size, "lag range exceeds the frame");
+
+    for (int s = -MaxShift; s < 0; s++)
+        corr[s + Centre] = dot<Block>(a - s, b, size + s);
+
+    for (int s = 0; s <= MaxShift; s++)
+        corr[s + Centre] = dot<Block>(a, b + s, size - s);
+}
+
+// Lag of the largest of corr[s + Centre], -MaxShift <= s <= MaxShift;
+// the first on ties
+template <int MaxShift, int Centre = MAX_SHIFT_SAMPLES>
+inline int argmax(const power_t *corr)
+{
+    int best = -MaxShift;
+
+    for (int s = -MaxShift + 1; s <= MaxShift; s++)
+        if (corr[s + Centre] > corr[best + Centre])
+            best = s;
+
+    return best;
+}
+
+// correlate with the longest blocking the pair's headroom allows
+template <int SizeBits, int MaxShift>
+inline void correlate_pair(power_t *corr, const sample_t *a, const sample_t *b, int headroom)
+{
+    if (headroom >= FAST_BLOCK)
+        correlate<SizeBits, MaxShift, FAST_BLOCK>(corr, a, b);
+    else if (headroom >= PAIR_BLOCK)
+        correlate<SizeBits, MaxShift, PAIR_BLOCK>(corr, a, b);
+    else
+        correlate<SizeBits, MaxShift, SAFE_BLOCK>(corr, a, b);
+}
+
+// One correlate_pair per pair, pair p having lag range MaxShifts[p]
+template <int SizeBits, int... MaxShifts>
+inline void correlate_pairs(power_t *const corrs[], const sample_t *const xs[],
+                            const sample_t *const ys[], const int headrooms[])
+{
+    int p = 0;
+    ((correlate_pair<SizeBits, MaxShifts>(corrs[p], xs[p], ys[p], headrooms[p]), p++), ...);
+}
+
+} // namespace dsp
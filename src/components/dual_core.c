@@ -0,0 +1,94 @@
+#include <components/dual_core.h>
+
+#include <stdint.h>
+
+#if PICO_ON_DEVICE
+
+#include <pico/multicore.h>
+
+static void dual_core_worker(void)
+{
+    while (true)
+    {
+        const struct dual_core_task_t *task =
+            (const struct dual_core_task_t *)multicore_fifo_pop_blocking();
+
+        task->run(task->arg);
+        multicore_fifo_push_blocking(0);
+    }
+}
+
+void dual_core_init(void)
+{
+    multicore_launch_core1(dual_core_worker);
+}
+
+void dual_core_start(const struct dual_core_task_t *task)
+{
+    multicore_fifo_push_blocking((uint32_t)task);
+}
+
+void dual_core_join(void)
+{
+    multicore_fifo_pop_blocking();
+}
+
+#else
+
+#include <pthread.h>
+
+// One-slot mailbox in place of the FIFO
+static pthread_mutex_t dual_core_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dual_core_wake = PTHREAD_COND_INITIALIZER;
+static const struct dual_core_task_t *dual_core_pending;
+static bool dual_core_done;
+
+static void *dual_core_worker(void *unused)
+{
+    (void)unused;
+
+    while (true)
+    {
+        pthread_mutex_lock(&dual_core_lock);
+        while (dual_core_pending == NULL)
+            pthread_cond_wait(&dual_core_wake, &dual_core_lock);
+        const struct dual_core_task_t *task = dual_core_pending;
+        pthread_mutex_unlock(&dual_core_lock);
+
+        task->run(task->arg);
+
+        pthread_mutex_lock(&dual_core_lock);
+        dual_core_pending = NULL;
+        dual_core_done = true;
+        pthread_cond_broadcast(&dual_core_wake);
+        pthread_mutex_unlock(&dual_core_lock);
+    }
+
+    return NULL;
+}
+
+void dual_core_init(void)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, dual_core_worker, NULL);
+    pthread_detach(thread);
+}
+
+void dual_core_start(const struct dual_core_task_t *task)
+{
+    pthread_mutex_lock(&dual_core_lock);
+    dual_core_done = false;
+    dual_core_pending = task;
+    pthread_cond_broadcast(&dual_core_wake);
+    pthread_mutex_unlock(&dual_core_lock);
+}
+
+void dual_core_join(void)
+{
+    pthread_mutex_lock(&dual_core_lock);
+    while (!dual_core_done)
+        pthread_cond_wait(&dual_core_wake, &dual_core_lock);
+    pthread_mutex_unlock(&dual_core_lock);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Runs one task at a time on core 1 while core 0 does its own share.
+// On the RP2040 tasks travel through the multicore FIFO; elsewhere a
+// thread stands in for core 1 so the same code can run on a host
+struct dual_core_task_t
+{
+    void (*run)(void *arg);
+    void *arg;
+};
+
+// Starts the core 1 worker; call once before any task
+void dual_core_init(void);
+
+// Hands a task to core 1 and returns at once. The task must stay valid
+// until dual_core_join returns
+void dual_core_start(const struct dual_core_task_t *task);
+
+// Waits for the task given to dual_core_start to finish
+void dual_core_join(void);
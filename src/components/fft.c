@@ -0,0 +1,210 @@
+#include <components/fft.h>
+
+#include <math.h>
+
+#define FFT_QUARTER (FFT_MAX_SIZE >> 2)
+
+// Largest component a butterfly input may have before |u| + sqrt(2) |t|
+// could leave the int16 range: 32767 / (1 + sqrt(2))
+#define FFT_SAFE_MAX 13573
+
+// sin(2 pi i / FFT_MAX_SIZE) for the first quarter wave, Q15
+static int16_t fft_sine[FFT_QUARTER + 1];
+
+void fft_init(void)
+{
+    for (int i = 0; i <= FFT_QUARTER; i++)
+    {
+        int32_t value = (int32_t)roundf(sinf(2.0f * (float)M_PI * i / FFT_MAX_SIZE) * 32768.0f);
+        fft_sine[i] = (int16_t)(value > INT16_MAX ? INT16_MAX : value);
+    }
+}
+
+// cos and sin of 2 pi k / 2^size_bits, for 0 <= k < 2^(size_bits - 1)
+static inline void fft_twiddle(int k, int size_bits, int32_t *c, int32_t *s)
+{
+    const int idx = k << (FFT_MAX_SIZE_BITS - size_bits);
+
+    if (idx <= FFT_QUARTER)
+    {
+        *c = fft_sine[FFT_QUARTER - idx];
+        *s = fft_sine[idx];
+    }
+    else
+    {
+        *c = -fft_sine[idx - FFT_QUARTER];
+        *s = fft_sine[2 * FFT_QUARTER - idx];
+    }
+}
+
+static int32_t fft_peak(const complex_q15_t *data, int count)
+{
+    int32_t peak = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int32_t re = data[i].re;
+        int32_t im = data[i].im;
+        re = (re < 0 ? -re : re);
+        im = (im < 0 ? -im : im);
+
+        if (re > peak)
+            peak = re;
+        if (im > peak)
+            peak = im;
+    }
+
+    return peak;
+}
+
+// Right shift needed on the next pass so that no output can overflow
+static int fft_headroom_shift(int32_t peak)
+{
+    return (peak <= FFT_SAFE_MAX ? 0 : peak <= 2 * FFT_SAFE_MAX ? 1 : 2);
+}
+
+static void fft_bit_reverse(complex_q15_t *data, int size_bits)
+{
+    const int n = 1 << size_bits;
+
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+        {
+            const complex_q15_t tmp = data[i];
+            data[i] = data[j];
+            data[j] = tmp;
+        }
+    }
+}
+
+int fft_complex(complex_q15_t *data, int size_bits, bool inverse)
+{
+    const int n = 1 << size_bits;
+    int exponent = 0;
+
+    fft_bit_reverse(data, size_bits);
+
+    for (int stage = 1; stage <= size_bits; stage++)
+    {
+        const int half = 1 << (stage - 1);
+        const int shift = fft_headroom_shift(fft_peak(data, n));
+        const int32_t round = (1 << shift) >> 1;
+        exponent += shift;
+
+        for (int j = 0; j < half; j++)
+        {
+            int32_t wr, wi;
+            fft_twiddle(j, stage, &wr, &wi);
+            if (!inverse)
+                wi = -wi;
+
+            for (int i = j; i < n; i += 2 * half)
+            {
+                complex_q15_t *u = data + i;
+                complex_q15_t *v = data + i + half;
+
+                // |w| <= 1 keeps both products' sum below 2^31
+                const int32_t tr = (wr * v->re - wi * v->im + (1 << 14)) >> 15;
+                const int32_t ti = (wr * v->im + wi * v->re + (1 << 14)) >> 15;
+                const int32_t ur = u->re;
+                const int32_t ui = u->im;
+
+                u->re = (int16_t)((ur + tr + round) >> shift);
+                u->im = (int16_t)((ui + ti + round) >> shift);
+                v->re = (int16_t)((ur - tr + round) >> shift);
+                v->im = (int16_t)((ui - ti + round) >> shift);
+            }
+        }
+    }
+
+    return exponent;
+}
+
+int fft_real_forward(complex_q15_t *data, int size_bits)
+{
+    const int m = 1 << (size_bits - 1);
+
+    int exponent = fft_complex(data, size_bits - 1, false);
+
+    const int shift = fft_headroom_shift(fft_peak(data, m));
+    const int32_t round = (1 << shift) >> 1;
+    exponent += shift;
+
+    const int32_t z0r = data[0].re;
+    const int32_t z0i = data[0].im;
+    data[0].re = (int16_t)((z0r + z0i + round) >> shift);
+    data[0].im = (int16_t)((z0r - z0i + round) >> shift);
+
+    // Split the half-length spectrum Z into the even (Xe) and odd (Xo)
+    // sample spectra and recombine: X[k] = Xe[k] + W^k Xo[k] and
+    // X[m - k] = conj(Xe[k] - W^k Xo[k])
+    for (int k = 1; k <= m / 2; k++)
+    {
+        complex_q15_t *a = data + k;
+        complex_q15_t *b = data + m - k;
+
+        const int32_t e_re = (a->re + b->re + 1) >> 1;
+        const int32_t e_im = (a->im - b->im + 1) >> 1;
+        const int32_t o_re = (a->im + b->im + 1) >> 1;
+        const int32_t o_im = (b->re - a->re + 1) >> 1;
+
+        int32_t c, s;
+        fft_twiddle(k, size_bits, &c, &s);
+
+        const int32_t tr = (c * o_re + s * o_im + (1 << 14)) >> 15;
+        const int32_t ti = (c * o_im - s * o_re + (1 << 14)) >> 15;
+
+        b->re = (int16_t)((e_re - tr + round) >> shift);
+        b->im = (int16_t)((ti - e_im + round) >> shift);
+        a->re = (int16_t)((e_re + tr + round) >> shift);
+        a->im = (int16_t)((e_im + ti + round) >> shift);
+    }
+
+    return exponent;
+}
+
+int fft_real_inverse(complex_q15_t *data, int size_bits)
+{
+    const int m = 1 << (size_bits - 1);
+
+    const int shift = fft_headroom_shift(fft_peak(data, m));
+    const int32_t round = (1 << shift) >> 1;
+    int exponent = shift;
+
+    const int32_t x0 = data[0].re;
+    const int32_t xn = data[0].im;
+    data[0].re = (int16_t)((((x0 + xn + 1) >> 1) + round) >> shift);
+    data[0].im = (int16_t)((((x0 - xn + 1) >> 1) + round) >> shift);
+
+    // Undo the split: Xe = (X[k] + conj X[m - k]) / 2,
+    // Xo = conj(W^k) (X[k] - conj X[m - k]) / 2, Z[k] = Xe + j Xo
+    for (int k = 1; k <= m / 2; k++)
+    {
+        complex_q15_t *a = data + k;
+        complex_q15_t *b = data + m - k;
+
+        const int32_t e_re = (a->re + b->re + 1) >> 1;
+        const int32_t e_im = (a->im - b->im + 1) >> 1;
+        const int32_t d_re = (a->re - b->re + 1) >> 1;
+        const int32_t d_im = (a->im + b->im + 1) >> 1;
+
+        int32_t c, s;
+        fft_twiddle(k, size_bits, &c, &s);
+
+        const int32_t o_re = (c * d_re - s * d_im + (1 << 14)) >> 15;
+        const int32_t o_im = (c * d_im + s * d_re + (1 << 14)) >> 15;
+
+        b->re = (int16_t)((e_re + o_im + round) >> shift);
+        b->im = (int16_t)((o_re - e_im + round) >> shift);
+        a->re = (int16_t)((e_re - o_im + round) >> shift);
+        a->im = (int16_t)((e_im + o_re + round) >> shift);
+    }
+
+    return exponent + fft_complex(data, size_bits - 1, true);
+}
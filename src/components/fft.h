@@ -0,0 +1,27 @@
+#pragma once
+
+#include <components/constants.h>
+
+// Largest transform (real or complex) the twiddle table covers
+#define FFT_MAX_SIZE_BITS 12
+#define FFT_MAX_SIZE (1 << FFT_MAX_SIZE_BITS)
+
+typedef struct
+{
+    int16_t re;
+    int16_t im;
+} complex_q15_t;
+
+void fft_init(void);
+
+// In-place radix-2 transforms on Q15 data with block floating point.
+// Each returns the number of right shifts applied to keep the data in
+// range, so the true result is the output scaled by 2^return. Neither
+// direction divides by the length.
+int fft_complex(complex_q15_t *data, int size_bits, bool inverse);
+
+// Real transforms of 2^size_bits samples stored in place as half as many
+// complex values. The spectrum is packed with X[0] in data[0].re,
+// X[N/2] in data[0].im and X[k] in data[k] for 0 < k < N/2.
+int fft_real_forward(complex_q15_t *data, int size_bits);
+int fft_real_inverse(complex_q15_t *data, int size_bits);
@@ -0,0 +1,573 @@
+#include <components/fft_correlation.h>
+#include <components/fixed_math.h>
+
+// Weighted bins are scaled to GCC_UNIT at unit weight; SCOT and ML weights
+// are capped at GCC_MAX_WEIGHT_Q4 / 16 of that
+#define GCC_UNIT_BITS 11
+#define GCC_UNIT (1 << GCC_UNIT_BITS)
+#define GCC_MAX_WEIGHT_Q4 240
+
+// SCOT and ML smooth their spectra over bands of this many bins. Wider
+// bands lose coherence to the phase slope of large delays
+#define GCC_BAND_BITS 2
+#define GCC_BAND (1 << GCC_BAND_BITS)
+
+// Weighted correlations carry this many fractional bits
+#define GCC_OUTPUT_BITS 16
+
+static complex_q15_t fft_correlation_work[FFT_CORRELATION_MAX_SIZE];
+
+static inline int16_t saturate_q15(int32_t value)
+{
+    return (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+}
+
+// One bin of two spectra and of their cross-spectrum
+struct gcc_bin_t
+{
+    int32_t ar, ai;
+    int32_t br, bi;
+
+    // conj(A) B at half scale, which keeps the sum of two products in int32
+    int32_t cr, ci;
+};
+
+static inline void gcc_bin(const complex_q15_t *a, const complex_q15_t *b, struct gcc_bin_t *bin)
+{
+    bin->ar = a->re;
+    bin->ai = a->im;
+    bin->br = b->re;
+    bin->bi = b->im;
+
+    bin->cr = ((bin->ar * bin->br) >> 1) + ((bin->ai * bin->bi) >> 1);
+    bin->ci = ((bin->ar * bin->bi) >> 1) - ((bin->ai * bin->br) >> 1);
+}
+
+// Replaces the cross-spectrum by its phase at the given magnitude
+static inline void gcc_set_phase(complex_q15_t *out, const struct gcc_bin_t *bin, int32_t magnitude)
+{
+    const uint32_t cr_abs = (uint32_t)(bin->cr < 0 ? -bin->cr : bin->cr);
+    const uint32_t ci_abs = (uint32_t)(bin->ci < 0 ? -bin->ci : bin->ci);
+
+    int shift = fixed_bit_length(cr_abs > ci_abs ? cr_abs : ci_abs) - 15;
+    if (shift < 0)
+        shift = 0;
+
+    const int32_t cr = bin->cr >> shift;
+    const int32_t ci = bin->ci >> shift;
+    const int32_t norm = (int32_t)fixed_magnitude(cr, ci);
+
+    if (norm == 0 || magnitude == 0)
+    {
+        out->re = 0;
+        out->im = 0;
+        return;
+    }
+
+    out->re = saturate_q15(cr * magnitude / norm);
+    out->im = saturate_q15(ci * magnitude / norm);
+}
+
+static int32_t peak_component(const complex_q15_t *data, int count)
+{
+    int32_t peak = 0;
+
+    for (int k = 0; k < count; k++)
+    {
+        const int32_t re = (data[k].re < 0 ? -data[k].re : data[k].re);
+        const int32_t im = (data[k].im < 0 ? -data[k].im : data[k].im);
+        peak = (re > peak ? re : peak);
+        peak = (im > peak ? im : peak);
+    }
+
+    return peak;
+}
+
+// Unweighted cross-spectrum, scaled to fit Q15; returns the number of bits
+// it sits below conj(A) B
+static int gcc_plain(const complex_q15_t *a, const complex_q15_t *b, complex_q15_t *out, int half)
+{
+    const uint32_t peak = (uint32_t)peak_component(a, half) * (uint32_t)peak_component(b, half);
+
+    int product_shift = 0;
+    while (product_shift < 16 && (peak >> product_shift) > INT16_MAX / 2)
+        product_shift++;
+
+    // DC and Nyquist are real and packed together in bin 0
+    const int32_t c0 = ((int32_t)a[0].re * b[0].re) >> product_shift;
+    const int32_t cn = ((int32_t)a[0].im * b[0].im) >> product_shift;
+
+    for (int k = 1; k < half; k++)
+    {
+        struct gcc_bin_t bin;
+        gcc_bin(a + k, b + k, &bin);
+
+        out[k].re = saturate_q15(product_shift > 0 ? bin.cr >> (product_shift - 1) : bin.cr << 1);
+        out[k].im = saturate_q15(product_shift > 0 ? bin.ci >> (product_shift - 1) : bin.ci << 1);
+    }
+
+    out[0].re = saturate_q15(c0);
+    out[0].im = saturate_q15(cn);
+
+    return product_shift;
+}
+
+// GCC weight of one bin, as the magnitude its cross-spectrum is set to
+static int32_t gcc_magnitude(const struct gcc_bin_t *bin,
+                             uint32_t coherence_q14, uint32_t rms_a, uint32_t rms_b)
+{
+    switch (GCC_WEIGHTING)
+    {
+    case GCC_WEIGHTING_SCOT:
+    {
+        // |A| |B| / sqrt(Saa Sbb), with the auto-spectra Saa and Sbb
+        // averaged over the band, as |A| / sqrt(Saa) times |B| / sqrt(Sbb)
+        if (rms_a == 0 || rms_b == 0)
+            return 0;
+
+        const uint32_t ra = (fixed_magnitude(bin->ar, bin->ai) << 8) / rms_a;
+        const uint32_t rb = (fixed_magnitude(bin->br, bin->bi) << 8) / rms_b;
+
+        uint32_t weight_q4 = (ra * rb) >> 12;
+        if (weight_q4 > GCC_MAX_WEIGHT_Q4)
+            weight_q4 = GCC_MAX_WEIGHT_Q4;
+
+        return (int32_t)((GCC_UNIT * weight_q4) >> 4);
+    }
+
+    case GCC_WEIGHTING_ML:
+    {
+        // Hannan-Thomson: gamma^2 / (1 - gamma^2), over the PHAT magnitude
+        const uint32_t gamma2 = (coherence_q14 * coherence_q14) >> 14;
+        if (gamma2 >= (1 << 14))
+            return (GCC_UNIT * GCC_MAX_WEIGHT_Q4) >> 4;
+
+        uint32_t weight_q4 = (gamma2 << 4) / ((1 << 14) - gamma2);
+        if (weight_q4 > GCC_MAX_WEIGHT_Q4)
+            weight_q4 = GCC_MAX_WEIGHT_Q4;
+
+        return (int32_t)((GCC_UNIT * weight_q4) >> 4);
+    }
+
+    default:
+        return GCC_UNIT;
+    }
+}
+
+// Weighted cross-spectrum. DC and Nyquist carry no delay information and
+// are dropped
+static void gcc_weighted(const complex_q15_t *a, const complex_q15_t *b, complex_q15_t *out, int half)
+{
+    for (int k0 = 1; k0 < half; k0 += GCC_BAND)
+    {
+        const int k1 = (k0 + GCC_BAND < half ? k0 + GCC_BAND : half);
+
+        // Band statistics: auto-spectra summed over the band, and the
+        // coherence |sum C| / sum |C| of the cross-spectrum's phase
+        int32_t sum_cr = 0, sum_ci = 0;
+        uint32_t sum_c = 0;
+        uint64_t sum_aa = 0, sum_bb = 0;
+
+        for (int k = k0; k < k1; k++)
+        {
+            struct gcc_bin_t bin;
+            gcc_bin(a + k, b + k, &bin);
+
+            sum_cr += bin.cr >> (1 + GCC_BAND_BITS);
+            sum_ci += bin.ci >> (1 + GCC_BAND_BITS);
+            sum_c += fixed_magnitude(bin.cr >> (1 + GCC_BAND_BITS), bin.ci >> (1 + GCC_BAND_BITS));
+            if (GCC_WEIGHTING == GCC_WEIGHTING_SCOT)
+            {
+                sum_aa += (uint64_t)(bin.ar * bin.ar) + (uint64_t)(bin.ai * bin.ai);
+                sum_bb += (uint64_t)(bin.br * bin.br) + (uint64_t)(bin.bi * bin.bi);
+            }
+        }
+
+        // Root mean power of each spectrum over the band, for SCOT
+        const uint32_t count = (uint32_t)(k1 - k0);
+        const uint32_t rms_a = (GCC_WEIGHTING == GCC_WEIGHTING_SCOT ? fixed_isqrt64(sum_aa / count) : 0);
+        const uint32_t rms_b = (GCC_WEIGHTING == GCC_WEIGHTING_SCOT ? fixed_isqrt64(sum_bb / count) : 0);
+
+        uint32_t coherent = fixed_magnitude(sum_cr, sum_ci);
+        int shift = fixed_bit_length(sum_c) - 17;
+        if (shift > 0)
+        {
+            coherent >>= shift;
+            sum_c >>= shift;
+        }
+
+        uint32_t coherence_q14 = (sum_c ? (coherent << 14) / sum_c : 0);
+        if (coherence_q14 > (1 << 14))
+            coherence_q14 = 1 << 14;
+
+        // out may alias a: each bin is read again just before it is written
+        for (int k = k0; k < k1; k++)
+        {
+            struct gcc_bin_t bin;
+            gcc_bin(a + k, b + k, &bin);
+            gcc_set_phase(out + k, &bin, gcc_magnitude(&bin, coherence_q14, rms_a, rms_b));
+        }
+    }
+
+    out[0].re = 0;
+    out[0].im = 0;
+}
+
+// Separates Z = FFT(a + j b) into the packed half spectra of a and b:
+// A = (Z[k] + conj Z[m - k]) / 2, B = (Z[k] - conj Z[m - k]) / 2j.
+// Bins k and m/2 - k are done together, so a = z, b = z + m/2 works in place
+static void fft_correlation_split(const complex_q15_t *z, int m, complex_q15_t *a, complex_q15_t *b)
+{
+    const int half = m / 2;
+    const complex_q15_t z0 = z[0];
+    const complex_q15_t zh = z[half];
+
+    for (int k = 1; k <= half / 2; k++)
+    {
+        const int idx[2] = {k, half - k};
+        complex_q15_t zk[2], zm[2];
+
+        for (int i = 0; i < 2; i++)
+        {
+            zk[i] = z[idx[i]];
+            zm[i] = z[m - idx[i]];
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+            const int32_t zr = zk[i].re, zi = zk[i].im;
+            const int32_t wr = zm[i].re, wi = zm[i].im;
+
+            a[idx[i]].re = (int16_t)((zr + wr + 1) >> 1);
+            a[idx[i]].im = (int16_t)((zi - wi + 1) >> 1);
+            b[idx[i]].re = (int16_t)((zi + wi + 1) >> 1);
+            b[idx[i]].im = (int16_t)((wr - zr + 1) >> 1);
+        }
+    }
+
+    a[0].re = z0.re;
+    a[0].im = zh.re;
+    b[0].re = z0.im;
+    b[0].im = zh.im;
+}
+
+// Inverse transforms a packed cross-spectrum of 2^size_bits points, 2^scale
+// below the correlation, and adds lags -max_shift..max_shift of the
+// circular result to correlations[]. Returns the height the correlation
+// would reach with every bin in phase, on the same scale. out is
+// overwritten
+static power_t fft_correlation_inverse(power_t *correlations, int max_shift, int size_bits, int scale,
+                                       complex_q15_t *out)
+{
+    const int m = 1 << size_bits;
+
+    // Packed DC and Nyquist count once, every other bin with its mirror
+    power_t in_phase = (out[0].re < 0 ? -out[0].re : out[0].re) + (out[0].im < 0 ? -out[0].im : out[0].im);
+    for (int k = 1; k < m / 2; k++)
+        in_phase += 2 * fixed_magnitude(out[k].re, out[k].im);
+
+    // The real inverse returns half the unnormalised sum; the correlation
+    // is that sum over m
+    const int shift = fft_real_inverse(out, size_bits) + 1 - size_bits + scale;
+
+    const int16_t *r = (const int16_t *)out;
+    for (int s = -max_shift; s <= max_shift; s++)
+    {
+        const power_t value = r[s < 0 ? m + s : s];
+        correlations[s + MAX_SHIFT_SAMPLES] += (shift >= 0 ? value << shift : value >> -shift);
+    }
+
+    // The inverse's own shifts cancel from the full-scale sum
+    const int in_phase_shift = scale - size_bits;
+    return (in_phase_shift >= 0 ? in_phase << in_phase_shift : in_phase >> -in_phase_shift);
+}
+
+// Cross-correlates two packed half spectra of 2^size_bits points, scaled by
+// 2^exponent, through fft_correlation_inverse. out may alias a
+static power_t fft_correlation_cross(power_t *correlations, int max_shift, int size_bits, int exponent,
+                                     const complex_q15_t *a, const complex_q15_t *b, complex_q15_t *out)
+{
+    const int m = 1 << size_bits;
+
+    // The correlation is real, so only bins 0..m/2 are formed, packed
+    // for fft_real_inverse
+    int scale;
+    if (GCC_WEIGHTING == GCC_WEIGHTING_NONE)
+        scale = gcc_plain(a, b, out, m / 2) + exponent;
+    else
+    {
+        gcc_weighted(a, b, out, m / 2);
+        scale = GCC_OUTPUT_BITS - GCC_UNIT_BITS;
+    }
+
+    return fft_correlation_inverse(correlations, max_shift, size_bits, scale, out);
+}
+
+void fft_correlations_init(struct correlations_t *corr,
+                           const struct buffer_t *buf_a,
+                           const struct buffer_t *buf_b)
+{
+    complex_q15_t *z = fft_correlation_work;
+    const int span = buf_a->end - buf_a->start;
+    const int max_shift = corr->max_shift;
+
+    // Smallest transform that holds the whole span plus the lag context,
+    // otherwise the largest one and several segments
+    int size_bits = 1;
+    while (size_bits < FFT_CORRELATION_MAX_SIZE_BITS && (1 << size_bits) < span + 2 * max_shift)
+        size_bits++;
+
+    const int m = 1 << size_bits;
+    const int block = m - 2 * max_shift;
+
+    for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+        corr->correlations[i] = 0;
+    corr->coherent_peak = 0;
+
+    for (int p = buf_a->start; p < buf_a->end; p += block)
+    {
+        const int n = (buf_a->end - p < block ? buf_a->end - p : block);
+
+        // a[p .. p + n) sits at max_shift and b[p - max_shift ..
+        // p + n + max_shift) at 0, so no lag in range wraps around
+        const int base = p - max_shift;
+        const int lo = (buf_b->start > base ? buf_b->start : base);
+        const int hi = (buf_b->end < p + n + max_shift ? buf_b->end : p + n + max_shift);
+
+        for (int i = 0; i < m; i++)
+        {
+            z[i].re = 0;
+            z[i].im = 0;
+        }
+        for (int i = 0; i < n; i++)
+            z[max_shift + i].re = buf_a->buffer[p + i];
+        for (int j = lo; j < hi; j++)
+            z[j - base].im = buf_b->buffer[j];
+
+        // Both channels go through one complex transform
+        const int exponent = fft_complex(z, size_bits, false);
+        fft_correlation_split(z, m, z, z + m / 2);
+        corr->coherent_peak += fft_correlation_cross(corr->correlations, max_shift, size_bits, 2 * exponent, z, z + m / 2, z);
+    }
+
+    correlations_finish(corr);
+}
+
+bool spectra_prepare(struct spectra_t *spectra, const struct buffer_t *const bufs[], int count)
+{
+    // Every channel is transformed at the same offset, so the union of
+    // the active spans plus the lag range must fit one transform
+    int lo = bufs[0]->start, hi = bufs[0]->end;
+    for (int c = 1; c < count; c++)
+    {
+        lo = (bufs[c]->start < lo ? bufs[c]->start : lo);
+        hi = (bufs[c]->end > hi ? bufs[c]->end : hi);
+    }
+
+    int size_bits = 2;
+    while ((1 << size_bits) < hi - lo + MAX_SHIFT_SAMPLES)
+        size_bits++;
+
+    spectra->count = 0;
+    if (count > SPECTRA_MAX_CHANNELS || size_bits > FFT_CORRELATION_MAX_SIZE_BITS)
+        return false;
+
+    spectra->count = count;
+    spectra->size_bits = size_bits;
+    spectra->offset = lo;
+    spectra->length = hi - lo;
+    return true;
+}
+
+void spectra_transform(struct spectra_t *spectra, const struct buffer_t *const bufs[], int c)
+{
+    const int m = 1 << spectra->size_bits;
+    const int lo = spectra->offset;
+    const int length = spectra->length;
+
+    // Two channels per complex transform
+    if (c + 1 < spectra->count)
+    {
+        complex_q15_t *z = fft_correlation_work;
+
+        for (int i = 0; i < m; i++)
+        {
+            z[i].re = (i < length ? bufs[c]->buffer[lo + i] : 0);
+            z[i].im = (i < length ? bufs[c + 1]->buffer[lo + i] : 0);
+        }
+
+        const int exponent = fft_complex(z, spectra->size_bits, false);
+        fft_correlation_split(z, m, spectra->bins[c], spectra->bins[c + 1]);
+
+        spectra->exponents[c] = exponent;
+        spectra->exponents[c + 1] = exponent;
+        return;
+    }
+
+    // An odd one out takes the real transform in place
+    int16_t *x = (int16_t *)spectra->bins[c];
+    for (int i = 0; i < m; i++)
+        x[i] = (i < length ? bufs[c]->buffer[lo + i] : 0);
+
+    spectra->exponents[c] = fft_real_forward(spectra->bins[c], spectra->size_bits);
+}
+
+bool spectra_compute(struct spectra_t *spectra, const struct buffer_t *const bufs[], int count)
+{
+    if (!spectra_prepare(spectra, bufs, count))
+        return false;
+
+    for (int c = 0; c < count; c += 2)
+        spectra_transform(spectra, bufs, c);
+
+    return true;
+}
+
+void spectra_correlate_with(const struct spectra_t *spectra, int a, int b,
+                            struct correlations_t *corr, complex_q15_t *scratch)
+{
+    for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+        corr->correlations[i] = 0;
+
+    corr->coherent_peak = fft_correlation_cross(corr->correlations, corr->max_shift, spectra->size_bits,
+                                                spectra->exponents[a] + spectra->exponents[b],
+                                                spectra->bins[a], spectra->bins[b], scratch);
+
+    correlations_finish(corr);
+}
+
+void spectra_correlate(const struct spectra_t *spectra, int a, int b, struct correlations_t *corr)
+{
+    spectra_correlate_with(spectra, a, b, corr, fft_correlation_work);
+}
+
+// Largest magnitude of any component of the average
+static uint32_t cross_spectrum_peak(const struct cross_spectrum_t *avg, int half)
+{
+    uint32_t peak = 0;
+
+    for (int k = 0; k < half; k++)
+    {
+        const uint32_t re = (uint32_t)(avg->re[k] < 0 ? -avg->re[k] : avg->re[k]);
+        const uint32_t im = (uint32_t)(avg->im[k] < 0 ? -avg->im[k] : avg->im[k]);
+        peak = (re > peak ? re : peak);
+        peak = (im > peak ? im : peak);
+    }
+
+    return peak;
+}
+
+// Moves the average to 2^shift coarser (or finer when negative) steps
+static void cross_spectrum_shift(struct cross_spectrum_t *avg, int half, int shift)
+{
+    for (int k = 0; k < half; k++)
+    {
+        avg->re[k] = (shift >= 0 ? avg->re[k] >> shift : avg->re[k] * (1 << -shift));
+        avg->im[k] = (shift >= 0 ? avg->im[k] >> shift : avg->im[k] * (1 << -shift));
+    }
+
+    avg->exponent += shift;
+}
+
+void cross_spectrum_accumulate(struct cross_spectrum_t *avg, const struct spectra_t *spectra, int a, int b)
+{
+    const int half = 1 << (spectra->size_bits - 1);
+    const int exponent = spectra->exponents[a] + spectra->exponents[b];
+    const complex_q15_t *bins_a = spectra->bins[a];
+    const complex_q15_t *bins_b = spectra->bins[b];
+
+    // A new frame length or a long gap starts the average over
+    const absolute_time_t now = get_absolute_time();
+    if (avg->size_bits != spectra->size_bits ||
+        absolute_time_diff_us(avg->last_update, now) >= (int64_t)CORRELATION_AVERAGE_RESET_US)
+    {
+        avg->size_bits = spectra->size_bits;
+        avg->exponent = exponent;
+        avg->frames = 0;
+    }
+
+    avg->last_update = now;
+
+    // Bring the average and the frame to the larger of their scales
+    if (exponent > avg->exponent)
+        cross_spectrum_shift(avg, half, exponent - avg->exponent);
+    const int frame_shift = avg->exponent - exponent;
+
+    // A running mean over the first frames, so the average does not start
+    // from zero, then a fixed 2^-CROSS_SPECTRUM_FORGET_BITS per frame
+    avg->frames++;
+    int forget = fixed_bit_length((uint32_t)avg->frames) - 1;
+    forget = (forget < CROSS_SPECTRUM_FORGET_BITS ? forget : CROSS_SPECTRUM_FORGET_BITS);
+
+    for (int k = 0; k < half; k++)
+    {
+        struct gcc_bin_t bin;
+        gcc_bin(bins_a + k, bins_b + k, &bin);
+
+        // DC and Nyquist are real and packed together in bin 0
+        if (k == 0)
+        {
+            bin.cr = (bin.ar * bin.br) >> 1;
+            bin.ci = (bin.ai * bin.bi) >> 1;
+        }
+
+        const int32_t cr = (frame_shift < 31 ? bin.cr >> frame_shift : 0);
+        const int32_t ci = (frame_shift < 31 ? bin.ci >> frame_shift : 0);
+
+        avg->re[k] += (int32_t)(((int64_t)cr - avg->re[k]) >> forget);
+        avg->im[k] += (int32_t)(((int64_t)ci - avg->im[k]) >> forget);
+    }
+
+    // Take back the bits a quieter stretch no longer needs, keeping the
+    // same headroom as a frame's own cross-spectrum
+    const int room = 30 - fixed_bit_length(cross_spectrum_peak(avg, half));
+    const int up = (room < avg->exponent - exponent ? room : avg->exponent - exponent);
+    if (up > 0)
+        cross_spectrum_shift(avg, half, -up);
+}
+
+void cross_spectrum_correlate(const struct cross_spectrum_t *avg, struct correlations_t *corr)
+{
+    complex_q15_t *out = fft_correlation_work;
+    const int half = 1 << (avg->size_bits - 1);
+
+    int scale;
+    if (GCC_WEIGHTING == GCC_WEIGHTING_NONE)
+    {
+        // The average sits at half scale, like gcc_bin's cross-spectrum
+        int shift = 0;
+        const uint32_t peak = cross_spectrum_peak(avg, half);
+        while ((peak >> shift) > INT16_MAX)
+            shift++;
+
+        for (int k = 0; k < half; k++)
+        {
+            out[k].re = (int16_t)(avg->re[k] >> shift);
+            out[k].im = (int16_t)(avg->im[k] >> shift);
+        }
+
+        scale = shift + 1 + avg->exponent;
+    }
+    else
+    {
+        // PHAT keeps only the averaged phase
+        for (int k = 1; k < half; k++)
+        {
+            struct gcc_bin_t bin = {0};
+            bin.cr = avg->re[k];
+            bin.ci = avg->im[k];
+            gcc_set_phase(out + k, &bin, GCC_UNIT);
+        }
+
+        out[0].re = 0;
+        out[0].im = 0;
+        scale = GCC_OUTPUT_BITS - GCC_UNIT_BITS;
+    }
+
+    for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+        corr->correlations[i] = 0;
+
+    corr->coherent_peak = fft_correlation_inverse(corr->correlations, corr->max_shift, avg->size_bits, scale, out);
+
+    correlations_finish(corr);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+#include <components/correlations.h>
+#include <components/fft.h>
+
+// Largest transform the engine uses. Frames that do not fit in one
+// transform are split into overlap-save segments, so any frame length
+// works with a fixed work buffer
+#define FFT_CORRELATION_MAX_SIZE_BITS 11
+#define FFT_CORRELATION_MAX_SIZE (1 << FFT_CORRELATION_MAX_SIZE_BITS)
+
+// Each segment needs MAX_SHIFT_SAMPLES of context on both sides
+#if FFT_CORRELATION_MAX_SIZE <= 4 * MAX_SHIFT_SAMPLES
+#error "FFT correlation size too small for the lag range"
+#endif
+
+#if CORRELATION_ENGINE != CORRELATION_ENGINE_FFT && GCC_WEIGHTING != GCC_WEIGHTING_NONE
+#error "GCC weighting needs the FFT correlation engine"
+#endif
+
+// Same result as correlations_init, computed through the spectrum, with
+// the cross-spectrum optionally weighted by GCC_WEIGHTING
+void fft_correlations_init(
+    struct correlations_t *corr,
+    const struct buffer_t *buf_a,
+    const struct buffer_t *buf_b);
+
+// Per-frame spectrum cache: every channel is transformed once, two real
+// channels per complex transform, and each pair needs only a
+// cross-spectrum and one inverse
+#define SPECTRA_MAX_CHANNELS 3
+
+struct spectra_t
+{
+    int count;
+    int size_bits;
+
+    // Span of the frames that was transformed
+    int offset;
+    int length;
+
+    // Packed half spectra as from fft_real_forward, each scaled by
+    // 2^exponents[c]
+    int exponents[SPECTRA_MAX_CHANNELS];
+    complex_q15_t bins[SPECTRA_MAX_CHANNELS][FFT_CORRELATION_MAX_SIZE / 2];
+};
+
+// Room for one spectra_correlate_with call
+typedef complex_q15_t spectra_scratch_t[FFT_CORRELATION_MAX_SIZE / 2];
+
+// Transforms every buffer; false if their spans are too long for the cache,
+// in which case fft_correlations_init still handles each pair
+bool spectra_compute(struct spectra_t *spectra, const struct buffer_t *const bufs[], int count);
+
+// spectra_compute in steps, for callers that spread the channels over
+// cores: spectra_prepare sizes the transform, then spectra_transform does
+// channel c, together with c + 1 when c is even and c + 1 exists. Paired
+// channels share one work buffer, so only one pair may run at a time
+bool spectra_prepare(struct spectra_t *spectra, const struct buffer_t *const bufs[], int count);
+void spectra_transform(struct spectra_t *spectra, const struct buffer_t *const bufs[], int c);
+
+// Same result as fft_correlations_init(corr, bufs[a], bufs[b])
+void spectra_correlate(const struct spectra_t *spectra, int a, int b, struct correlations_t *corr);
+
+// The same with caller-provided scratch, so calls can run concurrently
+void spectra_correlate_with(const struct spectra_t *spectra, int a, int b,
+                            struct correlations_t *corr, complex_q15_t *scratch);
+
+#if CROSS_SPECTRUM_AVERAGING && GCC_WEIGHTING != GCC_WEIGHTING_NONE && GCC_WEIGHTING != GCC_WEIGHTING_PHAT
+#error "Averaged cross-spectra are weighted by PHAT or not at all"
+#endif
+
+// One pair's cross-spectrum conj(A) B averaged over frames, at half scale
+// and 2^exponent, packed like the spectra it comes from; starts zeroed
+struct cross_spectrum_t
+{
+    // Transform size of the frames averaged so far; 0 while empty
+    int size_bits;
+    int exponent;
+    int frames;
+    absolute_time_t last_update;
+
+    int32_t re[FFT_CORRELATION_MAX_SIZE / 2];
+    int32_t im[FFT_CORRELATION_MAX_SIZE / 2];
+};
+
+// Folds the cross-spectrum of channels a and b of spectra into the
+// average, forgetting 2^-CROSS_SPECTRUM_FORGET_BITS of it per frame.
+// Starts over when the transform size changes or after
+// CORRELATION_AVERAGE_RESET_S without a frame, as correlations_average
+void cross_spectrum_accumulate(struct cross_spectrum_t *avg, const struct spectra_t *spectra, int a, int b);
+
+// Correlation of the averaged cross-spectrum, weighted by GCC_WEIGHTING,
+// with one inverse transform; finished like any other engine's
+void cross_spectrum_correlate(const struct cross_spectrum_t *avg, struct correlations_t *corr);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+// |re + j im| by alpha-max-plus-beta-min (max + 3/8 min), within 7%
+static inline uint32_t fixed_magnitude(int32_t re, int32_t im)
+{
+    uint32_t a = (uint32_t)(re < 0 ? -re : re);
+    uint32_t b = (uint32_t)(im < 0 ? -im : im);
+
+    if (a < b)
+    {
+        const uint32_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    return a + (b >> 2) + (b >> 3);
+}
+
+// Number of significant bits, 0 for 0
+static inline int fixed_bit_length(uint32_t value)
+{
+    return (value ? 32 - __builtin_clz(value) : 0);
+}
+
+// Number of set bits, summed in bit fields of growing width; the final
+// multiply adds up the four byte counts
+static inline int fixed_popcount32(uint32_t value)
+{
+    value -= (value >> 1) & 0x55555555u;
+    value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+    value = (value + (value >> 4)) & 0x0f0f0f0fu;
+    return (int)((value * 0x01010101u) >> 24);
+}
+
+// log2(value) in Q16 for value > 0, one result bit per squaring
+static inline int32_t fixed_log2_q16(uint32_t value)
+{
+    const int bits = fixed_bit_length(value) - 1;
+
+    // Mantissa in [1, 2) as Q30
+    uint32_t mantissa = (bits > 30 ? value >> (bits - 30) : value << (30 - bits));
+    int32_t result = bits << 16;
+
+    for (int32_t bit = 1 << 15; bit; bit >>= 1)
+    {
+        mantissa = (uint32_t)(((uint64_t)mantissa * mantissa) >> 30);
+        if (mantissa >= (2u << 30))
+        {
+            mantissa >>= 1;
+            result += bit;
+        }
+    }
+
+    return result;
+}
+
+// floor(sqrt(value)), two bits of the radicand per step
+static inline uint32_t fixed_isqrt64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
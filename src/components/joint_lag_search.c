@@ -0,0 +1,102 @@
+#include <components/joint_lag_search.h>
+#include <components/microphones.h>
+
+#include <math.h>
+
+// Feasible shift_ac range for each shift_ab; empty when first > last
+static int8_t joint_first_ac[CORRELATION_BUFFER_SIZE];
+static int8_t joint_last_ac[CORRELATION_BUFFER_SIZE];
+
+void joint_lag_search_init(void)
+{
+    // A far source in direction u delays mic B against mic A by
+    // (B - A).u / c, so over every direction (u_x, u_y) in the unit disk
+    // the two shifts fill the ellipse x' S^-1 x <= 1 with S = M M' and M
+    // the mic offsets in samples. Near sources stay inside it
+    const float k = SAMPLE_RATE_HZ / SPEED_OF_SOUND_MPS;
+    const float ab_x = (mic_b_location.x - mic_a_location.x) * k;
+    const float ab_y = (mic_b_location.y - mic_a_location.y) * k;
+    const float ac_x = (mic_c_location.x - mic_a_location.x) * k;
+    const float ac_y = (mic_c_location.y - mic_a_location.y) * k;
+
+    const float s11 = ab_x * ab_x + ab_y * ab_y;
+    const float s12 = ab_x * ac_x + ab_y * ac_y;
+    const float s22 = ac_x * ac_x + ac_y * ac_y;
+
+    const float x_max = sqrtf(s11);
+    const float spread = s22 - s12 * s12 / s11;
+
+    for (int s_ab = -MAX_SHIFT_SAMPLES; s_ab <= MAX_SHIFT_SAMPLES; s_ab++)
+    {
+        int first = 1;
+        int last = 0;
+
+        if (fabsf((float)s_ab) <= x_max + JOINT_LAG_MARGIN_SAMPLES &&
+            s_ab >= -MAX_SHIFT_AB_SAMPLES && s_ab <= MAX_SHIFT_AB_SAMPLES)
+        {
+            // Rows just past the ellipse take the range at its tip
+            const float x = fminf(fmaxf((float)s_ab, -x_max), x_max);
+            const float centre = s12 / s11 * x;
+            const float half = sqrtf(fmaxf(0.0f, spread * (1.0f - x * x / s11)));
+
+            first = (int)floorf(centre - half) - JOINT_LAG_MARGIN_SAMPLES;
+            last = (int)ceilf(centre + half) + JOINT_LAG_MARGIN_SAMPLES;
+
+            // shift_ac and the implied shift_bc must both lie in their
+            // pairs' lag ranges
+            const int lo_ac = -MAX_SHIFT_AC_SAMPLES;
+            const int hi_ac = MAX_SHIFT_AC_SAMPLES;
+            const int lo_bc = s_ab - MAX_SHIFT_BC_SAMPLES;
+            const int hi_bc = s_ab + MAX_SHIFT_BC_SAMPLES;
+            const int lo = (lo_ac > lo_bc ? lo_ac : lo_bc);
+            const int hi = (hi_ac < hi_bc ? hi_ac : hi_bc);
+            first = (first < lo ? lo : first);
+            last = (last > hi ? hi : last);
+        }
+
+        joint_first_ac[s_ab + MAX_SHIFT_SAMPLES] = (int8_t)first;
+        joint_last_ac[s_ab + MAX_SHIFT_SAMPLES] = (int8_t)last;
+    }
+}
+
+void joint_lag_search(
+    struct correlations_t *corr_ab,
+    struct correlations_t *corr_ac,
+    struct correlations_t *corr_bc)
+{
+    const power_t *ab = corr_ab->correlations + MAX_SHIFT_SAMPLES;
+    const power_t *ac = corr_ac->correlations + MAX_SHIFT_SAMPLES;
+    const power_t *bc = corr_bc->correlations + MAX_SHIFT_SAMPLES;
+
+    power_t best_score = INT64_MIN;
+    int best_ab = 0;
+    int best_ac = 0;
+
+    for (int s_ab = -MAX_SHIFT_SAMPLES; s_ab <= MAX_SHIFT_SAMPLES; s_ab++)
+    {
+        const int first = joint_first_ac[s_ab + MAX_SHIFT_SAMPLES];
+        const int last = joint_last_ac[s_ab + MAX_SHIFT_SAMPLES];
+
+        // Along a row shift_bc steps with shift_ac
+        const power_t *bc_row = bc - s_ab;
+
+        for (int s_ac = first; s_ac <= last; s_ac++)
+        {
+            const power_t score = ab[s_ab] + ac[s_ac] + bc_row[s_ac];
+
+            if (score > best_score)
+            {
+                best_score = score;
+                best_ab = s_ab;
+                best_ac = s_ac;
+            }
+        }
+    }
+
+    if (best_score == INT64_MIN)
+        return;
+
+    correlations_set_best(corr_ab, best_ab);
+    correlations_set_best(corr_ac, best_ac);
+    correlations_set_best(corr_bc, best_ac - best_ab);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/correlations.h>
+
+// Builds the table of physically possible (shift_ab, shift_ac) pairs from
+// the microphone positions; call after microphones_init
+void joint_lag_search_init(void);
+
+// Replaces the three independent best shifts with the feasible pair of
+// shifts (shift_ab, shift_ac), shift_bc = shift_ac - shift_ab, that
+// maximises the summed correlation of all three pairs. Each shift is
+// refined between samples and its peak-to-sidelobe ratio measured again;
+// the prior is left to the caller
+void joint_lag_search(
+    struct correlations_t *corr_ab,
+    struct correlations_t *corr_ac,
+    struct correlations_t *corr_bc);
@@ -0,0 +1,147 @@
+#include <components/lpc.h>
+#include <components/dot_product.h>
+
+// Autocorrelation is rescaled so r[0] sits just below 2^28, which keeps
+// every Levinson-Durbin product inside 64 bits up to LPC_MAX_ORDER: every
+// |r[k]| <= r[0], and with reflections clamped below 1 the predictor stays
+// minimum phase, so |a[j]| <= C(order, j) <= 70 (2^31 in Q24). Each
+// a[j] * r[i - j] is then below 2^59 and their sum below 2^62
+#define LPC_R0_BITS 28
+
+// Largest reflection coefficient allowed, just under 1.0 in Q24
+#define LPC_MAX_REFLECTION ((1 << LPC_LEVINSON_BITS) - (1 << 14))
+
+#define LPC_MAX_OUTPUT_SHIFT 8
+
+// Bandwidth expansion 0.94^k in Q15: widens sharp resonances so the
+// whitened output does not ring and the coefficients stay inside Q4.12
+static const int32_t LPC_LAG_EXPANSION[LPC_MAX_ORDER] = {
+    30802, 28954, 27217, 25584, 24049, 22606, 21249, 19974,
+};
+
+static int bit_length(uint64_t value)
+{
+    int bits = 0;
+    while (value)
+    {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+void lpc_estimate(struct lpc_t *lpc, int order,
+                  const struct buffer_t *const bufs[], int num_bufs)
+{
+    power_t r[LPC_MAX_ORDER + 1] = {0};
+    int64_t rn[LPC_MAX_ORDER + 1] = {0};
+    int64_t a[LPC_MAX_ORDER + 1] = {0};
+    int64_t next[LPC_MAX_ORDER + 1];
+
+    if (order > LPC_MAX_ORDER)
+        order = LPC_MAX_ORDER;
+
+    lpc->order = 0;
+    lpc->output_shift = 0;
+
+    if (order <= 0)
+        return;
+
+    // Pool the autocorrelation of every channel so they all share one
+    // filter, which leaves the inter-channel delays untouched
+    for (int b = 0; b < num_bufs; b++)
+    {
+        const sample_t *x = bufs[b]->buffer;
+        const int32_t peak = buffer_peak(bufs[b]);
+        const int headroom = dot_product_headroom(peak, peak);
+
+        for (int k = 0; k <= order; k++)
+            r[k] += dot_product(x + k, x, bufs[b]->size - k, headroom);
+    }
+
+    if (r[0] <= 0)
+        return;
+
+    // White-noise correction (about -30 dB) keeps the recursion well conditioned
+    r[0] += r[0] >> 10;
+
+    int shift = bit_length(r[0]) - LPC_R0_BITS;
+    if (shift < 0)
+        shift = 0;
+
+    for (int k = 0; k <= order; k++)
+        rn[k] = r[k] >> shift;
+
+    // Levinson-Durbin with Q24 coefficients
+    int64_t err = rn[0];
+    for (int i = 1; i <= order; i++)
+    {
+        int64_t acc = rn[i] * ((int64_t)1 << LPC_LEVINSON_BITS);
+        for (int j = 1; j < i; j++)
+            acc += a[j] * rn[i - j];
+
+        int64_t k = -acc / err;
+        if (k > LPC_MAX_REFLECTION)
+            k = LPC_MAX_REFLECTION;
+        else if (k < -LPC_MAX_REFLECTION)
+            k = -LPC_MAX_REFLECTION;
+
+        for (int j = 1; j < i; j++)
+            next[j] = a[j] + ((k * a[i - j]) >> LPC_LEVINSON_BITS);
+        for (int j = 1; j < i; j++)
+            a[j] = next[j];
+        a[i] = k;
+
+        err -= (err * ((k * k) >> LPC_LEVINSON_BITS)) >> LPC_LEVINSON_BITS;
+        if (err <= 0)
+            err = 1;
+    }
+
+    for (int j = 1; j <= order; j++)
+    {
+        int64_t coeff = (a[j] * LPC_LAG_EXPANSION[j - 1]) >> 15;
+        coeff = (coeff + (1 << (LPC_LEVINSON_BITS - LPC_COEFF_BITS - 1))) >> (LPC_LEVINSON_BITS - LPC_COEFF_BITS);
+
+        if (coeff > INT16_MAX)
+            coeff = INT16_MAX;
+        else if (coeff < INT16_MIN)
+            coeff = INT16_MIN;
+
+        lpc->coeffs[j - 1] = (int16_t)coeff;
+    }
+
+    // Whitening drops the power from r[0] to the prediction error; make
+    // up roughly sqrt(r[0] / err) so the output keeps its dynamic range
+    int output_shift = (bit_length(rn[0]) - bit_length(err)) >> 1;
+    if (output_shift > LPC_MAX_OUTPUT_SHIFT)
+        output_shift = LPC_MAX_OUTPUT_SHIFT;
+
+    lpc->order = order;
+    lpc->output_shift = output_shift;
+}
+
+void lpc_inverse_filter(const struct lpc_t *lpc, struct buffer_t *buf)
+{
+    if (lpc->order == 0)
+        return;
+
+    const int out_shift = LPC_COEFF_BITS - lpc->output_shift;
+
+    // Walk backwards so the history taps still read unfiltered samples
+    for (int i = buf->size - 1; i >= 0; i--)
+    {
+        power_t acc = (power_t)buf->buffer[i] * (1 << LPC_COEFF_BITS);
+
+        const int taps = (i < lpc->order ? i : lpc->order);
+        for (int j = 0; j < taps; j++)
+            acc += (int32_t)lpc->coeffs[j] * (int32_t)buf->buffer[i - 1 - j];
+
+        acc = (acc + ((power_t)1 << (out_shift - 1))) >> out_shift;
+        if (acc > INT16_MAX)
+            acc = INT16_MAX;
+        else if (acc < INT16_MIN)
+            acc = INT16_MIN;
+
+        buf->buffer[i] = (sample_t)acc;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+
+#define LPC_MAX_ORDER 8
+
+// Prediction-error filter coefficients are Q4.12
+#define LPC_COEFF_BITS 12
+
+// Levinson-Durbin runs with Q8.24 coefficients
+#define LPC_LEVINSON_BITS 24
+
+struct lpc_t
+{
+    int order;
+
+    // A(z) = 1 + coeffs[0] z^-1 + ... + coeffs[order - 1] z^-order
+    int16_t coeffs[LPC_MAX_ORDER];
+
+    // Power-of-two gain that restores the level lost by whitening
+    int output_shift;
+};
+
+void lpc_estimate(struct lpc_t *lpc, int order,
+                  const struct buffer_t *const bufs[], int num_bufs);
+void lpc_inverse_filter(const struct lpc_t *lpc, struct buffer_t *buf);
@@ -0,0 +1,181 @@
+#include <components/parallel_correlations.h>
+#include <components/dual_core.h>
+#include <components/fft_correlation.h>
+#include <components/dsp_core.h>
+
+#define PAIRS 3
+
+struct lag_range_t
+{
+    const struct buffer_t *const *bufs;
+    struct correlations_t *const *corrs;
+    int first_shift;
+    int last_shift;
+};
+
+struct pair_job_t
+{
+    const struct buffer_t *buf_a;
+    const struct buffer_t *buf_b;
+    struct correlations_t *corr;
+};
+
+struct spectra_job_t
+{
+    struct spectra_t *spectra;
+    const struct buffer_t *const *bufs;
+    struct correlations_t *corr;
+    int channel;
+};
+
+// Core 1 needs its own room for an inverse transform
+static spectra_scratch_t core1_scratch;
+
+int parallel_split_lags(const struct buffer_t *buf_a, const struct buffer_t *buf_b, int max_shift)
+{
+    int total = 0;
+    for (int s = -max_shift; s <= max_shift; s++)
+        total += correlations_overlap(buf_a, buf_b, s);
+
+    int below = 0;
+    int s = -max_shift;
+    for (; s < max_shift && 2 * below < total; s++)
+        below += correlations_overlap(buf_a, buf_b, s);
+
+    return s;
+}
+
+static void run_lag_range(void *arg)
+{
+    const struct lag_range_t *range = arg;
+
+    correlations_compute_pairs(range->corrs, range->bufs, range->first_shift, range->last_shift);
+}
+
+// A whole pair on one core, with the specialised kernels when they
+// apply: like step 8, only for the full search
+static void correlate_pair(int core, struct correlations_t *corr,
+                           const struct buffer_t *buf_a, const struct buffer_t *buf_b)
+{
+    if (DSP_CORE_TEMPLATES && !CORRELATION_COARSE_TO_FINE && !CORRELATION_PRUNED_SEARCH &&
+        dsp_core_init_pair(corr, buf_a, buf_b))
+        return;
+
+    correlations_init_on(core, corr, buf_a, buf_b);
+}
+
+static void run_pair(void *arg)
+{
+    const struct pair_job_t *job = arg;
+    correlate_pair(1, job->corr, job->buf_a, job->buf_b);
+}
+
+static void run_spectra_transform(void *arg)
+{
+    const struct spectra_job_t *job = arg;
+    spectra_transform(job->spectra, job->bufs, job->channel);
+}
+
+static void run_spectra_correlate(void *arg)
+{
+    const struct spectra_job_t *job = arg;
+    spectra_correlate_with(job->spectra, 1, 2, job->corr, core1_scratch);
+}
+
+static void parallel_direct(const struct buffer_t *const bufs[], struct correlations_t *const corrs[])
+{
+    static const int pair_a[PAIRS] = {0, 0, 1};
+    static const int pair_b[PAIRS] = {1, 2, 2};
+
+    power_t energies[3];
+    for (int c = 0; c < 3; c++)
+        energies[c] = buffer_energy(bufs[c]);
+
+    // Core 1 takes the upper lags of every pair, core 0 the lower ones.
+    // The pairs' ranges are centred, so the widest pair's split balances
+    // them all
+    const int split = parallel_split_lags(bufs[0], bufs[1], MAX_SHIFT_SAMPLES);
+    struct lag_range_t lower = {bufs, corrs, -MAX_SHIFT_SAMPLES, split - 1};
+    struct lag_range_t upper = {bufs, corrs, split, MAX_SHIFT_SAMPLES};
+
+    const struct dual_core_task_t task = {run_lag_range, &upper};
+    dual_core_start(&task);
+    run_lag_range(&lower);
+    dual_core_join();
+
+    for (int p = 0; p < PAIRS; p++)
+    {
+        correlations_set_energies(corrs[p], energies[pair_a[p]], energies[pair_b[p]]);
+        correlations_finish(corrs[p]);
+    }
+}
+
+// Searches that decide per pair which lags to compute, and kernels
+// compiled per pair range, cannot share out a lag range, so the cores
+// take whole pairs instead: core 1 the widest, a-c, and core 0 the
+// other two
+static void parallel_pairs(const struct buffer_t *const bufs[], struct correlations_t *const corrs[])
+{
+    struct pair_job_t job = {bufs[0], bufs[2], corrs[1]};
+    const struct dual_core_task_t task = {run_pair, &job};
+
+    dual_core_start(&task);
+    correlate_pair(0, corrs[0], bufs[0], bufs[1]);
+    correlate_pair(0, corrs[2], bufs[1], bufs[2]);
+    dual_core_join();
+}
+
+static bool parallel_fft(struct spectra_t *spectra, const struct buffer_t *const bufs[],
+                         struct correlations_t *const corrs[])
+{
+    if (!spectra_prepare(spectra, bufs, 3))
+        return false;
+
+    // Core 0 transforms a and b together while core 1 does c
+    struct spectra_job_t job = {spectra, bufs, corrs[2], 2};
+    const struct dual_core_task_t transform = {run_spectra_transform, &job};
+
+    dual_core_start(&transform);
+    spectra_transform(spectra, bufs, 0);
+    dual_core_join();
+
+    // Core 1 correlates b with c while core 0 does the pairs with a
+    const struct dual_core_task_t correlate = {run_spectra_correlate, &job};
+
+    dual_core_start(&correlate);
+    spectra_correlate(spectra, 0, 1, corrs[0]);
+    spectra_correlate(spectra, 0, 2, corrs[1]);
+    dual_core_join();
+
+    return true;
+}
+
+void parallel_correlations(struct spectra_t *spectra,
+                           const struct buffer_t *buf_a,
+                           const struct buffer_t *buf_b,
+                           const struct buffer_t *buf_c,
+                           struct correlations_t *corr_ab,
+                           struct correlations_t *corr_ac,
+                           struct correlations_t *corr_bc)
+{
+    const struct buffer_t *const bufs[3] = {buf_a, buf_b, buf_c};
+    struct correlations_t *const corrs[PAIRS] = {corr_ab, corr_ac, corr_bc};
+
+    if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+    {
+        if (parallel_fft(spectra, bufs, corrs))
+            return;
+
+        // Spans too long for the spectrum cache: the pairwise engine has a
+        // single work buffer, so it stays on core 0
+        fft_correlations_init(corr_ab, buf_a, buf_b);
+        fft_correlations_init(corr_ac, buf_a, buf_c);
+        fft_correlations_init(corr_bc, buf_b, buf_c);
+        return;
+    }
+
+    if (CORRELATION_COARSE_TO_FINE || CORRELATION_PRUNED_SEARCH || DSP_CORE_TEMPLATES)
+        parallel_pairs(bufs, corrs);
+    else
+        parallel_direct(bufs, corrs);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <components/buffer.h>
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+
+// Correlates all three mic pairs with the work spread over both cores,
+// giving the same results as the single-core engines. spectra is the
+// frame's spectrum cache when the FFT engine is in use
+void parallel_correlations(
+    struct spectra_t *spectra,
+    const struct buffer_t *buf_a,
+    const struct buffer_t *buf_b,
+    const struct buffer_t *buf_c,
+    struct correlations_t *corr_ab,
+    struct correlations_t *corr_ac,
+    struct correlations_t *corr_bc);
+
+// First shift of the upper part of a pair's lag range -max_shift..max_shift,
+// chosen so both parts need about the same number of products
+int parallel_split_lags(const struct buffer_t *buf_a, const struct buffer_t *buf_b, int max_shift);
@@ -1,23 +1,30 @@
 #include <components/rolling_buffer.h>
 
-void rolling_buffer_init(struct rolling_buffer_t *buf)
+void rolling_buffer_init(struct rolling_buffer_t *buf, int size_bits)
 {
+    if (size_bits < BUFFER_MIN_SIZE_BITS)
+        size_bits = BUFFER_MIN_SIZE_BITS;
+    else if (size_bits > BUFFER_MAX_SIZE_BITS)
+        size_bits = BUFFER_MAX_SIZE_BITS;
+
     buf->head = 0;
+    buf->size_bits = size_bits;
+    buf->size = 1 << size_bits;
     buf->incoming_power = 0;
     buf->incoming_total = 0;
     buf->outgoing_power = 0;
     buf->outgoing_total = 0;
     buf->is_full = false;
 
-    for (int i = 0; i < BUFFER_SIZE; i++)
+    for (int i = 0; i < buf->size; i++)
         buf->buffer[i] = 0;
 }
 
-void rolling_buffer_push(struct rolling_buffer_t *buf, sample_t sample)
+void rolling_buffer_push(struct rolling_buffer_t *buf, raw_sample_t sample)
 {
-    int middle_index = buf->head - BUFFER_HALF;
-    middle_index = (middle_index < 0) ? middle_index + BUFFER_SIZE : middle_index;
-    const sample_t middle_sample = buf->buffer[middle_index];
+    int middle_index = buf->head - (buf->size >> 1);
+    middle_index = (middle_index < 0) ? middle_index + buf->size : middle_index;
+    const raw_sample_t middle_sample = buf->buffer[middle_index];
 
     buf->outgoing_total -= buf->buffer[buf->head];
     buf->outgoing_power -= SAMPLE_POWER(buf->buffer[buf->head]);
@@ -33,7 +40,7 @@ void rolling_buffer_push(struct rolling_buffer_t *buf, sample_t sample)
 
     buf->buffer[buf->head] = sample;
 
-    if (++buf->head >= BUFFER_SIZE)
+    if (++buf->head >= buf->size)
     {
         buf->head = 0;
         buf->is_full = true;
@@ -45,7 +52,12 @@ void rolling_buffer_write_out(const struct rolling_buffer_t *buf, struct buffer_
     power_t dst_total = 0;
 
     int i, j;
-    for (i = 0, j = buf->head; j < BUFFER_SIZE; i++, j++)
+    dst->size_bits = buf->size_bits;
+    dst->size = buf->size;
+    dst->start = 0;
+    dst->end = buf->size;
+
+    for (i = 0, j = buf->head; j < buf->size; i++, j++)
     {
         const sample_t sample = buf->buffer[j];
 
@@ -61,25 +73,25 @@ void rolling_buffer_write_out(const struct rolling_buffer_t *buf, struct buffer_
         dst->buffer[i] = sample;
     }
 
-    const sample_t dst_offset = dst_total >> BUFFER_SIZE_BITS;
-    for (i = 0; i < BUFFER_SIZE; i++)
+    const sample_t dst_offset = dst_total >> buf->size_bits;
+    for (i = 0; i < buf->size; i++)
         dst->buffer[i] -= dst_offset;
 
     dst->power = 0;
-    for (i = 0; i < BUFFER_SIZE; i++)
+    for (i = 0; i < buf->size; i++)
         dst->power += SAMPLE_POWER(dst->buffer[i]);
 }
 
 power_t rolling_buffer_get_incoming_power(const struct rolling_buffer_t *buf)
 {
-    const power_t power = buf->incoming_power << BUFFER_HALF_SIZE_BITS;
+    const power_t power = buf->incoming_power << (buf->size_bits - 1);
     const power_t total = buf->incoming_total;
     return power - total * total;
 }
 
 power_t rolling_buffer_get_outgoing_power(const struct rolling_buffer_t *buf)
 {
-    const power_t power = buf->outgoing_power << BUFFER_HALF_SIZE_BITS;
+    const power_t power = buf->outgoing_power << (buf->size_bits - 1);
     const power_t total = buf->outgoing_total;
     return power - total * total;
 }
\ No newline at end of file
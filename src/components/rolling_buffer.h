@@ -5,14 +5,14 @@
 
 #include <stdbool.h>
 
-#define BUFFER_HALF (BUFFER_SIZE >> 1)
-#define BUFFER_HALF_SIZE_BITS (BUFFER_SIZE_BITS - 1)
-
 #define SAMPLE_POWER(sample) ((int64_t)(sample) * (sample))
 
 struct rolling_buffer_t
 {
     int head;
+
+    int size_bits;
+    int size;
     
     power_t incoming_power;
     power_t incoming_total;
@@ -21,11 +21,14 @@ struct rolling_buffer_t
     power_t outgoing_total;
 
     bool is_full;
-    sample_t buffer[BUFFER_SIZE];
+
+    // Raw ADC bytes; a full-size int16 ring per channel would not fit
+    // next to the frame buffers at the largest frame length
+    raw_sample_t buffer[BUFFER_MAX_SIZE];
 };
 
-void rolling_buffer_init(struct rolling_buffer_t *buf);
-void rolling_buffer_push(struct rolling_buffer_t *buf, sample_t sample);
+void rolling_buffer_init(struct rolling_buffer_t *buf, int size_bits);
+void rolling_buffer_push(struct rolling_buffer_t *buf, raw_sample_t sample);
 void rolling_buffer_write_out(const struct rolling_buffer_t *buf, struct buffer_t *dst);
 
 power_t rolling_buffer_get_incoming_power(const struct rolling_buffer_t *buf);
@@ -0,0 +1,108 @@
+#include <components/sign_correlation.h>
+#include <components/fixed_math.h>
+
+#define SIGN_WORD_MASK (SIGN_WORD_SIZE - 1)
+
+// b's signs advanced by one bit offset and padded with zeros at both
+// ends, so every lag with that offset reads aligned words. Only core 0
+// uses it
+static uint32_t sign_shifted[SIGN_MAX_WORDS + 1];
+
+void sign_buffer_pack(struct sign_buffer_t *dst, const struct buffer_t *src)
+{
+    dst->start = src->start;
+    dst->end = src->end;
+    dst->words = src->size >> SIGN_WORD_BITS;
+    dst->energy = buffer_energy(src);
+
+    for (int k = 0; k < dst->words; k++)
+    {
+        const sample_t *x = src->buffer + (k << SIGN_WORD_BITS);
+
+        uint32_t word = 0;
+        for (int j = 0; j < SIGN_WORD_SIZE; j++)
+            word |= ((uint32_t)(uint16_t)x[j] >> 15) << j;
+
+        dst->bits[k] = word;
+    }
+}
+
+// sign_shifted[k + 1] holds b's bits 32 k + offset .. 32 k + offset + 31
+static void sign_shift_words(const struct sign_buffer_t *b, int offset)
+{
+    uint32_t previous = 0;
+
+    for (int k = 0; k <= b->words; k++)
+    {
+        const uint32_t next = (k < b->words ? b->bits[k] : 0);
+
+        sign_shifted[k] = (offset ? (previous >> offset) | (next << (SIGN_WORD_SIZE - offset)) : previous);
+        previous = next;
+    }
+}
+
+// Agreements minus disagreements between a's samples lo .. hi - 1 and
+// the shifted b words starting word_offset words along
+static int32_t sign_agreement(const uint32_t *a, int word_offset, int lo, int hi)
+{
+    const int first = lo >> SIGN_WORD_BITS;
+    const int last = (hi - 1) >> SIGN_WORD_BITS;
+    const uint32_t first_mask = ~0u << (lo & SIGN_WORD_MASK);
+    const uint32_t last_mask = ~0u >> (SIGN_WORD_MASK - ((hi - 1) & SIGN_WORD_MASK));
+
+    int32_t differ;
+    if (first == last)
+    {
+        differ = fixed_popcount32((a[first] ^ sign_shifted[first + word_offset]) & first_mask & last_mask);
+    }
+    else
+    {
+        differ = fixed_popcount32((a[first] ^ sign_shifted[first + word_offset]) & first_mask) +
+                 fixed_popcount32((a[last] ^ sign_shifted[last + word_offset]) & last_mask);
+
+        for (int k = first + 1; k < last; k++)
+            differ += fixed_popcount32(a[k] ^ sign_shifted[k + word_offset]);
+    }
+
+    return (hi - lo) - 2 * differ;
+}
+
+void sign_correlations_init(struct correlations_t *corr,
+                            const struct sign_buffer_t *a,
+                            const struct sign_buffer_t *b)
+{
+    const int max_shift = corr->max_shift;
+
+    correlations_set_energies(corr, a->energy, b->energy);
+
+    // Full agreement over the whole span reaches coherent_peak. Scaled
+    // before dividing, as coherent_peak / span alone would truncate
+    const int span = a->end - a->start;
+    const power_t peak = corr->coherent_peak;
+
+    // Lags sharing a bit offset share one shifted copy of b
+    for (int offset = 0; offset < SIGN_WORD_SIZE; offset++)
+    {
+        const int first_shift = -max_shift + ((offset + max_shift) & SIGN_WORD_MASK);
+        if (first_shift > max_shift)
+            continue;
+
+        sign_shift_words(b, offset);
+
+        for (int s = first_shift; s <= max_shift; s += SIGN_WORD_SIZE)
+        {
+            const int lo = (a->start > b->start - s ? a->start : b->start - s);
+            const int hi = (a->end < b->end - s ? a->end : b->end - s);
+
+            corr->correlations[s + MAX_SHIFT_SAMPLES] =
+                (hi > lo && span > 0 ? sign_agreement(a->bits, (s >> SIGN_WORD_BITS) + 1, lo, hi) * peak / span : 0);
+        }
+    }
+
+    correlations_finish(corr);
+}
+
+bool sign_correlations_clear(const struct correlations_t *corr)
+{
+    return corr->peak_to_sidelobe_q8 >= SIGN_CORRELATION_MIN_PSR_Q8;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+#include <components/correlations.h>
+
+// One bit per sample, 32 samples to a word
+#define SIGN_WORD_BITS 5
+#define SIGN_WORD_SIZE (1 << SIGN_WORD_BITS)
+#define SIGN_MAX_WORDS (BUFFER_MAX_SIZE >> SIGN_WORD_BITS)
+
+#if SIGN_CORRELATION && GCC_WEIGHTING != GCC_WEIGHTING_NONE
+#error "Sign correlation stands in for the unweighted correlation only"
+#endif
+
+// A frame reduced to the signs of its samples: bit j of word k is set
+// when sample 32 k + j is negative
+struct sign_buffer_t
+{
+    int start;
+    int end;
+    int words;
+    uint32_t bits[SIGN_MAX_WORDS];
+
+    // Sum of squares of the samples, which sets the correlation's scale
+    power_t energy;
+};
+
+void sign_buffer_pack(struct sign_buffer_t *dst, const struct buffer_t *src);
+
+// Polarity-coincidence correlation: at each lag, the samples whose signs
+// agree minus those that differ over the overlap, found with XOR and
+// popcount a word at a time. Scaled so identical signals peak at the
+// same coherent_peak as in correlations_init, then finished like any
+// other engine's
+void sign_correlations_init(
+    struct correlations_t *corr,
+    const struct sign_buffer_t *a,
+    const struct sign_buffer_t *b);
+
+// True when a sign correlation's peak is clear enough to stand in for
+// the full correlation
+bool sign_correlations_clear(const struct correlations_t *corr);
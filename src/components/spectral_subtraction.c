@@ -0,0 +1,108 @@
+#include <components/spectral_subtraction.h>
+#include <components/fixed_math.h>
+
+void spectral_subtraction_init(struct noise_spectrum_t *noise)
+{
+    noise->size_bits = 0;
+
+    for (int b = 0; b < SPECTRAL_NOISE_BANDS; b++)
+        noise->bands[b] = 0;
+}
+
+void spectral_subtraction_learn(struct noise_spectrum_t *noise, struct buffer_t *buf)
+{
+    complex_q15_t *spectrum = (complex_q15_t *)buf->buffer;
+    const int exponent = fft_real_forward(spectrum, buf->size_bits);
+
+    const int band_bits = buf->size_bits - 1 - SPECTRAL_NOISE_BANDS_BITS;
+    const bool first = (noise->size_bits != buf->size_bits);
+
+    for (int b = 0; b < SPECTRAL_NOISE_BANDS; b++)
+    {
+        // Bin 0 holds DC and Nyquist, which the bands skip
+        const int k0 = (b == 0 ? 1 : b << band_bits);
+        const int k1 = (b + 1) << band_bits;
+
+        // Peak rather than mean, so a machinery tone inside a band is
+        // still fully covered
+        uint32_t peak = 0;
+        for (int k = k0; k < k1; k++)
+        {
+            const uint32_t magnitude = fixed_magnitude(spectrum[k].re, spectrum[k].im);
+            if (magnitude > peak)
+                peak = magnitude;
+        }
+        peak <<= exponent;
+
+        if (first)
+            noise->bands[b] = peak;
+        else
+            noise->bands[b] += ((int32_t)peak - (int32_t)noise->bands[b]) >> SPECTRAL_LEARN_SHIFT;
+    }
+
+    noise->size_bits = buf->size_bits;
+}
+
+void spectral_subtraction_apply(const struct noise_spectrum_t *noise, struct buffer_t *buf)
+{
+    // An estimate from another frame length has a different bin scale
+    if (noise->size_bits != buf->size_bits)
+        return;
+
+    complex_q15_t *spectrum = (complex_q15_t *)buf->buffer;
+    const int exponent = fft_real_forward(spectrum, buf->size_bits);
+
+    const int half = buf->size >> 1;
+    const int band_bits = buf->size_bits - 1 - SPECTRAL_NOISE_BANDS_BITS;
+
+    for (int k = 1; k < half; k++)
+    {
+        const int32_t re = spectrum[k].re;
+        const int32_t im = spectrum[k].im;
+        const uint32_t magnitude = fixed_magnitude(re, im);
+
+        if (magnitude == 0)
+            continue;
+
+        // Bring the noise down to this frame's block exponent; anything
+        // that large already swamps the bin
+        uint32_t noise_level = noise->bands[k >> band_bits] >> exponent;
+        if (noise_level > magnitude)
+            noise_level = magnitude;
+
+        const uint32_t excess = (noise_level * SPECTRAL_OVERSUBTRACTION_Q4) >> 4;
+        const uint32_t floor = magnitude >> SPECTRAL_FLOOR_BITS;
+
+        uint32_t kept = (magnitude > excess ? magnitude - excess : 0);
+        if (kept < floor)
+            kept = floor;
+
+        // Scale the bin, keeping its phase
+        const int32_t gain = (int32_t)((kept << 15) / magnitude);
+        spectrum[k].re = (int16_t)((re * gain) >> 15);
+        spectrum[k].im = (int16_t)((im * gain) >> 15);
+    }
+
+    // Forward and inverse grow the data by N / 2 between them; undo
+    // whatever part of that the block exponents did not absorb
+    const int net = exponent + fft_real_inverse(spectrum, buf->size_bits) - (buf->size_bits - 1);
+
+    if (net < 0)
+    {
+        const int32_t round = (1 << -net) >> 1;
+        for (int i = 0; i < buf->size; i++)
+            buf->buffer[i] = (sample_t)((buf->buffer[i] + round) >> -net);
+    }
+    else if (net > 0)
+    {
+        for (int i = 0; i < buf->size; i++)
+        {
+            int32_t tmp = (int32_t)buf->buffer[i] << net;
+            if (tmp > INT16_MAX)
+                tmp = INT16_MAX;
+            else if (tmp < INT16_MIN)
+                tmp = INT16_MIN;
+            buf->buffer[i] = (sample_t)tmp;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+#include <components/fft.h>
+
+// The noise estimate is kept in a fixed number of bands so its size does
+// not depend on the frame length (the shortest frame has 128 bins)
+#define SPECTRAL_NOISE_BANDS_BITS 7
+#define SPECTRAL_NOISE_BANDS (1 << SPECTRAL_NOISE_BANDS_BITS)
+
+// Noise magnitude is subtracted 1.5x (Q4) and the result never drops
+// below 1/16 of the original bin, which limits musical noise
+#define SPECTRAL_OVERSUBTRACTION_Q4 24
+#define SPECTRAL_FLOOR_BITS 4
+
+// Each learned frame moves the estimate 1/8 of the way
+#define SPECTRAL_LEARN_SHIFT 3
+
+struct noise_spectrum_t
+{
+    // Frame length the estimate was learned at, 0 before the first frame
+    int size_bits;
+
+    // Peak bin magnitude per band, at the scale of an unshifted transform
+    uint32_t bands[SPECTRAL_NOISE_BANDS];
+};
+
+void spectral_subtraction_init(struct noise_spectrum_t *noise);
+
+// Both transform the frame in place; a learned frame is left as a spectrum
+void spectral_subtraction_learn(struct noise_spectrum_t *noise, struct buffer_t *buf);
+void spectral_subtraction_apply(const struct noise_spectrum_t *noise, struct buffer_t *buf);
@@ -0,0 +1,242 @@
+#include <components/streaming_correlation.h>
+#include <components/dot_product.h>
+
+#define STREAMING_HISTORY_MASK (STREAMING_HISTORY_SIZE - 1)
+
+#if STREAMING_WINDOW_SIZE < 4 * MAX_SHIFT_SAMPLES
+#error "STREAMING_HISTORY_BITS is too small for the lag range"
+#endif
+
+#if STREAMING_OVERLAP_SAVE && (STREAMING_HISTORY_SIZE % STREAMING_BLOCK_SIZE != 0)
+#error "Overlap-save hops must tile the history"
+#endif
+
+static const int STREAMING_PAIR_CHANNELS[STREAMING_PAIRS][2] = {{0, 1}, {0, 2}, {1, 2}};
+static const int STREAMING_PAIR_MAX_SHIFT[STREAMING_PAIRS] = {
+    MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+// Where each pair's lag 0 sits in the packed sums
+static const int STREAMING_PAIR_CENTRE[STREAMING_PAIRS] = {
+    MAX_SHIFT_AB_SAMPLES,
+    2 * MAX_SHIFT_AB_SAMPLES + 1 + MAX_SHIFT_AC_SAMPLES,
+    2 * (MAX_SHIFT_AB_SAMPLES + MAX_SHIFT_AC_SAMPLES) + 2 + MAX_SHIFT_BC_SAMPLES};
+
+void streaming_correlation_init(struct streaming_correlation_t *stream)
+{
+    stream->count = 0;
+    stream->head = 0;
+
+    // Zeroed history stands in for the samples before the stream began,
+    // so early products and their later expiry both contribute nothing
+    for (int c = 0; c < STREAMING_CHANNELS; c++)
+        for (int i = 0; i < STREAMING_HISTORY_SIZE; i++)
+            stream->history[c][i] = 0;
+
+    for (int i = 0; i < STREAMING_LAGS; i++)
+        stream->sums[i] = 0;
+
+    for (int c = 0; c < STREAMING_CHANNELS; c++)
+        stream->energies[c] = 0;
+
+#if STREAMING_OVERLAP_SAVE
+    for (int h = 0; h < STREAMING_HOPS; h++)
+    {
+        for (int i = 0; i < STREAMING_LAGS; i++)
+            stream->hop_sums[h][i] = 0;
+
+        for (int c = 0; c < STREAMING_CHANNELS; c++)
+            stream->hop_energies[h][c] = 0;
+    }
+
+    stream->hop = 0;
+#endif
+}
+
+#if !STREAMING_OVERLAP_SAVE
+// Adds the products completed at history slot now and drops those
+// completed at slot then, one window earlier; sums points at lag 0
+static void streaming_update_pair(power_t *sums, int max_shift, const sample_t *a, const sample_t *b,
+                                  int now, int then)
+{
+    const int32_t a_now = a[now];
+    const int32_t b_now = b[now];
+    const int32_t a_then = a[then];
+    const int32_t b_then = b[then];
+
+    // Each difference of two int16 products stays inside int32
+    for (int shift = 0; shift <= max_shift; shift++)
+    {
+        const int32_t delta = (int32_t)a[(now - shift) & STREAMING_HISTORY_MASK] * b_now -
+                              (int32_t)a[(then - shift) & STREAMING_HISTORY_MASK] * b_then;
+        sums[shift] += delta;
+    }
+
+    for (int shift = 1; shift <= max_shift; shift++)
+    {
+        const int32_t delta = a_now * b[(now - shift) & STREAMING_HISTORY_MASK] -
+                              a_then * b[(then - shift) & STREAMING_HISTORY_MASK];
+        sums[-shift] += delta;
+    }
+}
+#else
+// dot_product of x and y from history slots x0 and y0 on, for n slots;
+// y's slots never wrap, x0 may lie up to a lag range before slot 0
+static power_t streaming_ring_dot(const sample_t *x, int x0, const sample_t *y, int y0, int n,
+                                  int headroom)
+{
+    if (x0 >= 0)
+        return dot_product(x + x0, y + y0, n, headroom);
+
+    const int wrapped = (-x0 < n ? -x0 : n);
+    return dot_product(x + STREAMING_HISTORY_SIZE + x0, y + y0, wrapped, headroom) +
+           dot_product(x, y + y0 + wrapped, n - wrapped, headroom);
+}
+
+// Largest magnitude among the slots a hop's products read
+static int32_t streaming_hop_peak(const sample_t *x, int first)
+{
+    int32_t peak = 0;
+    for (int i = first - MAX_SHIFT_SAMPLES; i < first + STREAMING_BLOCK_SIZE; i++)
+    {
+        const int32_t sample = x[i & STREAMING_HISTORY_MASK];
+        const int32_t magnitude = (sample < 0 ? -sample : sample);
+        peak = (magnitude > peak ? magnitude : peak);
+    }
+
+    return peak;
+}
+
+// Sums the products of the hop whose later samples arrived in slots
+// first .. first + STREAMING_BLOCK_SIZE - 1, and swaps them into the
+// window in place of the oldest hop's
+static void streaming_push_hop(struct streaming_correlation_t *stream, int first)
+{
+    int32_t peaks[STREAMING_CHANNELS];
+    for (int c = 0; c < STREAMING_CHANNELS; c++)
+    {
+        const sample_t *x = stream->history[c];
+        const int32_t peak = streaming_hop_peak(x, first);
+        const power_t energy = dot_product(x + first, x + first, STREAMING_BLOCK_SIZE,
+                                           dot_product_headroom(peak, peak));
+
+        stream->energies[c] += energy - stream->hop_energies[stream->hop][c];
+        stream->hop_energies[stream->hop][c] = energy;
+        peaks[c] = peak;
+    }
+
+    for (int p = 0; p < STREAMING_PAIRS; p++)
+    {
+        const int max_shift = STREAMING_PAIR_MAX_SHIFT[p];
+        const sample_t *a = stream->history[STREAMING_PAIR_CHANNELS[p][0]];
+        const sample_t *b = stream->history[STREAMING_PAIR_CHANNELS[p][1]];
+        const int headroom = dot_product_headroom(peaks[STREAMING_PAIR_CHANNELS[p][0]],
+                                                  peaks[STREAMING_PAIR_CHANNELS[p][1]]);
+        power_t *sums = stream->sums + STREAMING_PAIR_CENTRE[p];
+        power_t *kept = stream->hop_sums[stream->hop] + STREAMING_PAIR_CENTRE[p];
+
+        for (int shift = -max_shift; shift <= max_shift; shift++)
+        {
+            // a[t - shift] * b[t] for shift >= 0, a[t] * b[t + shift] below
+            const power_t sum = (shift >= 0
+                                     ? streaming_ring_dot(a, first - shift, b, first, STREAMING_BLOCK_SIZE, headroom)
+                                     : streaming_ring_dot(b, first + shift, a, first, STREAMING_BLOCK_SIZE, headroom));
+
+            sums[shift] += sum - kept[shift];
+            kept[shift] = sum;
+        }
+    }
+
+    stream->hop = (stream->hop + 1 < STREAMING_HOPS ? stream->hop + 1 : 0);
+}
+#endif
+
+void streaming_correlation_push(
+    struct streaming_correlation_t *stream,
+    const sample_t *const blocks[STREAMING_CHANNELS],
+    int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const int now = stream->head;
+
+#if STREAMING_OVERLAP_SAVE
+        for (int c = 0; c < STREAMING_CHANNELS; c++)
+            stream->history[c][now] = blocks[c][i];
+
+        if (((now + 1) & (STREAMING_BLOCK_SIZE - 1)) == 0)
+            streaming_push_hop(stream, now + 1 - STREAMING_BLOCK_SIZE);
+#else
+        const int then = (now - STREAMING_WINDOW_SIZE) & STREAMING_HISTORY_MASK;
+
+        for (int c = 0; c < STREAMING_CHANNELS; c++)
+        {
+            const int32_t incoming = blocks[c][i];
+            const int32_t outgoing = stream->history[c][then];
+
+            stream->history[c][now] = (sample_t)incoming;
+            stream->energies[c] += incoming * incoming - outgoing * outgoing;
+        }
+
+        for (int p = 0; p < STREAMING_PAIRS; p++)
+        {
+            streaming_update_pair(stream->sums + STREAMING_PAIR_CENTRE[p], STREAMING_PAIR_MAX_SHIFT[p],
+                                  stream->history[STREAMING_PAIR_CHANNELS[p][0]],
+                                  stream->history[STREAMING_PAIR_CHANNELS[p][1]],
+                                  now, then);
+        }
+#endif
+
+        stream->head = (now + 1) & STREAMING_HISTORY_MASK;
+        if (stream->count < STREAMING_WINDOW_SIZE)
+            stream->count++;
+    }
+}
+
+bool streaming_correlation_ready(const struct streaming_correlation_t *stream)
+{
+    return stream->count >= STREAMING_WINDOW_SIZE;
+}
+
+void streaming_correlation_read(
+    const struct streaming_correlation_t *stream,
+    int pair,
+    struct correlations_t *corr)
+{
+    // Lags past the pair's range were never summed and read as zero
+    const int max_shift = STREAMING_PAIR_MAX_SHIFT[pair];
+    const power_t *sums = stream->sums + STREAMING_PAIR_CENTRE[pair];
+
+    corr->max_shift = max_shift;
+    for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++)
+        corr->correlations[s + MAX_SHIFT_SAMPLES] = (s >= -max_shift && s <= max_shift ? sums[s] : 0);
+
+    correlations_set_energies(corr,
+                              stream->energies[STREAMING_PAIR_CHANNELS[pair][0]],
+                              stream->energies[STREAMING_PAIR_CHANNELS[pair][1]]);
+    correlations_finish(corr);
+}
+
+void streaming_correlation_write_out(
+    const struct streaming_correlation_t *stream,
+    int channel,
+    int size_bits,
+    struct buffer_t *dst)
+{
+    if (size_bits > STREAMING_HISTORY_BITS)
+        size_bits = STREAMING_HISTORY_BITS;
+
+    dst->size_bits = size_bits;
+    dst->size = 1 << size_bits;
+    dst->start = 0;
+    dst->end = dst->size;
+    dst->power = 0;
+
+    const sample_t *history = stream->history[channel];
+    for (int i = 0, j = stream->head - dst->size; i < dst->size; i++, j++)
+    {
+        const sample_t sample = history[j & STREAMING_HISTORY_MASK];
+
+        dst->buffer[i] = sample;
+        dst->power += (int32_t)sample * sample;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <components/constants.h>
+#include <components/buffer.h>
+#include <components/correlations.h>
+
+// Per-channel history kept by the stream; must cover the window plus the
+// lag range so expiring products can still be read back
+#define STREAMING_HISTORY_BITS 10
+#define STREAMING_HISTORY_SIZE (1 << STREAMING_HISTORY_BITS)
+
+// Number of sample times whose products make up each lag sum; a whole
+// number of hops of STREAMING_BLOCK_SIZE with STREAMING_OVERLAP_SAVE
+#if STREAMING_OVERLAP_SAVE
+#define STREAMING_HOPS ((STREAMING_HISTORY_SIZE - MAX_SHIFT_SAMPLES - 1) / STREAMING_BLOCK_SIZE)
+#define STREAMING_WINDOW_SIZE (STREAMING_HOPS * STREAMING_BLOCK_SIZE)
+#else
+#define STREAMING_WINDOW_SIZE (STREAMING_HISTORY_SIZE - MAX_SHIFT_SAMPLES - 1)
+#endif
+
+#define STREAMING_CHANNELS 3
+#define STREAMING_PAIRS 3
+
+// Lag sums of the three pairs back to back, each over its own range
+// rather than the widest pair's
+#define STREAMING_LAGS \
+    (2 * (MAX_SHIFT_AB_SAMPLES + MAX_SHIFT_AC_SAMPLES + MAX_SHIFT_BC_SAMPLES) + STREAMING_PAIRS)
+
+// Running DC estimate time constant, 2^STREAMING_DC_SHIFT samples
+#define STREAMING_DC_SHIFT 10
+
+// Cross-correlation over a sliding window of a continuous stream. Every
+// lag's product sum is updated as samples arrive: the products completed
+// by the new sample are added and those that slid out of the window are
+// subtracted, so the sums always equal a batch recomputation exactly.
+// A product a[i] * b[i + shift] belongs to the sample time at which its
+// later sample arrived.
+//
+// With STREAMING_OVERLAP_SAVE the sums move a hop of STREAMING_BLOCK_SIZE
+// samples at a time instead: each completed hop's lag sums are computed
+// once and kept, and the hop that slides out has its kept sums
+// subtracted. Between hops the sums stay as of the last complete one.
+struct streaming_correlation_t
+{
+    // Samples pushed so far, and where the next one goes
+    uint32_t count;
+    int head;
+
+    sample_t history[STREAMING_CHANNELS][STREAMING_HISTORY_SIZE];
+    power_t sums[STREAMING_LAGS];
+
+    // Each channel's energy over the window, for the peak height
+    power_t energies[STREAMING_CHANNELS];
+
+#if STREAMING_OVERLAP_SAVE
+    // The window's hops' own lag sums and energies, oldest at hop
+    power_t hop_sums[STREAMING_HOPS][STREAMING_LAGS];
+    power_t hop_energies[STREAMING_HOPS][STREAMING_CHANNELS];
+    int hop;
+#endif
+};
+
+void streaming_correlation_init(struct streaming_correlation_t *stream);
+
+// Appends count samples to every channel; blocks[c] holds channel c
+void streaming_correlation_push(
+    struct streaming_correlation_t *stream,
+    const sample_t *const blocks[STREAMING_CHANNELS],
+    int count);
+
+// True once a whole window of products has been summed
+bool streaming_correlation_ready(const struct streaming_correlation_t *stream);
+
+// Current window's correlations for pairs (0, 1), (0, 2) and (1, 2) in
+// that order, finished like any other engine's
+void streaming_correlation_read(
+    const struct streaming_correlation_t *stream,
+    int pair,
+    struct correlations_t *corr);
+
+// Copies the newest 2^size_bits samples of a channel out as a frame,
+// for display
+void streaming_correlation_write_out(
+    const struct streaming_correlation_t *stream,
+    int channel,
+    int size_bits,
+    struct buffer_t *dst);
+
+// Raw ADC byte to a sample on the frame scale, tracking the DC offset in
+// *dc (Q8) since a stream has no frame mean to subtract
+static inline sample_t streaming_remove_dc(int32_t *dc, raw_sample_t raw)
+{
+    const int32_t sample = (int32_t)raw << 8;
+    *dc += (sample - *dc) >> STREAMING_DC_SHIFT;
+    return (sample_t)(sample - *dc);
+}
@@ -4,10 +4,18 @@
 
 static char heat_colors[HEATMAP_HEIGHT][HEATMAP_WIDTH];
 
+// Expected shift of each pixel in half samples, offset by
+// 2 * MAX_SHIFT_SAMPLES so it stays a byte
 static uint8_t heat_idx_ab[HEATMAP_HEIGHT][HEATMAP_WIDTH];
 static uint8_t heat_idx_ac[HEATMAP_HEIGHT][HEATMAP_WIDTH];
 static uint8_t heat_idx_bc[HEATMAP_HEIGHT][HEATMAP_WIDTH];
 
+// Correlation at a half-sample index, interpolated between samples
+static inline int64_t heat_lookup(const struct correlations_t *corr, uint8_t idx) {
+  const power_t *c = corr->correlations + (idx >> 1);
+  return (idx & 1 ? (c[0] + c[1]) >> 1 : c[0]);
+}
+
 static inline float hypot3f(float x, float y, float z) {
   return sqrtf(x * x + y * y + z * z);
 }
@@ -68,26 +76,26 @@ void vga_init_heatmap() {
       float dt_ab = (dB - dA) / SPEED_OF_SOUND_MPS;
       float dt_ac = (dC - dA) / SPEED_OF_SOUND_MPS;
       float dt_bc = (dC - dB) / SPEED_OF_SOUND_MPS;
-      // convert to sample shifts
-      int s_ab = (int)roundf(dt_ab * SAMPLE_RATE_HZ);
-      int s_ac = (int)roundf(dt_ac * SAMPLE_RATE_HZ);
-      int s_bc = (int)roundf(dt_bc * SAMPLE_RATE_HZ);
-      // clamp shifts
-      if (s_ab < -MAX_SHIFT_SAMPLES)
-        s_ab = -MAX_SHIFT_SAMPLES;
-      else if (s_ab > MAX_SHIFT_SAMPLES)
-        s_ab = MAX_SHIFT_SAMPLES;
-      if (s_ac < -MAX_SHIFT_SAMPLES)
-        s_ac = -MAX_SHIFT_SAMPLES;
-      else if (s_ac > MAX_SHIFT_SAMPLES)
-        s_ac = MAX_SHIFT_SAMPLES;
-      if (s_bc < -MAX_SHIFT_SAMPLES)
-        s_bc = -MAX_SHIFT_SAMPLES;
-      else if (s_bc > MAX_SHIFT_SAMPLES)
-        s_bc = MAX_SHIFT_SAMPLES;
-      heat_idx_ab[y][x] = (uint8_t)(s_ab + MAX_SHIFT_SAMPLES);
-      heat_idx_ac[y][x] = (uint8_t)(s_ac + MAX_SHIFT_SAMPLES);
-      heat_idx_bc[y][x] = (uint8_t)(s_bc + MAX_SHIFT_SAMPLES);
+      // convert to half-sample shifts
+      int s_ab = (int)roundf(dt_ab * (2 * SAMPLE_RATE_HZ));
+      int s_ac = (int)roundf(dt_ac * (2 * SAMPLE_RATE_HZ));
+      int s_bc = (int)roundf(dt_bc * (2 * SAMPLE_RATE_HZ));
+      // clamp shifts to each pair's lag range
+      if (s_ab < -2 * MAX_SHIFT_AB_SAMPLES)
+        s_ab = -2 * MAX_SHIFT_AB_SAMPLES;
+      else if (s_ab > 2 * MAX_SHIFT_AB_SAMPLES)
+        s_ab = 2 * MAX_SHIFT_AB_SAMPLES;
+      if (s_ac < -2 * MAX_SHIFT_AC_SAMPLES)
+        s_ac = -2 * MAX_SHIFT_AC_SAMPLES;
+      else if (s_ac > 2 * MAX_SHIFT_AC_SAMPLES)
+        s_ac = 2 * MAX_SHIFT_AC_SAMPLES;
+      if (s_bc < -2 * MAX_SHIFT_BC_SAMPLES)
+        s_bc = -2 * MAX_SHIFT_BC_SAMPLES;
+      else if (s_bc > 2 * MAX_SHIFT_BC_SAMPLES)
+        s_bc = 2 * MAX_SHIFT_BC_SAMPLES;
+      heat_idx_ab[y][x] = (uint8_t)(s_ab + 2 * MAX_SHIFT_SAMPLES);
+      heat_idx_ac[y][x] = (uint8_t)(s_ac + 2 * MAX_SHIFT_SAMPLES);
+      heat_idx_bc[y][x] = (uint8_t)(s_bc + 2 * MAX_SHIFT_SAMPLES);
     }
   }
 }
@@ -99,9 +107,9 @@ void vga_draw_heatmap() {
   for (int y = 0; y < HEATMAP_HEIGHT; y++) {
     for (int x = 0; x < HEATMAP_WIDTH; x++) {
       int64_t L = 0;
-      L += corr_ab.correlations[heat_idx_ab[y][x]];
-      L += corr_ac.correlations[heat_idx_ac[y][x]];
-      L += corr_bc.correlations[heat_idx_bc[y][x]];
+      L += heat_lookup(&corr_ab, heat_idx_ab[y][x]);
+      L += heat_lookup(&corr_ac, heat_idx_ac[y][x]);
+      L += heat_lookup(&corr_bc, heat_idx_bc[y][x]);
       if (L > highest_L)
         highest_L = L;
     }
@@ -116,9 +124,9 @@ void vga_draw_heatmap() {
   for (int y = 0; y < HEATMAP_HEIGHT; y++) {
     for (int x = 0; x < HEATMAP_WIDTH; x++) {
       int64_t L = 0;
-      L += corr_ab.correlations[heat_idx_ab[y][x]];
-      L += corr_ac.correlations[heat_idx_ac[y][x]];
-      L += corr_bc.correlations[heat_idx_bc[y][x]];
+      L += heat_lookup(&corr_ab, heat_idx_ab[y][x]);
+      L += heat_lookup(&corr_ac, heat_idx_ac[y][x]);
+      L += heat_lookup(&corr_bc, heat_idx_bc[y][x]);
       char c = (L >= t_white   ? WHITE
                 : L >= t_green ? GREEN
                 : L >= t_red   ? RED
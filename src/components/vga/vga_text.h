@@ -21,8 +21,8 @@ void vga_draw_text()
                 buffer_a.power, mic_a_outgoing_power, mic_a_incoming_power,
                 buffer_b.power, mic_b_outgoing_power, mic_b_incoming_power,
                 buffer_c.power, mic_c_outgoing_power, mic_c_incoming_power,
-                (mic_a_outgoing_power + mic_b_outgoing_power + mic_c_outgoing_power) >> (2 * BUFFER_HALF_SIZE_BITS),
-                (mic_a_incoming_power + mic_b_incoming_power + mic_c_incoming_power) >> (2 * BUFFER_HALF_SIZE_BITS)
+                (mic_a_outgoing_power + mic_b_outgoing_power + mic_c_outgoing_power) >> (2 * (mic_a_rb.size_bits - 1)),
+                (mic_a_incoming_power + mic_b_incoming_power + mic_c_incoming_power) >> (2 * (mic_a_rb.size_bits - 1))
         );
         writeString(screentext);
 
@@ -30,12 +30,12 @@ void vga_draw_text()
         writeString("\n\n");
         writeString("--= Sample Shifts =--\n");
         sprintf(screentext,
-                "Shift AB:%+4d        \n"
-                "Shift AC:%+4d        \n"
-                "Shift BC:%+4d        \n",
-                corr_ab.best_shift,
-                corr_ac.best_shift,
-                corr_bc.best_shift);
+                "Shift AB:%+7.2f     \n"
+                "Shift AC:%+7.2f     \n"
+                "Shift BC:%+7.2f     \n",
+                corr_ab.best_shift_q8 / 256.0f,
+                corr_ac.best_shift_q8 / 256.0f,
+                corr_bc.best_shift_q8 / 256.0f);
         writeString(screentext);
 
         // line 2–4: mic positions
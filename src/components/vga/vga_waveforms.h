@@ -1,9 +1,16 @@
+// Long frames are decimated so each lane is drawn with a bounded number
+// of segments; this also bounds the erase caches below
+#define WAVEFORM_MAX_POINTS 512
+
 // Local copies for erasing old plots
-static int16_t old_buffer_a[BUFFER_SIZE];
-static int16_t old_buffer_b[BUFFER_SIZE];
-static int16_t old_buffer_c[BUFFER_SIZE];
-static int old_shift_ab = 0;
-static int old_shift_ac = 0;
+static int16_t old_buffer_a[WAVEFORM_MAX_POINTS];
+static int16_t old_buffer_b[WAVEFORM_MAX_POINTS];
+static int16_t old_buffer_c[WAVEFORM_MAX_POINTS];
+static int old_points = 0;
+static int old_stride = 1;
+static float old_dx_wave = 0;
+static float old_shift_ab = 0;
+static float old_shift_ac = 0;
 
 void vga_draw_waveforms()
 {
@@ -11,56 +18,68 @@ void vga_draw_waveforms()
     const int baseA = PLOT_Y0 + lane_h / 2;
     const int baseB = PLOT_Y0 + lane_h + lane_h / 2;
     const int baseC = PLOT_Y0 + 2 * lane_h + lane_h / 2;
-    const float dx_wave = (float)PLOT_WIDTH / (BUFFER_SIZE - 1);
+    const int stride = (buffer_a.size > WAVEFORM_MAX_POINTS ? buffer_a.size / WAVEFORM_MAX_POINTS : 1);
+    const int points = buffer_a.size / stride;
+    const float dx_wave = (float)PLOT_WIDTH / (buffer_a.size - 1);
+    const float shift_ab = corr_ab.best_shift_q8 * (1.0f / 256);
+    const float shift_ac = corr_ac.best_shift_q8 * (1.0f / 256);
 
     // Erase old waveforms
-    for (int i = 1; i < BUFFER_SIZE; ++i)
+    for (int k = 1; k < old_points; ++k)
     {
-        int xa0 = PLOT_X0 + (int)((i - 1) * dx_wave + 0.5f);
-        int xa1 = PLOT_X0 + (int)((i - 0) * dx_wave + 0.5f);
-        int xb0 = PLOT_X0 + (int)((i - 1 - old_shift_ab) * dx_wave + 0.5f);
-        int xb1 = PLOT_X0 + (int)((i - 0 - old_shift_ab) * dx_wave + 0.5f);
-        int xc0 = PLOT_X0 + (int)((i - 1 - old_shift_ac) * dx_wave + 0.5f);
-        int xc1 = PLOT_X0 + (int)((i - 0 - old_shift_ac) * dx_wave + 0.5f);
+        const int i = k * old_stride;
+        int xa0 = PLOT_X0 + (int)((i - old_stride) * old_dx_wave + 0.5f);
+        int xa1 = PLOT_X0 + (int)((i - 0) * old_dx_wave + 0.5f);
+        int xb0 = PLOT_X0 + (int)((i - old_stride - old_shift_ab) * old_dx_wave + 0.5f);
+        int xb1 = PLOT_X0 + (int)((i - 0 - old_shift_ab) * old_dx_wave + 0.5f);
+        int xc0 = PLOT_X0 + (int)((i - old_stride - old_shift_ac) * old_dx_wave + 0.5f);
+        int xc1 = PLOT_X0 + (int)((i - 0 - old_shift_ac) * old_dx_wave + 0.5f);
         int y0, y1;
         // A channel
-        y0 = baseA - (old_buffer_a[i - 1] >> VERTICAL_SCALE);
-        y1 = baseA - (old_buffer_a[i] >> VERTICAL_SCALE);
+        y0 = baseA - (old_buffer_a[k - 1] >> VERTICAL_SCALE);
+        y1 = baseA - (old_buffer_a[k] >> VERTICAL_SCALE);
         drawLine(xa0, y0, xa1, y1, BLACK);
         // B channel (shifted)
-        y0 = baseB - (old_buffer_b[i - 1] >> VERTICAL_SCALE);
-        y1 = baseB - (old_buffer_b[i] >> VERTICAL_SCALE);
+        y0 = baseB - (old_buffer_b[k - 1] >> VERTICAL_SCALE);
+        y1 = baseB - (old_buffer_b[k] >> VERTICAL_SCALE);
         drawLine(xb0, y0, xb1, y1, BLACK);
         // C channel (shifted)
-        y0 = baseC - (old_buffer_c[i - 1] >> VERTICAL_SCALE);
-        y1 = baseC - (old_buffer_c[i] >> VERTICAL_SCALE);
+        y0 = baseC - (old_buffer_c[k - 1] >> VERTICAL_SCALE);
+        y1 = baseC - (old_buffer_c[k] >> VERTICAL_SCALE);
         drawLine(xc0, y0, xc1, y1, BLACK);
     }
 
     // Draw new waveforms
-    for (int i = 1; i < BUFFER_SIZE; ++i)
+    for (int k = 1; k < points; ++k)
     {
-        int xa0 = PLOT_X0 + (int)((i - 1) * dx_wave + 0.5f);
+        const int i = k * stride;
+        int xa0 = PLOT_X0 + (int)((i - stride) * dx_wave + 0.5f);
         int xa1 = PLOT_X0 + (int)((i - 0) * dx_wave + 0.5f);
-        int xb0 = PLOT_X0 + (int)((i - 1 - corr_ab.best_shift) * dx_wave + 0.5f);
-        int xb1 = PLOT_X0 + (int)((i - 0 - corr_ab.best_shift) * dx_wave + 0.5f);
-        int xc0 = PLOT_X0 + (int)((i - 1 - corr_ac.best_shift) * dx_wave + 0.5f);
-        int xc1 = PLOT_X0 + (int)((i - 0 - corr_ac.best_shift) * dx_wave + 0.5f);
+        int xb0 = PLOT_X0 + (int)((i - stride - shift_ab) * dx_wave + 0.5f);
+        int xb1 = PLOT_X0 + (int)((i - 0 - shift_ab) * dx_wave + 0.5f);
+        int xc0 = PLOT_X0 + (int)((i - stride - shift_ac) * dx_wave + 0.5f);
+        int xc1 = PLOT_X0 + (int)((i - 0 - shift_ac) * dx_wave + 0.5f);
         int y0, y1;
-        y0 = baseA - (buffer_a.buffer[i - 1] >> VERTICAL_SCALE);
+        y0 = baseA - (buffer_a.buffer[i - stride] >> VERTICAL_SCALE);
         y1 = baseA - (buffer_a.buffer[i] >> VERTICAL_SCALE);
         drawLine(xa0, y0, xa1, y1, RED);
-        y0 = baseB - (buffer_b.buffer[i - 1] >> VERTICAL_SCALE);
+        y0 = baseB - (buffer_b.buffer[i - stride] >> VERTICAL_SCALE);
         y1 = baseB - (buffer_b.buffer[i] >> VERTICAL_SCALE);
         drawLine(xb0, y0, xb1, y1, BLUE);
-        y0 = baseC - (buffer_c.buffer[i - 1] >> VERTICAL_SCALE);
+        y0 = baseC - (buffer_c.buffer[i - stride] >> VERTICAL_SCALE);
         y1 = baseC - (buffer_c.buffer[i] >> VERTICAL_SCALE);
         drawLine(xc0, y0, xc1, y1, WHITE);
     }
 
-    memcpy(old_buffer_a, buffer_a.buffer, sizeof(old_buffer_a));
-    memcpy(old_buffer_b, buffer_b.buffer, sizeof(old_buffer_b));
-    memcpy(old_buffer_c, buffer_c.buffer, sizeof(old_buffer_c));
-    old_shift_ab = corr_ab.best_shift;
-    old_shift_ac = corr_ac.best_shift;
-}
\ No newline at end of file
+    for (int k = 0; k < points; ++k)
+    {
+        old_buffer_a[k] = buffer_a.buffer[k * stride];
+        old_buffer_b[k] = buffer_b.buffer[k * stride];
+        old_buffer_c[k] = buffer_c.buffer[k * stride];
+    }
+    old_points = points;
+    old_stride = stride;
+    old_dx_wave = dx_wave;
+    old_shift_ab = shift_ab;
+    old_shift_ac = shift_ac;
+}
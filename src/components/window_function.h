@@ -2,7 +2,9 @@
 
 #include <components/constants.h>
 
-static const int32_t WINDOW_FUNCTION[1024] = {
+#define WINDOW_FUNCTION_SIZE_BITS 10
+
+static const int32_t WINDOW_FUNCTION[1 << WINDOW_FUNCTION_SIZE_BITS] = {
     0x0210, 0x0221, 0x0233, 0x0245, 0x0258, 0x026a, 0x027d, 0x0290, 0x02a3, 0x02b7, 0x02cb, 0x02df, 0x02f4, 0x0309, 0x031e, 0x0333,
     0x0349, 0x035f, 0x0375, 0x038c, 0x03a2, 0x03ba, 0x03d1, 0x03e9, 0x0401, 0x0419, 0x0432, 0x044b, 0x0464, 0x047e, 0x0498, 0x04b2,
     0x04cc, 0x04e7, 0x0502, 0x051e, 0x053a, 0x0556, 0x0572, 0x058f, 0x05ac, 0x05ca, 0x05e7, 0x0605, 0x0624, 0x0643, 0x0662, 0x0681,
@@ -36,7 +36,12 @@
 #include <components/buffer.h>
 #include <components/rolling_buffer.h>
 #include <components/correlations.h>
+#include <components/biquad.h>
+#include <components/fft.h>
+#include <components/spectral_subtraction.h>
 #include <components/microphones.h>
+#include <components/dual_core.h>
+#include <components/joint_lag_search.h>
 #include <components/dma_sampler.h>
 
 #include <vga_debug.h>
@@ -55,11 +60,31 @@ int main(void)
 
     // Initialize microphone geometry and rolling buffers
     microphones_init();
-    rolling_buffer_init(&mic_a_rb);
-    rolling_buffer_init(&mic_b_rb);
-    rolling_buffer_init(&mic_c_rb);
+    rolling_buffer_init(&mic_a_rb, BUFFER_DEFAULT_SIZE_BITS);
+    rolling_buffer_init(&mic_b_rb, BUFFER_DEFAULT_SIZE_BITS);
+    rolling_buffer_init(&mic_c_rb, BUFFER_DEFAULT_SIZE_BITS);
+    biquad_cascade_init_band(&prefilter_a, PREFILTER_HIGHPASS_HZ, PREFILTER_LOWPASS_HZ);
+    biquad_cascade_init_band(&prefilter_b, PREFILTER_HIGHPASS_HZ, PREFILTER_LOWPASS_HZ);
+    biquad_cascade_init_band(&prefilter_c, PREFILTER_HIGHPASS_HZ, PREFILTER_LOWPASS_HZ);
+    fft_init();
+    correlations_tables_init();
+    correlations_set_range(&corr_ab, MAX_SHIFT_AB_SAMPLES);
+    correlations_set_range(&corr_ac, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&corr_bc, MAX_SHIFT_BC_SAMPLES);
+    correlations_set_range(&new_corr_ab, MAX_SHIFT_AB_SAMPLES);
+    correlations_set_range(&new_corr_ac, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&new_corr_bc, MAX_SHIFT_BC_SAMPLES);
+    spectral_subtraction_init(&noise_a);
+    spectral_subtraction_init(&noise_b);
+    spectral_subtraction_init(&noise_c);
     dma_sampler_init();
 
+    if (DUAL_CORE_CORRELATION || STREAMING_CORRELATION)
+        dual_core_init();
+
+    if (JOINT_LAG_SEARCH)
+        joint_lag_search_init();
+
     gpio_init(0);
     gpio_set_dir(0, true);
 
@@ -68,7 +93,11 @@ int main(void)
     PT_SEM_INIT(&load_audio_semaphore, 1);
 
     // Register protothreads
+#if STREAMING_CORRELATION
+    pt_add_thread(protothread_stream_and_compute);
+#else
     pt_add_thread(protothread_sample_and_compute);
+#endif
     pt_add_thread(protothread_vga_debug);
 
     // Start the scheduler
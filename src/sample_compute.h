@@ -15,10 +15,20 @@
 #include <components/rolling_buffer.h>
 #include <components/buffer.h>
 #include <components/correlations.h>
+#include <components/fft_correlation.h>
+#include <components/parallel_correlations.h>
+#include <components/dual_core.h>
+#include <components/joint_lag_search.h>
+#include <components/sign_correlation.h>
+#include <components/biquad.h>
+#include <components/lpc.h>
+#include <components/spectral_subtraction.h>
+#include <components/streaming_correlation.h>
 #include <components/dma_sampler.h>
+#include <components/dsp_core.h>
 
 // Power threshold for activity detection (tune as needed)
-#define POWER_THRESHOLD (((power_t)2) << (2 * BUFFER_HALF_SIZE_BITS))
+#define POWER_THRESHOLD(size_bits) (((power_t)2) << (2 * ((size_bits) - 1)))
 
 // Definitions of extern globals
 static struct rolling_buffer_t mic_a_rb;
@@ -29,6 +39,17 @@ static struct buffer_t buffer_a;
 static struct buffer_t buffer_b;
 static struct buffer_t buffer_c;
 
+static struct biquad_cascade_t prefilter_a;
+static struct biquad_cascade_t prefilter_b;
+static struct biquad_cascade_t prefilter_c;
+
+static struct noise_spectrum_t noise_a;
+static struct noise_spectrum_t noise_b;
+static struct noise_spectrum_t noise_c;
+static absolute_time_t last_noise_update;
+
+static struct lpc_t prewhiten;
+
 static struct correlations_t corr_ab;
 static struct correlations_t corr_ac;
 static struct correlations_t corr_bc;
@@ -37,26 +58,130 @@ static struct correlations_t new_corr_ab;
 static struct correlations_t new_corr_ac;
 static struct correlations_t new_corr_bc;
 
+static struct spectra_t frame_spectra;
+
+static struct sign_buffer_t signs_a;
+static struct sign_buffer_t signs_b;
+static struct sign_buffer_t signs_c;
+
+#if CROSS_SPECTRUM_AVERAGING
+static struct cross_spectrum_t cross_ab;
+static struct cross_spectrum_t cross_ac;
+static struct cross_spectrum_t cross_bc;
+#endif
+
+#if STREAMING_CORRELATION
+static struct streaming_correlation_t stream;
+static int32_t stream_dc[STREAMING_CHANNELS];
+
+// Core 0 samples into one block while core 1 processes the other
+static sample_t stream_blocks[2][STREAMING_CHANNELS][STREAMING_BLOCK_SIZE];
+
+struct stream_job_t
+{
+    int block;
+
+    // Set by core 1: whether the block updated the averages, and how
+    // long it took
+    bool averaged;
+    int64_t elapsed_us;
+};
+
+static struct stream_job_t stream_job;
+
+// Blocks core 1 took too long over, each leaving a gap in the sampling,
+// and how many of them have been printed
+static uint32_t stream_overruns;
+static uint32_t stream_overruns_reported;
+#endif
+
+// Frame length used for the next capture; change with '+' / '-' over stdio
+static int frame_size_bits = BUFFER_DEFAULT_SIZE_BITS;
+
 static struct pt_sem load_audio_semaphore;
 static struct pt_sem vga_semaphore;
 
 static uint8_t sample_array[3];
 
+static void poll_frame_size_request(void)
+{
+    const int c = getchar_timeout_us(0);
+
+    if (c == '+' && frame_size_bits < BUFFER_MAX_SIZE_BITS)
+        frame_size_bits++;
+    else if (c == '-' && frame_size_bits > BUFFER_MIN_SIZE_BITS)
+        frame_size_bits--;
+    else
+        return;
+
+    printf("Frame length: %d samples\n", 1 << frame_size_bits);
+}
+
+// Correlates the frame's signs alone; true when that gave every pair a
+// clear enough peak to skip the full correlation
+static bool correlate_signs(void)
+{
+    sign_buffer_pack(&signs_a, &buffer_a);
+    sign_buffer_pack(&signs_b, &buffer_b);
+    sign_buffer_pack(&signs_c, &buffer_c);
+
+    sign_correlations_init(&new_corr_ab, &signs_a, &signs_b);
+    sign_correlations_init(&new_corr_ac, &signs_a, &signs_c);
+    sign_correlations_init(&new_corr_bc, &signs_b, &signs_c);
+
+    return sign_correlations_clear(&new_corr_ab) &&
+           sign_correlations_clear(&new_corr_ac) &&
+           sign_correlations_clear(&new_corr_bc);
+}
+
+// Folds the frame into every pair's averaged cross-spectrum and
+// correlates the averages; false when the frame's spans are too long for
+// the spectrum cache
+static bool correlate_averaged_spectra(void)
+{
+#if CROSS_SPECTRUM_AVERAGING
+    const struct buffer_t *const frames[3] = {&buffer_a, &buffer_b, &buffer_c};
+    if (!spectra_compute(&frame_spectra, frames, 3))
+        return false;
+
+    cross_spectrum_accumulate(&cross_ab, &frame_spectra, 0, 1);
+    cross_spectrum_accumulate(&cross_ac, &frame_spectra, 0, 2);
+    cross_spectrum_accumulate(&cross_bc, &frame_spectra, 1, 2);
+
+    cross_spectrum_correlate(&cross_ab, &new_corr_ab);
+    cross_spectrum_correlate(&cross_ac, &new_corr_ac);
+    cross_spectrum_correlate(&cross_bc, &new_corr_bc);
+    return true;
+#else
+    return false;
+#endif
+}
+
 static PT_THREAD(protothread_sample_and_compute(struct pt *pt))
 {
     PT_BEGIN(pt);
 
-    static sample_t sA, sB, sC;
+    static raw_sample_t sA, sB, sC;
     static absolute_time_t deadline;
+    static bool learn_noise;
+    static bool spectra_averaged;
 
     deadline = get_absolute_time();
     while (true)
     {
-        rolling_buffer_init(&mic_a_rb);
-        rolling_buffer_init(&mic_b_rb);
-        rolling_buffer_init(&mic_c_rb);
+        poll_frame_size_request();
+
+        rolling_buffer_init(&mic_a_rb, frame_size_bits);
+        rolling_buffer_init(&mic_b_rb, frame_size_bits);
+        rolling_buffer_init(&mic_c_rb, frame_size_bits);
+
+        // Each capture starts a fresh, discontinuous stream
+        biquad_cascade_reset(&prefilter_a);
+        biquad_cascade_reset(&prefilter_b);
+        biquad_cascade_reset(&prefilter_c);
 
         deadline = get_absolute_time();
+        learn_noise = false;
 
         // 1) Fill rolling buffers with fresh samples
         while (true)
@@ -86,8 +211,16 @@ static PT_THREAD(protothread_sample_and_compute(struct pt *pt))
                 const power_t outgoing_power = mic_a_outgoing_power + mic_b_outgoing_power + mic_c_outgoing_power;
                 const power_t incoming_power = mic_a_incoming_power + mic_b_incoming_power + mic_c_incoming_power;
 
-                if (outgoing_power > POWER_THRESHOLD + incoming_power)
+                if (outgoing_power > POWER_THRESHOLD(frame_size_bits) + incoming_power)
                     break;
+
+                // Quiet full frame: hand it to the noise estimator now and then
+                if (SPECTRAL_SUBTRACTION &&
+                    absolute_time_diff_us(last_noise_update, deadline) > SPECTRAL_NOISE_INTERVAL_US)
+                {
+                    learn_noise = true;
+                    break;
+                }
             }
 
             // Maintain real-time sampling rate
@@ -111,15 +244,127 @@ static PT_THREAD(protothread_sample_and_compute(struct pt *pt))
         buffer_normalize_range(&buffer_b);
         buffer_normalize_range(&buffer_c);
 
-        // 4) Apply analysis window
-        buffer_window(&buffer_a);
-        buffer_window(&buffer_b);
-        buffer_window(&buffer_c);
+        // 4) Band-pass pre-filter
+        biquad_cascade_process(&prefilter_a, &buffer_a);
+        biquad_cascade_process(&prefilter_b, &buffer_b);
+        biquad_cascade_process(&prefilter_c, &buffer_c);
+
+        // 5) Learn the background noise from quiet frames, subtract it from events
+        if (SPECTRAL_SUBTRACTION)
+        {
+            if (learn_noise)
+            {
+                spectral_subtraction_learn(&noise_a, &buffer_a);
+                spectral_subtraction_learn(&noise_b, &buffer_b);
+                spectral_subtraction_learn(&noise_c, &buffer_c);
+
+                last_noise_update = get_absolute_time();
+                continue;
+            }
+
+            spectral_subtraction_apply(&noise_a, &buffer_a);
+            spectral_subtraction_apply(&noise_b, &buffer_b);
+            spectral_subtraction_apply(&noise_c, &buffer_c);
+        }
+
+        // 6) Pre-whiten every channel with one shared LPC model
+        if (PREWHITEN_LPC_ORDER > 0)
+        {
+            const struct buffer_t *const frames[3] = {&buffer_a, &buffer_b, &buffer_c};
+            lpc_estimate(&prewhiten, PREWHITEN_LPC_ORDER, frames, 3);
+
+            lpc_inverse_filter(&prewhiten, &buffer_a);
+            lpc_inverse_filter(&prewhiten, &buffer_b);
+            lpc_inverse_filter(&prewhiten, &buffer_c);
+        }
+
+        // 7) Apply analysis window
+        if (ONSET_GATED_WINDOW)
+        {
+            const struct buffer_t *const frames[3] = {&buffer_a, &buffer_b, &buffer_c};
+            const int onset = buffer_find_onset(frames, 3);
+
+            buffer_window_onset(&buffer_a, onset, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+            buffer_window_onset(&buffer_b, onset, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+            buffer_window_onset(&buffer_c, onset, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+        }
+        else if (DSP_CORE_TEMPLATES)
+        {
+            dsp_core_window(&buffer_a);
+            dsp_core_window(&buffer_b);
+            dsp_core_window(&buffer_c);
+        }
+        else
+        {
+            buffer_window(&buffer_a);
+            buffer_window(&buffer_b);
+            buffer_window(&buffer_c);
+        }
+
+        // 8) Cross-correlation and best-shift detection
+        spectra_averaged = false;
+        if (SIGN_CORRELATION && correlate_signs())
+        {
+            // The signs alone settled this frame
+        }
+        else if (CROSS_SPECTRUM_AVERAGING && correlate_averaged_spectra())
+        {
+            // Already averaged over frames, so step 10 only takes it over
+            spectra_averaged = true;
+        }
+        else if (DUAL_CORE_CORRELATION)
+        {
+            parallel_correlations(&frame_spectra, &buffer_a, &buffer_b, &buffer_c,
+                                  &new_corr_ab, &new_corr_ac, &new_corr_bc);
+        }
+        else if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+        {
+            // Transform each mic once and reuse its spectrum in both pairs
+            const struct buffer_t *const frames[3] = {&buffer_a, &buffer_b, &buffer_c};
+
+            if (spectra_compute(&frame_spectra, frames, 3))
+            {
+                spectra_correlate(&frame_spectra, 0, 1, &new_corr_ab);
+                spectra_correlate(&frame_spectra, 0, 2, &new_corr_ac);
+                spectra_correlate(&frame_spectra, 1, 2, &new_corr_bc);
+            }
+            else
+            {
+                fft_correlations_init(&new_corr_ab, &buffer_a, &buffer_b);
+                fft_correlations_init(&new_corr_ac, &buffer_a, &buffer_c);
+                fft_correlations_init(&new_corr_bc, &buffer_b, &buffer_c);
+            }
+        }
+        else if (CORRELATION_COARSE_TO_FINE || CORRELATION_PRUNED_SEARCH)
+        {
+            correlations_init(&new_corr_ab, &buffer_a, &buffer_b);
+            correlations_init(&new_corr_ac, &buffer_a, &buffer_c);
+            correlations_init(&new_corr_bc, &buffer_b, &buffer_c);
+        }
+        else
+        {
+            // All three pairs in one sweep per block of lags
+            const struct buffer_t *const frames[3] = {&buffer_a, &buffer_b, &buffer_c};
+            struct correlations_t *const corrs[3] = {&new_corr_ab, &new_corr_ac, &new_corr_bc};
+            if (!(DSP_CORE_TEMPLATES && dsp_core_init_pairs(corrs, frames)))
+                correlations_init_pairs(corrs, frames);
+        }
+
+        // 9) Pick the three shifts together so they agree with each other
+        if (JOINT_LAG_SEARCH)
+        {
+            joint_lag_search(&new_corr_ab, &new_corr_ac, &new_corr_bc);
+
+            correlations_apply_prior(&new_corr_ab);
+            correlations_apply_prior(&new_corr_ac);
+            correlations_apply_prior(&new_corr_bc);
+        }
 
-        // 5) Cross-correlation and best-shift detection
-        correlations_init(&new_corr_ab, &buffer_a, &buffer_b);
-        correlations_init(&new_corr_ac, &buffer_a, &buffer_c);
-        correlations_init(&new_corr_bc, &buffer_b, &buffer_c);
+        // Frames without a clear peak on every pair are dropped here
+        if (!correlations_confident(&new_corr_ab) ||
+            !correlations_confident(&new_corr_ac) ||
+            !correlations_confident(&new_corr_bc))
+            continue;
 
         int best_shift_ab = new_corr_ab.best_shift;
         int best_shift_ac = new_corr_ac.best_shift;
@@ -133,18 +378,177 @@ static PT_THREAD(protothread_sample_and_compute(struct pt *pt))
 
         if (shift_total > 4)
         {
-            // 6) Average new correlations with old correlations
+            // 10) Average new correlations with old correlations
+            if (spectra_averaged)
+            {
+                corr_ab = new_corr_ab;
+                corr_ac = new_corr_ac;
+                corr_bc = new_corr_bc;
+            }
+            else
+            {
+                correlations_average(&corr_ab, &new_corr_ab);
+                correlations_average(&corr_ac, &new_corr_ac);
+                correlations_average(&corr_bc, &new_corr_bc);
+            }
+
+            if (JOINT_LAG_SEARCH)
+                joint_lag_search(&corr_ab, &corr_ac, &corr_bc);
+
+            // 11) Signal VGA thread to plot new data
+            PT_SEM_SIGNAL(pt, &vga_semaphore);
+
+            // Wait until VGA thread signals buffer can be loaded
+            PT_SEM_WAIT(pt, &load_audio_semaphore);
+        }
+    }
+
+    PT_END(pt);
+}
+
+#if STREAMING_CORRELATION
+// Everything a block needs after sampling; runs on core 1 and has to
+// finish within the time core 0 takes to sample the next block
+static void stream_process_block(void *arg)
+{
+    struct stream_job_t *job = arg;
+    sample_t(*block)[STREAMING_BLOCK_SIZE] = stream_blocks[job->block];
+    const absolute_time_t started = get_absolute_time();
+
+    job->averaged = false;
+
+    // 2) Band-pass pre-filter, carrying the state across blocks
+    biquad_cascade_filter(&prefilter_a, block[0], STREAMING_BLOCK_SIZE);
+    biquad_cascade_filter(&prefilter_b, block[1], STREAMING_BLOCK_SIZE);
+    biquad_cascade_filter(&prefilter_c, block[2], STREAMING_BLOCK_SIZE);
+
+    // 3) Slide every lag sum forward by one block
+    const sample_t *const blocks[STREAMING_CHANNELS] = {block[0], block[1], block[2]};
+    streaming_correlation_push(&stream, blocks, STREAMING_BLOCK_SIZE);
+
+    if (streaming_correlation_ready(&stream))
+    {
+        // 4) Best shifts of the current window, averaged as for frames
+        streaming_correlation_read(&stream, 0, &new_corr_ab);
+        streaming_correlation_read(&stream, 1, &new_corr_ac);
+        streaming_correlation_read(&stream, 2, &new_corr_bc);
+
+        if (JOINT_LAG_SEARCH)
+        {
+            joint_lag_search(&new_corr_ab, &new_corr_ac, &new_corr_bc);
+
+            correlations_apply_prior(&new_corr_ab);
+            correlations_apply_prior(&new_corr_ac);
+            correlations_apply_prior(&new_corr_bc);
+        }
+
+        if (correlations_confident(&new_corr_ab) &&
+            correlations_confident(&new_corr_ac) &&
+            correlations_confident(&new_corr_bc))
+        {
             correlations_average(&corr_ab, &new_corr_ab);
             correlations_average(&corr_ac, &new_corr_ac);
             correlations_average(&corr_bc, &new_corr_bc);
 
-            // 7) Signal VGA thread to plot new data
-            PT_SEM_SIGNAL(pt, &vga_semaphore);
+            if (JOINT_LAG_SEARCH)
+                joint_lag_search(&corr_ab, &corr_ac, &corr_bc);
 
-            // Wait until VGA thread signals buffer can be loaded
+            job->averaged = true;
+        }
+    }
+
+    job->elapsed_us = absolute_time_diff_us(started, get_absolute_time());
+}
+
+static const struct dual_core_task_t stream_task = {stream_process_block, &stream_job};
+
+static PT_THREAD(protothread_stream_and_compute(struct pt *pt))
+{
+    PT_BEGIN(pt);
+
+    static absolute_time_t deadline;
+    static absolute_time_t last_display;
+    static int fill;
+    static bool busy;
+
+    streaming_correlation_init(&stream);
+
+    // Start the DC estimates at mid-scale rather than learning up from 0
+    for (int c = 0; c < STREAMING_CHANNELS; c++)
+        stream_dc[c] = 128 << 8;
+
+    // The filters run on one unbroken stream, so reset them only once
+    biquad_cascade_reset(&prefilter_a);
+    biquad_cascade_reset(&prefilter_b);
+    biquad_cascade_reset(&prefilter_c);
+
+    deadline = get_absolute_time();
+    last_display = deadline;
+    fill = 0;
+    busy = false;
+    while (true)
+    {
+        // 1) Sample one block per mic, removing the DC offset on the way,
+        // while core 1 works through the previous one
+        for (int i = 0; i < STREAMING_BLOCK_SIZE; i++)
+        {
+            gpio_put(0, 1);
+
+            stream_blocks[fill][0][i] = streaming_remove_dc(&stream_dc[0], dma_sample_array[0]);
+            stream_blocks[fill][1][i] = streaming_remove_dc(&stream_dc[1], dma_sample_array[1]);
+            stream_blocks[fill][2][i] = streaming_remove_dc(&stream_dc[2], dma_sample_array[2]);
+
+            deadline = delayed_by_us(deadline, SAMPLE_PERIOD_US);
+
+            gpio_put(0, 0);
+            busy_wait_until(deadline);
+        }
+
+        // The previous block must be done before this one starts. One that
+        // overran its block period held up the sampling: count it and
+        // restart the clock rather than catch up with samples bunched
+        // together, leaving a gap as the display hand-off does
+        if (busy)
+        {
+            dual_core_join();
+            if (stream_job.elapsed_us > STREAMING_BLOCK_SIZE * SAMPLE_PERIOD_US &&
+                absolute_time_diff_us(deadline, get_absolute_time()) > SAMPLE_PERIOD_US)
+            {
+                stream_overruns++;
+                deadline = get_absolute_time();
+            }
+        }
+
+        // 5) Hand the newest samples to the VGA thread and wait for it;
+        // the gap restarts the sampling clock but the window slides on
+        if (busy && stream_job.averaged &&
+            absolute_time_diff_us(last_display, deadline) >= STREAMING_DISPLAY_INTERVAL_US)
+        {
+            streaming_correlation_write_out(&stream, 0, BUFFER_DEFAULT_SIZE_BITS, &buffer_a);
+            streaming_correlation_write_out(&stream, 1, BUFFER_DEFAULT_SIZE_BITS, &buffer_b);
+            streaming_correlation_write_out(&stream, 2, BUFFER_DEFAULT_SIZE_BITS, &buffer_c);
+
+            if (stream_overruns != stream_overruns_reported)
+            {
+                printf("Streaming overruns: %lu\n", (unsigned long)stream_overruns);
+                stream_overruns_reported = stream_overruns;
+            }
+
+            PT_SEM_SIGNAL(pt, &vga_semaphore);
             PT_SEM_WAIT(pt, &load_audio_semaphore);
+
+            deadline = get_absolute_time();
+            last_display = deadline;
         }
+
+        // 2-4) on core 1
+        stream_job.block = fill;
+        dual_core_start(&stream_task);
+
+        busy = true;
+        fill ^= 1;
     }
 
     PT_END(pt);
 }
+#endif
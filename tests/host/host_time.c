@@ -0,0 +1,3 @@
+#include <pico/time.h>
+
+uint64_t host_time_us;
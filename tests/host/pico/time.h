@@ -0,0 +1,25 @@
+#pragma once
+
+// Host stand-in for the Pico SDK's pico/time.h. The clock only moves when
+// a test sets host_time_us, so time-dependent paths are reproducible
+
+#include <stdint.h>
+
+typedef uint64_t absolute_time_t;
+
+extern uint64_t host_time_us;
+
+static inline absolute_time_t get_absolute_time(void)
+{
+    return host_time_us;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return (int64_t)(to - from);
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
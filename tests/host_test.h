@@ -0,0 +1,44 @@
+#pragma once
+
+// Helpers shared by the host tests. Each test prints what it measured
+// and exits non-zero on any mismatch, which is all CTest looks at
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <components/constants.h>
+#include <components/buffer.h>
+
+// Uniform in -peak..peak, clipped to the sample range; a peak of 32768
+// also produces -32768, the one value whose square overflows int32 pairs
+static inline sample_t host_test_sample(int peak)
+{
+    int value = rand() % (2 * peak + 1) - peak;
+    return (sample_t)(value > INT16_MAX ? INT16_MIN : value);
+}
+
+// Frame of 2^size_bits samples, nonzero only between start and end
+static inline void host_test_frame(struct buffer_t *buf, int size_bits, int start, int end, int peak)
+{
+    buf->size_bits = size_bits;
+    buf->size = 1 << size_bits;
+    buf->start = start;
+    buf->end = end;
+
+    for (int i = 0; i < buf->size; i++)
+        buf->buffer[i] = (i >= start && i < end ? host_test_sample(peak) : 0);
+}
+
+// CPU time since start, in us per repetition
+static inline double host_test_us(clock_t start, int repetitions)
+{
+    return (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / repetitions;
+}
+
+// Prints the outcome of one check; returns 1 if it failed
+static inline int host_test_report(const char *what, long mismatches, long checks)
+{
+    printf("%s: %ld mismatches over %ld checks%s\n", what, mismatches, checks, mismatches ? "  FAILED" : "");
+    return mismatches != 0;
+}
@@ -0,0 +1,272 @@
+// The fixed-point biquad cascade against the same quantized sections run
+// in double precision: the gain at tones across the band, the sample by
+// sample error on noise up to full scale, and the state carried across
+// blocks. Reports how far Q2.30 quantization moves each response from
+// the float design, then the time per frame for 1 to 4 sections
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/biquad.h>
+
+#define FRAME_BITS 12
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define BENCH_REPETITIONS 2000
+
+// Output error allowed against the double model, in LSBs
+#define MAX_ERROR_LSB 3
+
+struct design_t
+{
+    const char *name;
+    int type;
+    float low_hz, high_hz;
+};
+
+static const struct design_t designs[] = {
+    {"high-pass 300 Hz", 0, 300.0f, 0.0f},
+    {"low-pass 8 kHz", 0, 0.0f, 8000.0f},
+    {"band 300 Hz - 8 kHz", 0, 300.0f, 8000.0f},
+    {"band-pass 2 kHz, Q 2", 1, 2000.0f, 2.0f},
+    {"high-pass 100 Hz", 0, 100.0f, 0.0f},
+};
+
+static struct buffer_t frame;
+static double reference[FRAME_SIZE];
+
+static void design(struct biquad_cascade_t *cascade, const struct design_t *d)
+{
+    struct biquad_t bq;
+
+    if (d->type == 0)
+    {
+        biquad_cascade_init_band(cascade, d->low_hz, d->high_hz);
+        return;
+    }
+
+    biquad_cascade_init(cascade);
+    biquad_design_bandpass(&bq, d->low_hz, d->high_hz);
+    biquad_cascade_push(cascade, &bq);
+}
+
+// |H| of the quantized sections at f
+static double quantized_gain(const struct biquad_cascade_t *cascade, double f)
+{
+    const double w = 2.0 * M_PI * f / SAMPLE_RATE_HZ;
+    const double q = 1 << BIQUAD_COEFF_BITS;
+    double gain = 1.0;
+
+    for (int s = 0; s < cascade->num_stages; s++)
+    {
+        const struct biquad_t *bq = &cascade->stages[s];
+        const double nr = bq->b0 / q + bq->b1 / q * cos(w) + bq->b2 / q * cos(2 * w);
+        const double ni = -bq->b1 / q * sin(w) - bq->b2 / q * sin(2 * w);
+        const double dr = 1.0 + bq->a1 / q * cos(w) + bq->a2 / q * cos(2 * w);
+        const double di = -bq->a1 / q * sin(w) - bq->a2 / q * sin(2 * w);
+        gain *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+    }
+
+    return gain;
+}
+
+// |H| of the float RBJ design at f, for the quantization report
+static double design_gain(const struct design_t *d, double f)
+{
+    double gain = 1.0;
+    double corners[2] = {d->low_hz, d->high_hz};
+
+    for (int k = 0; k < 2; k++)
+    {
+        if (corners[k] <= 0.0 || (d->type == 1 && k == 1) || corners[k] >= SAMPLE_RATE_HZ / 2)
+            continue;
+
+        const double w0 = 2.0 * M_PI * corners[k] / SAMPLE_RATE_HZ;
+        const double q = (d->type == 1 ? d->high_hz : 0.70710678);
+        const double alpha = sin(w0) / (2.0 * q);
+        const double c = cos(w0);
+        double b[3];
+
+        if (d->type == 1)
+            b[0] = alpha, b[1] = 0.0, b[2] = -alpha;
+        else if (k == 0)
+            b[0] = (1 + c) / 2, b[1] = -(1 + c), b[2] = (1 + c) / 2;
+        else
+            b[0] = (1 - c) / 2, b[1] = 1 - c, b[2] = (1 - c) / 2;
+
+        const double a[3] = {1 + alpha, -2 * c, 1 - alpha};
+        const double w = 2.0 * M_PI * f / SAMPLE_RATE_HZ;
+        const double nr = b[0] + b[1] * cos(w) + b[2] * cos(2 * w);
+        const double ni = -b[1] * sin(w) - b[2] * sin(2 * w);
+        const double dr = a[0] + a[1] * cos(w) + a[2] * cos(2 * w);
+        const double di = -a[1] * sin(w) - a[2] * sin(2 * w);
+        gain *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+    }
+
+    return gain;
+}
+
+// The quantized sections in double, direct form I, with the int16
+// saturation between sections
+static void reference_filter(const struct biquad_cascade_t *cascade, const sample_t *in, int count)
+{
+    const double q = 1 << BIQUAD_COEFF_BITS;
+
+    for (int i = 0; i < count; i++)
+        reference[i] = in[i];
+
+    for (int s = 0; s < cascade->num_stages; s++)
+    {
+        const struct biquad_t *bq = &cascade->stages[s];
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+
+        for (int i = 0; i < count; i++)
+        {
+            const double x = reference[i];
+            const double y = (bq->b0 * x + bq->b1 * x1 + bq->b2 * x2 - bq->a1 * y1 - bq->a2 * y2) / q;
+            x2 = x1, x1 = x;
+            y2 = y1, y1 = y;
+
+            // Each section hands the next a saturated sample
+            reference[i] = fmax(INT16_MIN, fmin(INT16_MAX, y));
+        }
+    }
+}
+
+// Amplitude of the tone at f over the second half of the frame
+static double tone_amplitude(const sample_t *samples, double f)
+{
+    double sc = 0.0, ss = 0.0;
+
+    for (int i = FRAME_SIZE / 2; i < FRAME_SIZE; i++)
+    {
+        const double w = 2.0 * M_PI * f * i / SAMPLE_RATE_HZ;
+        sc += samples[i] * cos(w);
+        ss += samples[i] * sin(w);
+    }
+
+    return 2.0 * sqrt(sc * sc + ss * ss) / (FRAME_SIZE / 2);
+}
+
+static int check_response(const struct design_t *d)
+{
+    struct biquad_cascade_t cascade;
+    const double amplitude = 16000.0;
+    long mismatches = 0;
+    long checks = 0;
+    double worst_design_db = 0.0;
+
+    design(&cascade, d);
+
+    // Whole periods over the half frame measured, so the fit is exact
+    for (int k = 2; k < FRAME_SIZE / 4; k += 1 + k / 4)
+    {
+        const double f = (double)k * SAMPLE_RATE_HZ / (FRAME_SIZE / 2);
+
+        host_test_frame(&frame, FRAME_BITS, 0, FRAME_SIZE, 0);
+        for (int i = 0; i < FRAME_SIZE; i++)
+            frame.buffer[i] = (sample_t)lrint(amplitude * sin(2.0 * M_PI * f * i / SAMPLE_RATE_HZ));
+
+        biquad_cascade_reset(&cascade);
+        biquad_cascade_process(&cascade, &frame);
+
+        const double expected = quantized_gain(&cascade, f) * amplitude;
+        const double measured = tone_amplitude(frame.buffer, f);
+
+        checks++;
+        mismatches += (fabs(measured - expected) > MAX_ERROR_LSB + 1e-3 * expected);
+
+        const double design = design_gain(d, f);
+        if (design > 0.1)
+            worst_design_db = fmax(worst_design_db, fabs(20.0 * log10(quantized_gain(&cascade, f) / design)));
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "%s gain (Q2.30 within %.3f dB of design above -20 dB)", d->name, worst_design_db);
+    return host_test_report(what, mismatches, checks);
+}
+
+static int check_noise(const struct design_t *d)
+{
+    static const int peaks[3] = {1000, 16000, 32768};
+    struct biquad_cascade_t cascade;
+    long mismatches = 0;
+    long checks = 0;
+    double worst = 0.0;
+
+    design(&cascade, d);
+
+    for (int k = 0; k < 3; k++)
+    {
+        host_test_frame(&frame, FRAME_BITS, 0, FRAME_SIZE, peaks[k]);
+        reference_filter(&cascade, frame.buffer, FRAME_SIZE);
+
+        // Pushed in uneven blocks to check the carried state
+        biquad_cascade_reset(&cascade);
+        for (int i = 0; i < FRAME_SIZE;)
+        {
+            const int count = (FRAME_SIZE - i < 97 ? FRAME_SIZE - i : 1 + rand() % 97);
+            biquad_cascade_filter(&cascade, &frame.buffer[i], count);
+            i += count;
+        }
+
+        for (int i = 0; i < FRAME_SIZE; i++)
+        {
+            // Only where the output is not saturated
+            if (fabs(reference[i]) >= INT16_MAX)
+                continue;
+
+            const double error = fabs(frame.buffer[i] - reference[i]);
+            worst = fmax(worst, error);
+            checks++;
+            mismatches += (error > MAX_ERROR_LSB);
+        }
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "%s on noise, worst error %.2f LSB", d->name, worst);
+    return host_test_report(what, mismatches, checks);
+}
+
+static void bench(void)
+{
+    struct biquad_cascade_t cascade;
+    struct biquad_t bq;
+
+    biquad_design_highpass(&bq, 300.0f, 0.70710678f);
+    biquad_cascade_init(&cascade);
+
+    for (int stages = 1; stages <= BIQUAD_MAX_STAGES; stages++)
+    {
+        biquad_cascade_push(&cascade, &bq);
+
+        for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits += 2)
+        {
+            host_test_frame(&frame, size_bits, 0, 1 << size_bits, 16000);
+
+            const clock_t start = clock();
+            for (int r = 0; r < BENCH_REPETITIONS; r++)
+                biquad_cascade_process(&cascade, &frame);
+            const double us = host_test_us(start, BENCH_REPETITIONS);
+
+            printf("%d section%s, n = %4d: %7.1f us per frame, %5.2f ns per sample and section\n", stages,
+                   stages > 1 ? "s" : " ", 1 << size_bits, us, us * 1e3 / (stages << size_bits));
+        }
+    }
+}
+
+int main(void)
+{
+    int failed = 0;
+
+    srand(26);
+    for (unsigned d = 0; d < sizeof(designs) / sizeof(designs[0]); d++)
+    {
+        failed |= check_response(&designs[d]);
+        failed |= check_noise(&designs[d]);
+    }
+
+    bench();
+
+    return failed;
+}
@@ -0,0 +1,222 @@
+// The coarse-to-fine search in correlations_init against the exhaustive
+// sweep on the same frames. Lags it refines must hold the exact sums; the
+// lags it fills in from the decimated correlation must be marked, stay
+// below the refined peak, never be listed as peaks, be left out of the
+// peak-to-sidelobe ratio, and leave a running average alone. Over white
+// noise, a tone-like signal and a clap with an echo, at several SNRs
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/dot_product.h>
+
+#define FRAMES 400
+#define FRAME_BITS 10
+
+// Peak-to-sidelobe ratio allowed against double over the exact lags,
+// relative, plus a Q8 step for rounding
+#define MAX_PSR_ERROR 0.01
+
+// Frames apart in the running-average check
+#define AVERAGE_STEP_US 20000
+
+static struct buffer_t frame_a;
+static struct buffer_t frame_b;
+static struct correlations_t coarse;
+static struct correlations_t exhaustive;
+static struct correlations_t average;
+static double source[(1 << FRAME_BITS) + 128];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, value));
+}
+
+static void random_frames(int kind, int delay, double noise)
+{
+    const int size = 1 << FRAME_BITS;
+    const double level = 4000.0;
+
+    for (int i = 0; i < size + 128; i++)
+        source[i] = 0.0;
+
+    if (kind == 0)
+    {
+        for (int i = 0; i < size + 128; i++)
+            source[i] = gaussian() * level;
+    }
+    else if (kind == 1)
+    {
+        double phase = 0.0;
+        for (int i = 0; i < size + 128; i++)
+        {
+            phase += 0.2 + 0.1 * sin(i * 0.01);
+            source[i] = level * (sin(phase) + 0.3 * gaussian());
+        }
+    }
+    else
+    {
+        const int onset = 200 + rand() % 300;
+        for (int i = onset; i < size + 128; i++)
+            source[i] = gaussian() * level * 3.0 * exp(-(i - onset) / 80.0);
+        for (int i = onset + 40; i < size + 128; i++)
+            source[i] += 0.5 * source[i - 40];
+    }
+
+    host_test_frame(&frame_a, FRAME_BITS, 0, size, 0);
+    host_test_frame(&frame_b, FRAME_BITS, 0, size, 0);
+    for (int i = 0; i < size; i++)
+    {
+        frame_a.buffer[i] = clip(source[i + 64] + gaussian() * level * noise);
+        frame_b.buffer[i] = clip(source[i + 64 - delay] + gaussian() * level * noise);
+    }
+
+    buffer_window(&frame_a);
+    buffer_window(&frame_b);
+}
+
+static void exhaustive_search(void)
+{
+    const int headroom = dot_product_headroom(buffer_peak(&frame_a), buffer_peak(&frame_b));
+
+    correlations_set_energies(&exhaustive, buffer_energy(&frame_a), buffer_energy(&frame_b));
+    correlations_compute_range(&exhaustive, &frame_a, &frame_b, -exhaustive.max_shift, exhaustive.max_shift, headroom);
+    correlations_finish(&exhaustive);
+}
+
+// The ratio over the exact lags outside the peak's zone, in double
+static double expected_psr_q8(const struct correlations_t *corr)
+{
+    const int best = corr->best_shift + MAX_SHIFT_SAMPLES;
+    double sum = 0.0, sum_squares = 0.0;
+    int count = 0;
+
+    for (int i = MAX_SHIFT_SAMPLES - corr->max_shift; i <= MAX_SHIFT_SAMPLES + corr->max_shift; i++)
+    {
+        if (corr->estimated[i] || (i >= best - CORRELATION_PEAK_SEPARATION && i <= best + CORRELATION_PEAK_SEPARATION))
+            continue;
+
+        sum += (double)corr->correlations[i];
+        sum_squares += (double)corr->correlations[i] * corr->correlations[i];
+        count++;
+    }
+
+    if (count < 2)
+        return 0.0;
+
+    const double mean = sum / count;
+    const double deviation = sqrt(fmax(0.0, sum_squares / count - mean * mean));
+    return (deviation > 0.0 ? 256.0 * ((double)corr->correlations[best] - mean) / deviation : 0.0);
+}
+
+// Mismatches in one frame that took the coarse path
+static int compare(void)
+{
+    const power_t peak = coarse.correlations[coarse.best_shift + MAX_SHIFT_SAMPLES];
+    int mismatches = (coarse.estimated[coarse.best_shift + MAX_SHIFT_SAMPLES]);
+
+    for (int s = -coarse.max_shift; s <= coarse.max_shift; s++)
+    {
+        const int i = s + MAX_SHIFT_SAMPLES;
+
+        if (coarse.estimated[i])
+            mismatches += (coarse.correlations[i] >= peak);
+        else
+            mismatches += (coarse.correlations[i] != exhaustive.correlations[i]);
+    }
+
+    for (int k = 0; k < coarse.num_peaks; k++)
+        mismatches += coarse.estimated[coarse.peaks[k].shift + MAX_SHIFT_SAMPLES];
+
+    const double expected = expected_psr_q8(&coarse);
+    mismatches += (fabs(coarse.peak_to_sidelobe_q8 - expected) > MAX_PSR_ERROR * fabs(expected) + 1.0);
+
+    // An average of exact frames takes the frame's exact lags a step
+    // towards it and keeps its own value at the estimated ones
+    average = exhaustive;
+    average.last_update = host_time_us;
+    host_time_us += AVERAGE_STEP_US;
+    correlations_average(&average, &coarse);
+
+    for (int i = MAX_SHIFT_SAMPLES - coarse.max_shift; i <= MAX_SHIFT_SAMPLES + coarse.max_shift; i++)
+    {
+        const power_t value = average.correlations[i];
+
+        mismatches += average.estimated[i];
+        if (coarse.estimated[i])
+            mismatches += (value != exhaustive.correlations[i]);
+        else
+            mismatches += (value < (exhaustive.correlations[i] < coarse.correlations[i] ? exhaustive.correlations[i]
+                                                                                       : coarse.correlations[i]) ||
+                           value > (exhaustive.correlations[i] > coarse.correlations[i] ? exhaustive.correlations[i]
+                                                                                       : coarse.correlations[i]));
+    }
+
+    return mismatches;
+}
+
+// True when the last correlations_init took the coarse path
+static bool took_coarse(void)
+{
+    for (int s = -coarse.max_shift; s <= coarse.max_shift; s++)
+        if (coarse.estimated[s + MAX_SHIFT_SAMPLES])
+            return true;
+    return false;
+}
+
+int main(void)
+{
+    static const char *const kinds[3] = {"white", "tonal", "clap"};
+    static const double snrs_db[3] = {0.0, 10.0, 30.0};
+    int failed = 0;
+
+    correlations_tables_init();
+    host_time_us = 1000000;
+
+    for (int kind = 0; kind < 3; kind++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            const double noise = pow(10.0, -snrs_db[k] / 20.0);
+            long mismatches = 0;
+            long checks = 0;
+
+            srand(37 + kind);
+            correlations_set_range(&coarse, MAX_SHIFT_AC_SAMPLES);
+            correlations_set_range(&exhaustive, MAX_SHIFT_AC_SAMPLES);
+
+            for (int f = 0; f < FRAMES; f++)
+            {
+                random_frames(kind, rand() % 41 - 20, noise);
+
+                correlations_init(&coarse, &frame_a, &frame_b);
+                exhaustive_search();
+
+                if (!took_coarse())
+                {
+                    mismatches += (coarse.best_shift != exhaustive.best_shift);
+                    continue;
+                }
+
+                mismatches += compare();
+                checks++;
+            }
+
+            char what[96];
+            snprintf(what, sizeof(what), "%s at %2.0f dB, %3ld of %d frames coarse to fine", kinds[kind], snrs_db[k],
+                     checks, FRAMES);
+            failed |= host_test_report(what, mismatches, FRAMES);
+        }
+    }
+
+    return failed;
+}
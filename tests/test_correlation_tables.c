@@ -0,0 +1,211 @@
+// The lookup tables correlations_tables_init builds, against exp() in
+// double: the Gaussian prior applied to random correlations of every
+// magnitude the engines produce, and the running average's blend weight
+// 1 - exp(-dt / tau) over gaps up to the reset. Then what each table
+// costs on the host against calling expf() per lag or per frame, as the
+// code did before them; the host has an FPU, where the RP2040 runs expf
+// in software
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+
+#define TRIALS 20000
+#define DECAY_CHECKS 20000
+#define BENCH_REPETITIONS 20000
+
+// Prior error allowed relative to the peak: a Q15 step of the table plus
+// rounding
+#define MAX_PRIOR_ERROR (1.0 / 32768.0)
+
+// Blend weight error allowed in Q16 steps; the table interpolates
+// linearly between steps of up to 2^14 us
+#define MAX_DECAY_ERROR 16.0
+
+static struct correlations_t corr;
+static struct correlations_t estimate;
+static struct correlations_t frame;
+static double expected[CORRELATION_BUFFER_SIZE];
+
+// 2^20 .. 2^46 in magnitude, either sign
+static power_t random_correlation(int bits)
+{
+    const power_t magnitude = (((power_t)rand() << 31) ^ rand()) & (((power_t)1 << bits) - 1);
+    return (rand() & 1 ? -magnitude : magnitude);
+}
+
+static int check_prior(void)
+{
+    long mismatches = 0;
+    double worst = 0.0;
+
+    srand(41);
+    for (int t = 0; t < TRIALS; t++)
+    {
+        const int bits = 20 + t % 27;
+        double peak = 1.0;
+
+        corr.best_shift = rand() % (2 * corr.max_shift + 1) - corr.max_shift;
+        for (int s = -corr.max_shift; s <= corr.max_shift; s++)
+        {
+            const double d = (s - corr.best_shift) / CORRELATION_PRIOR_WIDTH_SAMPLES;
+
+            corr.correlations[s + MAX_SHIFT_SAMPLES] = random_correlation(bits);
+            expected[s + MAX_SHIFT_SAMPLES] = corr.correlations[s + MAX_SHIFT_SAMPLES] * exp(-d * d);
+            peak = fmax(peak, fabs((double)corr.correlations[s + MAX_SHIFT_SAMPLES]));
+        }
+
+        correlations_apply_prior(&corr);
+
+        double error = 0.0;
+        for (int s = -corr.max_shift; s <= corr.max_shift; s++)
+            error = fmax(error, fabs(corr.correlations[s + MAX_SHIFT_SAMPLES] - expected[s + MAX_SHIFT_SAMPLES]) / peak);
+
+        worst = fmax(worst, error);
+        mismatches += (error > MAX_PRIOR_ERROR);
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "prior vs exp(), worst error %.1e of the peak", worst);
+    return host_test_report(what, mismatches, TRIALS);
+}
+
+// The blend weight an update applies after dt, read back from averaging
+// a frame of 2^40 into an estimate of zero
+static double decay_q16(uint32_t dt)
+{
+    for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+    {
+        estimate.correlations[i] = 0;
+        frame.correlations[i] = (power_t)1 << 40;
+    }
+
+    estimate.last_update = host_time_us;
+    host_time_us += dt;
+    correlations_average(&estimate, &frame);
+
+    return estimate.correlations[MAX_SHIFT_SAMPLES] / (double)((power_t)1 << 24);
+}
+
+static int check_decay(void)
+{
+    const double tau_us = CORRELATION_AVERAGE_TAU_S * 1e6;
+    long mismatches = 0;
+    double worst = 0.0;
+
+    srand(42);
+    for (int t = 0; t < DECAY_CHECKS; t++)
+    {
+        const uint32_t dt = (t < 64 ? (uint32_t)t : (uint32_t)(rand() % CORRELATION_AVERAGE_RESET_US));
+        const double error = fabs(decay_q16(dt) - (1.0 - exp(-(double)dt / tau_us)) * 65536.0);
+
+        worst = fmax(worst, error);
+        mismatches += (error > MAX_DECAY_ERROR);
+    }
+
+    // From the reset gap on, the frame replaces the estimate
+    mismatches += (decay_q16(CORRELATION_AVERAGE_RESET_US) != 65536.0);
+
+    char what[96];
+    snprintf(what, sizeof(what), "blend weight vs 1 - exp(-dt / tau), worst %.2f Q16 steps", worst);
+    return host_test_report(what, mismatches, DECAY_CHECKS + 1);
+}
+
+// The prior as it was before the table: expf per lag on a float product
+static void prior_expf(struct correlations_t *c)
+{
+    for (int s = -c->max_shift; s <= c->max_shift; s++)
+    {
+        const float x = (s - c->best_shift) / CORRELATION_PRIOR_WIDTH_SAMPLES;
+        c->correlations[s + MAX_SHIFT_SAMPLES] = (power_t)(c->correlations[s + MAX_SHIFT_SAMPLES] * expf(-x * x));
+    }
+}
+
+// The average as it was before the table: expf per frame, then a float
+// blend per lag and the same scan for the best shift
+static void average_expf(struct correlations_t *est, const struct correlations_t *data, uint32_t dt)
+{
+    const float decay = 1.0f - expf(-(float)dt * 1e-6f / CORRELATION_AVERAGE_TAU_S);
+    power_t best = INT64_MIN;
+
+    for (int i = MAX_SHIFT_SAMPLES - est->max_shift; i <= MAX_SHIFT_SAMPLES + est->max_shift; i++)
+    {
+        est->correlations[i] += (power_t)((data->correlations[i] - est->correlations[i]) * decay);
+        if (est->correlations[i] > best)
+        {
+            best = est->correlations[i];
+            est->best_shift = i - MAX_SHIFT_SAMPLES;
+        }
+    }
+}
+
+static void bench(void)
+{
+    volatile power_t sink = 0;
+
+    srand(1);
+    for (int s = -corr.max_shift; s <= corr.max_shift; s++)
+        frame.correlations[s + MAX_SHIFT_SAMPLES] = random_correlation(40);
+
+    printf("\nus per pair on the host, %d lags\n", 2 * corr.max_shift + 1);
+    printf("stage   | table | expf\n");
+
+    clock_t start = clock();
+    for (int r = 0; r < BENCH_REPETITIONS; r++)
+    {
+        corr = frame;
+        corr.best_shift = r % 9 - 4;
+        correlations_apply_prior(&corr);
+        sink += corr.correlations[MAX_SHIFT_SAMPLES];
+    }
+    const double prior_table_us = host_test_us(start, BENCH_REPETITIONS);
+
+    start = clock();
+    for (int r = 0; r < BENCH_REPETITIONS; r++)
+    {
+        corr = frame;
+        corr.best_shift = r % 9 - 4;
+        prior_expf(&corr);
+        sink += corr.correlations[MAX_SHIFT_SAMPLES];
+    }
+    const double prior_expf_us = host_test_us(start, BENCH_REPETITIONS);
+
+    printf("prior   | %5.3f | %5.3f\n", prior_table_us, prior_expf_us);
+
+    start = clock();
+    for (int r = 0; r < BENCH_REPETITIONS; r++)
+    {
+        estimate.last_update = host_time_us;
+        host_time_us += 20000 + r % 1000;
+        correlations_average(&estimate, &frame);
+        sink += estimate.correlations[MAX_SHIFT_SAMPLES];
+    }
+    const double average_table_us = host_test_us(start, BENCH_REPETITIONS);
+
+    start = clock();
+    for (int r = 0; r < BENCH_REPETITIONS; r++)
+    {
+        average_expf(&estimate, &frame, 20000 + r % 1000);
+        sink += estimate.correlations[MAX_SHIFT_SAMPLES];
+    }
+    const double average_expf_us = host_test_us(start, BENCH_REPETITIONS);
+
+    printf("average | %5.3f | %5.3f\n", average_table_us, average_expf_us);
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    correlations_set_range(&corr, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&estimate, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&frame, MAX_SHIFT_AC_SAMPLES);
+    host_time_us = 1000000;
+
+    int failed = check_prior();
+    failed |= check_decay();
+    bench();
+
+    return failed;
+}
@@ -0,0 +1,138 @@
+// correlations_compute_pairs, which fuses the lags the three pairs share
+// into one sweep, against correlations_compute_range on each pair alone,
+// over random spans and lag ranges and with the lags split in two as the
+// dual-core engine does. Then the time per frame of both
+
+#include <host_test.h>
+
+#include <components/correlations.h>
+#include <components/dot_product.h>
+
+#define FRAMES 3000
+#define BENCH_REPETITIONS 500
+
+static const int pair_a[3] = {0, 0, 1};
+static const int pair_b[3] = {1, 2, 2};
+
+static struct buffer_t frames[3];
+static struct correlations_t per_pair[3];
+static struct correlations_t fused[3];
+
+static void compute_per_pair(void)
+{
+    for (int p = 0; p < 3; p++)
+    {
+        const struct buffer_t *x = &frames[pair_a[p]];
+        const struct buffer_t *y = &frames[pair_b[p]];
+        const int headroom = dot_product_headroom(buffer_peak(x), buffer_peak(y));
+
+        correlations_compute_range(&per_pair[p], x, y, -per_pair[p].max_shift, per_pair[p].max_shift, headroom);
+    }
+}
+
+static int check_fused(void)
+{
+    static const int ranges[4][3] = {
+        {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES},
+        {MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES},
+        {3, 5, 1},
+        {0, 0, 0},
+    };
+    static const int peaks[3] = {32767, 2000, 100};
+
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const fused_corrs[3] = {&fused[0], &fused[1], &fused[2]};
+    long mismatches = 0;
+    long checks = 0;
+
+    srand(45);
+    for (int t = 0; t < FRAMES; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + rand() % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+        const int size = 1 << size_bits;
+
+        // Half the frames share one span, as after the onset window
+        const bool common_span = rand() % 2;
+        const int common_start = rand() % (size / 2);
+        const int common_end = common_start + 1 + rand() % (size - common_start);
+
+        for (int c = 0; c < 3; c++)
+        {
+            const int start = (common_span ? common_start : rand() % (size / 2));
+            const int end = (common_span ? common_end : start + 1 + rand() % (size - start));
+            host_test_frame(&frames[c], size_bits, start, end, peaks[t % 3]);
+        }
+
+        for (int p = 0; p < 3; p++)
+        {
+            correlations_set_range(&per_pair[p], ranges[t % 4][p]);
+            correlations_set_range(&fused[p], ranges[t % 4][p]);
+        }
+
+        compute_per_pair();
+
+        if (t & 1)
+        {
+            const int split = rand() % (2 * MAX_SHIFT_SAMPLES + 3) - MAX_SHIFT_SAMPLES - 1;
+            correlations_compute_pairs(fused_corrs, bufs, -MAX_SHIFT_SAMPLES, split - 1);
+            correlations_compute_pairs(fused_corrs, bufs, split, MAX_SHIFT_SAMPLES);
+        }
+        else
+        {
+            correlations_compute_pairs(fused_corrs, bufs, -MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES);
+        }
+
+        for (int p = 0; p < 3; p++)
+        {
+            for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+            {
+                checks++;
+                mismatches += (fused[p].correlations[i] != per_pair[p].correlations[i]);
+            }
+        }
+    }
+
+    return host_test_report("fused sweep vs per-pair", mismatches, checks);
+}
+
+static void bench(void)
+{
+    static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const fused_corrs[3] = {&fused[0], &fused[1], &fused[2]};
+
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        for (int c = 0; c < 3; c++)
+            host_test_frame(&frames[c], size_bits, 0, 1 << size_bits, 10000);
+
+        for (int p = 0; p < 3; p++)
+        {
+            correlations_set_range(&per_pair[p], max_shifts[p]);
+            correlations_set_range(&fused[p], max_shifts[p]);
+        }
+
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            compute_per_pair();
+        const double per_pair_us = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlations_compute_pairs(fused_corrs, bufs, -MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES);
+
+        printf("n = %4d: per pair %7.1f us, fused %7.1f us\n", 1 << size_bits, per_pair_us,
+               host_test_us(start, BENCH_REPETITIONS));
+    }
+}
+
+int main(void)
+{
+    correlations_tables_init();
+
+    const int failed = check_fused();
+    bench();
+
+    return failed;
+}
@@ -0,0 +1,163 @@
+// correlations_simd_compute_pairs with each x86 kernel against the C
+// sweep, which they must match bit for bit, then timings of all of them
+// across frame lengths. The component source is included so the test can
+// swap the kernel the CPU dispatch would pick
+
+#include <components/correlations_simd.c>
+
+#include <host_test.h>
+
+#define FRAMES 4000
+#define BENCH_REPETITIONS 500
+
+#if CORRELATIONS_SIMD
+
+struct kernel_t
+{
+    const char *name;
+    simd_dot_t dot;
+};
+
+static const struct kernel_t kernels[] = {
+    {"avx2", dot_avx2},
+    {"sse4.1", dot_sse41},
+    {"scalar", dot_product_c},
+};
+
+#define KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+static struct buffer_t frames[3];
+static struct correlations_t reference[3];
+static struct correlations_t simd[3];
+
+static bool kernel_supported(const struct kernel_t *kernel)
+{
+    __builtin_cpu_init();
+
+    if (kernel->dot == dot_avx2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel->dot == dot_sse41)
+        return __builtin_cpu_supports("sse4.1");
+
+    return true;
+}
+
+// Full scale, at the -32768 edge, and quiet, over whole and partial spans
+static void random_frames(int t)
+{
+    static const int peaks[4] = {32768, 32767, 2000, 100};
+    const int size_bits = BUFFER_MIN_SIZE_BITS + rand() % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+    const int size = 1 << size_bits;
+
+    for (int c = 0; c < 3; c++)
+    {
+        const int start = (t & 1 ? rand() % (size / 2) : 0);
+        const int end = (t & 1 ? start + 1 + rand() % (size - start) : size);
+        host_test_frame(&frames[c], size_bits, start, end, peaks[t % 4]);
+    }
+}
+
+static int check_kernels(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const reference_corrs[3] = {&reference[0], &reference[1], &reference[2]};
+    struct correlations_t *const simd_corrs[3] = {&simd[0], &simd[1], &simd[2]};
+    int failed = 0;
+
+    for (int k = 0; k < KERNELS; k++)
+    {
+        if (!kernel_supported(&kernels[k]))
+        {
+            printf("%s: not supported by this CPU, skipped\n", kernels[k].name);
+            continue;
+        }
+
+        long mismatches = 0;
+        long checks = 0;
+        srand(47);
+
+        for (int t = 0; t < FRAMES; t++)
+        {
+            random_frames(t);
+
+            for (int p = 0; p < 3; p++)
+            {
+                correlations_set_range(&reference[p], max_shifts[p]);
+                correlations_set_range(&simd[p], max_shifts[p]);
+            }
+
+            correlations_compute_pairs(reference_corrs, bufs, -MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES);
+            simd_dot = kernels[k].dot;
+            correlations_simd_compute_pairs(simd_corrs, bufs);
+
+            for (int p = 0; p < 3; p++)
+            {
+                for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+                {
+                    checks++;
+                    mismatches += (simd[p].correlations[i] != reference[p].correlations[i]);
+                }
+            }
+        }
+
+        char what[64];
+        snprintf(what, sizeof(what), "%s vs C sweep", kernels[k].name);
+        failed |= host_test_report(what, mismatches, checks);
+    }
+
+    return failed;
+}
+
+static void bench(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const reference_corrs[3] = {&reference[0], &reference[1], &reference[2]};
+    struct correlations_t *const simd_corrs[3] = {&simd[0], &simd[1], &simd[2]};
+
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        for (int c = 0; c < 3; c++)
+            host_test_frame(&frames[c], size_bits, 0, 1 << size_bits, 10000);
+
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlations_compute_pairs(reference_corrs, bufs, -MAX_SHIFT_SAMPLES, MAX_SHIFT_SAMPLES);
+        printf("n = %4d: C sweep %7.1f us", 1 << size_bits, host_test_us(start, BENCH_REPETITIONS));
+
+        for (int k = 0; k < KERNELS; k++)
+        {
+            if (!kernel_supported(&kernels[k]))
+                continue;
+
+            simd_dot = kernels[k].dot;
+            start = clock();
+            for (int r = 0; r < BENCH_REPETITIONS; r++)
+                correlations_simd_compute_pairs(simd_corrs, bufs);
+            printf(", %s %7.1f us", kernels[k].name, host_test_us(start, BENCH_REPETITIONS));
+        }
+        printf("\n");
+    }
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    printf("CPU dispatch picks %s\n", correlations_simd_backend());
+
+    const int failed = check_kernels();
+    bench();
+
+    return failed;
+}
+
+#else
+
+int main(void)
+{
+    printf("no x86 SIMD kernels on this host, skipped\n");
+    return 0;
+}
+
+#endif
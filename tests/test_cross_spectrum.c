@@ -0,0 +1,179 @@
+// Cross-spectrum averaging against lag-domain averaging on a stationary
+// source. Each sequence holds one source at a fixed delay under noise
+// loud enough that a single frame often misses it; frame after frame the
+// pair is correlated both ways: cross_spectrum_accumulate and
+// cross_spectrum_correlate, and fft_correlations_init followed by
+// correlations_average, one frame length apart. Reports how often each
+// has the exact shift after so many frames. The spectral average must
+// converge within CONVERGED_FRAMES and do at least as well as the lag
+// average from there on. Then the restarts: a gap past the reset and a
+// new frame length each start the average over
+//
+// Registered on the defaults (PHAT) and with GCC_WEIGHTING NONE
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define FRAME_US ((uint32_t)FRAME_SIZE * SAMPLE_PERIOD_US)
+#define SEQUENCES 100
+#define FRAMES 40
+
+// Noise per mic relative to the source
+#define NOISE_LEVEL 3.0
+
+// Frames after which the spectral average must have the exact shift at
+// MIN_CONVERGED_RATE: a few times the 2^CROSS_SPECTRUM_FORGET_BITS frames
+// it remembers
+#define CONVERGED_FRAMES (2 << CROSS_SPECTRUM_FORGET_BITS)
+#define MIN_CONVERGED_RATE 0.9
+
+// Slack on the lag average's rate, for sequences where both are close
+#define RATE_SLACK 0.02
+
+static struct buffer_t frames[2];
+static struct spectra_t spectra;
+static struct cross_spectrum_t average;
+static struct correlations_t spectral;
+static struct correlations_t lag_frame;
+static struct correlations_t lag_average;
+static double source[FRAME_SIZE + 2 * MAX_SHIFT_SAMPLES];
+
+static long spectral_exact[FRAMES];
+static long lag_exact[FRAMES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// A fresh stretch of the source, reaching the second mic delay samples
+// after the first, with independent noise on each
+static void make_frames(int size_bits, int delay)
+{
+    const int size = 1 << size_bits;
+
+    for (int i = 0; i < size + 2 * MAX_SHIFT_SAMPLES; i++)
+        source[i] = gaussian();
+
+    for (int c = 0; c < 2; c++)
+    {
+        host_test_frame(&frames[c], size_bits, 0, size, 0);
+        for (int i = 0; i < size; i++)
+            frames[c].buffer[i] =
+                clip(2000.0 * (source[i + MAX_SHIFT_SAMPLES - (c ? delay : 0)] + NOISE_LEVEL * gaussian()));
+        buffer_window(&frames[c]);
+    }
+}
+
+static bool correlate_frame(void)
+{
+    const struct buffer_t *const bufs[2] = {&frames[0], &frames[1]};
+    if (!spectra_compute(&spectra, bufs, 2))
+        return false;
+
+    cross_spectrum_accumulate(&average, &spectra, 0, 1);
+    cross_spectrum_correlate(&average, &spectral);
+
+    fft_correlations_init(&lag_frame, &frames[0], &frames[1]);
+    correlations_average(&lag_average, &lag_frame);
+    return true;
+}
+
+static int check_convergence(void)
+{
+    const int range = MAX_SHIFT_AC_SAMPLES - CORRELATION_LAG_MARGIN_SAMPLES;
+    long mismatches = 0;
+
+    srand(49);
+    for (int q = 0; q < SEQUENCES; q++)
+    {
+        const int delay = rand() % (2 * range + 1) - range;
+
+        // Both averages restart on the first frame of a sequence
+        host_time_us += CORRELATION_AVERAGE_RESET_US;
+
+        for (int f = 0; f < FRAMES; f++)
+        {
+            make_frames(FRAME_BITS, delay);
+            mismatches += !correlate_frame();
+            host_time_us += FRAME_US;
+
+            spectral_exact[f] += (spectral.best_shift == delay);
+            lag_exact[f] += (lag_average.best_shift == delay);
+        }
+    }
+
+    printf("frames | spectral | lag-domain\n");
+    for (int f = 0; f < FRAMES; f++)
+    {
+        if ((f & (f + 1)) == 0 || f == FRAMES - 1)
+            printf("%6d | %8.2f | %10.2f\n", f + 1, (double)spectral_exact[f] / SEQUENCES,
+                   (double)lag_exact[f] / SEQUENCES);
+    }
+
+    int converged = FRAMES;
+    for (int f = FRAMES - 1; f >= 0 && spectral_exact[f] >= MIN_CONVERGED_RATE * SEQUENCES; f--)
+        converged = f;
+
+    for (int f = CONVERGED_FRAMES - 1; f < FRAMES; f++)
+    {
+        mismatches += (spectral_exact[f] < MIN_CONVERGED_RATE * SEQUENCES);
+        mismatches += (spectral_exact[f] < lag_exact[f] - RATE_SLACK * SEQUENCES);
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "spectral average exact from frame %d, lag average no better", converged + 1);
+    return host_test_report(what, mismatches, (long)SEQUENCES * FRAMES + 2 * (FRAMES - CONVERGED_FRAMES + 1));
+}
+
+// Frames counted since the last restart, after one more frame dt later
+static int frames_after(int size_bits, uint32_t dt)
+{
+    host_time_us += dt;
+    make_frames(size_bits, 0);
+    correlate_frame();
+    return average.frames;
+}
+
+static int check_restarts(void)
+{
+    long mismatches = 0;
+
+    frames_after(FRAME_BITS, CORRELATION_AVERAGE_RESET_US);
+    mismatches += (frames_after(FRAME_BITS, FRAME_US) != 2);
+    mismatches += (frames_after(FRAME_BITS, CORRELATION_AVERAGE_RESET_US - 1) != 3);
+    mismatches += (frames_after(FRAME_BITS, CORRELATION_AVERAGE_RESET_US) != 1);
+    mismatches += (frames_after(FRAME_BITS, FRAME_US) != 2);
+    mismatches += (frames_after(FRAME_BITS - 1, FRAME_US) != 1);
+    mismatches += (average.size_bits != spectra.size_bits);
+
+    return host_test_report("average restarts after the reset gap and on a new frame length", mismatches, 6);
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    correlations_set_range(&spectral, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&lag_frame, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&lag_average, MAX_SHIFT_AC_SAMPLES);
+    host_time_us = 10000000;
+
+    int failed = check_convergence();
+    failed |= check_restarts();
+
+    return failed;
+}
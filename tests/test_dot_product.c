@@ -0,0 +1,92 @@
+// dot_product (the Thumb-1 kernels where DOT_PRODUCT_ASM is set) and
+// dot_product_c against a plain 64-bit sum, at every halfword alignment
+// of both inputs and at peaks that select each blocking, down to all
+// -32768 where a single int32 block of two products would overflow
+
+#include <host_test.h>
+
+#include <components/dot_product.h>
+
+#define TRIALS 20000
+#define MAX_LENGTH 300
+
+static sample_t a[MAX_LENGTH + 2];
+static sample_t b[MAX_LENGTH + 2];
+
+static int32_t peak_of(const sample_t *x, int n)
+{
+    int32_t peak = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const int32_t magnitude = (x[i] < 0 ? -(int32_t)x[i] : x[i]);
+        peak = (magnitude > peak ? magnitude : peak);
+    }
+    return peak;
+}
+
+static int check_headroom(void)
+{
+    static const int32_t peaks[] = {0, 1, 100, 1000, 3000, 11585, 16000, 16384, 23170, 32767, 32768};
+    const int count = sizeof(peaks) / sizeof(peaks[0]);
+    long mismatches = 0;
+
+    // headroom products at the peaks fit in int32, one more need not
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < count; j++)
+        {
+            const int64_t worst = (int64_t)peaks[i] * peaks[j];
+            const int headroom = dot_product_headroom(peaks[i], peaks[j]);
+
+            mismatches += (headroom < 1 || headroom * worst > INT32_MAX);
+        }
+    }
+
+    return host_test_report("headroom bound", mismatches, (long)count * count);
+}
+
+static int check_sums(void)
+{
+    // Headroom of 8 or more, 2 to 7, and 1
+    static const int peaks[4] = {200, 23000, 32768, 3000};
+    long mismatches = 0;
+
+    srand(34);
+    for (int t = 0; t < TRIALS; t++)
+    {
+        const int peak = peaks[t % 4];
+        const int n = rand() % MAX_LENGTH;
+
+        for (int i = 0; i < MAX_LENGTH + 2; i++)
+        {
+            a[i] = (t % 7 == 0 ? INT16_MIN : host_test_sample(peak));
+            b[i] = (t % 7 == 0 ? INT16_MIN : host_test_sample(peak));
+        }
+
+        const int offset_a = t & 1;
+        const int offset_b = (t >> 1) & 1;
+        const sample_t *x = a + offset_a;
+        const sample_t *y = b + offset_b;
+
+        const int headroom = dot_product_headroom(peak_of(x, n), peak_of(y, n));
+
+        power_t reference = 0;
+        for (int i = 0; i < n; i++)
+            reference += (int64_t)x[i] * y[i];
+
+        mismatches += (dot_product(x, y, n, headroom) != reference);
+        mismatches += (dot_product_c(x, y, n, headroom) != reference);
+    }
+
+    return host_test_report("dot_product and dot_product_c vs 64-bit sum", mismatches, 2L * TRIALS);
+}
+
+int main(void)
+{
+    printf("dot_product runs the %s kernels\n", DOT_PRODUCT_ASM ? "Thumb-1" : "C");
+
+    int failed = check_headroom();
+    failed |= check_sums();
+
+    return failed;
+}
@@ -0,0 +1,617 @@
+// The Thumb-1 kernels of dot_product_m0.S, run on the host by a model of
+// the Cortex-M0+ that executes the assembly source itself, macros and
+// .rept expanded. Each kernel against dot_product_c, with every word it
+// loads checked to be one that holds its inputs; the loop cost per eight
+// samples under the cycle model the source states; and dot_product built
+// for the RP2040, dispatching to the model, against a 64-bit sum at every
+// halfword alignment of both inputs
+
+#define DOT_PRODUCT_ASM 1
+#include <components/dot_product.c>
+
+#include <host_test.h>
+
+#include <ctype.h>
+#include <string.h>
+
+#define TRIALS 4000
+#define MAX_LENGTH 300
+
+#define MAX_LINES 4096
+#define MAX_LABELS 64
+#define MAX_MACROS 16
+#define MAX_MACRO_LINES 32
+#define TEXT 96
+
+// Model memory: SRAM from MEMORY_BASE, a at A_BASE and b at B_BASE plus
+// their offsets within a word, the stack at the top
+#define MEMORY_BASE 0x20000000u
+#define MEMORY_SIZE 0x10000u
+#define A_BASE (MEMORY_BASE + 0x1000u)
+#define B_BASE (MEMORY_BASE + 0x6000u)
+#define RETURN_ADDRESS 0xfffffffeu
+#define MAX_STEPS 1000000
+
+enum
+{
+    SP = 13,
+    LR = 14,
+    PC = 15
+};
+
+struct line_t
+{
+    char op[16];
+    char args[TEXT];
+};
+
+struct label_t
+{
+    char name[48];
+    int index;
+};
+
+struct macro_t
+{
+    char name[32];
+    char params[4][16];
+    int num_params;
+    char body[MAX_MACRO_LINES][TEXT];
+    int num_lines;
+};
+
+static struct line_t program[MAX_LINES];
+static int num_lines;
+static struct label_t labels[MAX_LABELS];
+static int num_labels;
+static struct macro_t macros[MAX_MACROS];
+static int num_macros;
+
+static uint8_t memory[MEMORY_SIZE];
+static uint32_t regs[16];
+static bool flag_n, flag_z, flag_c, flag_v;
+static long cycles;
+
+// Word range each input may be loaded from, and loads outside both
+static uint32_t allowed_lo[2], allowed_hi[2];
+static long stray_loads;
+static bool model_broken;
+
+static _Alignas(4) sample_t a[MAX_LENGTH + 4];
+static _Alignas(4) sample_t b[MAX_LENGTH + 4];
+
+// —————— Assembler ——————
+
+static char *trim(char *text)
+{
+    while (isspace((unsigned char)*text))
+        text++;
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    return text;
+}
+
+static void replace_all(char *text, const char *from, const char *to)
+{
+    char out[TEXT * 2] = "";
+    const char *p = text;
+    const char *hit;
+
+    while ((hit = strstr(p, from)))
+    {
+        strncat(out, p, (size_t)(hit - p));
+        strcat(out, to);
+        p = hit + strlen(from);
+    }
+    strcat(out, p);
+    snprintf(text, TEXT, "%s", out);
+}
+
+static void assemble_line(const char *source);
+
+static void expand_macro(const struct macro_t *macro, char *args)
+{
+    char values[4][16] = {{0}};
+    int count = 0;
+
+    for (char *token = strtok(args, ", \t"); token && count < 4; token = strtok(NULL, ", \t"))
+        snprintf(values[count++], sizeof(values[0]), "%s", token);
+
+    for (int i = 0; i < macro->num_lines; i++)
+    {
+        char text[TEXT];
+        snprintf(text, sizeof(text), "%s", macro->body[i]);
+        for (int p = 0; p < macro->num_params; p++)
+        {
+            char param[20];
+            snprintf(param, sizeof(param), "\\%s", macro->params[p]);
+            replace_all(text, param, values[p]);
+        }
+        assemble_line(text);
+    }
+}
+
+static void assemble_line(const char *source)
+{
+    char text[TEXT];
+    snprintf(text, sizeof(text), "%s", source);
+
+    char *comment = strstr(text, "//");
+    if (comment)
+        *comment = '\0';
+    char *line = trim(text);
+    if (!*line || *line == '.')
+        return;
+
+    const size_t length = strlen(line);
+    if (line[length - 1] == ':')
+    {
+        line[length - 1] = '\0';
+        snprintf(labels[num_labels].name, sizeof(labels[0].name), "%s", line);
+        labels[num_labels++].index = num_lines;
+        return;
+    }
+
+    char op[16];
+    int used = 0;
+    sscanf(line, "%15s%n", op, &used);
+
+    for (int m = 0; m < num_macros; m++)
+    {
+        if (strcmp(op, macros[m].name) == 0)
+        {
+            char args[TEXT];
+            snprintf(args, sizeof(args), "%s", line + used);
+            expand_macro(&macros[m], args);
+            return;
+        }
+    }
+
+    snprintf(program[num_lines].op, sizeof(program[0].op), "%s", op);
+    snprintf(program[num_lines].args, sizeof(program[0].args), "%s", trim(line + used));
+    num_lines++;
+}
+
+// Expands .macro and .rept blocks; everything else line by line
+static bool assemble(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        printf("cannot open %s\n", path);
+        return false;
+    }
+
+    static char rept[MAX_MACRO_LINES][TEXT];
+    int rept_count = 0, rept_lines = 0;
+    struct macro_t *macro = NULL;
+    char buffer[256];
+
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        char copy[256];
+        snprintf(copy, sizeof(copy), "%s", buffer);
+        char *line = trim(copy);
+
+        if (strncmp(line, ".macro", 6) == 0)
+        {
+            macro = &macros[num_macros++];
+            char *token = strtok(line + 6, ", \t");
+            snprintf(macro->name, sizeof(macro->name), "%s", token);
+            while ((token = strtok(NULL, ", \t")))
+                snprintf(macro->params[macro->num_params++], sizeof(macro->params[0]), "%s", token);
+        }
+        else if (strncmp(line, ".endm", 5) == 0)
+            macro = NULL;
+        else if (macro)
+            snprintf(macro->body[macro->num_lines++], TEXT, "%s", line);
+        else if (strncmp(line, ".rept", 5) == 0)
+        {
+            rept_count = atoi(line + 5);
+            rept_lines = 0;
+        }
+        else if (strncmp(line, ".endr", 5) == 0)
+        {
+            for (int r = 0; r < rept_count; r++)
+                for (int i = 0; i < rept_lines; i++)
+                    assemble_line(rept[i]);
+            rept_count = 0;
+        }
+        else if (rept_count)
+            snprintf(rept[rept_lines++], TEXT, "%s", line);
+        else
+            assemble_line(line);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Named label, or a numeric one as 1b / 1f from the line at index
+static int find_label(const char *name, int index)
+{
+    const size_t length = strlen(name);
+    if (length >= 2 && isdigit((unsigned char)name[0]) && (name[length - 1] == 'b' || name[length - 1] == 'f'))
+    {
+        const bool back = (name[length - 1] == 'b');
+        int found = -1;
+        for (int i = 0; i < num_labels; i++)
+        {
+            if (strncmp(labels[i].name, name, length - 1) != 0 || labels[i].name[length - 1] != '\0')
+                continue;
+            if (back && labels[i].index <= index && (found < 0 || labels[i].index > found))
+                found = labels[i].index;
+            if (!back && labels[i].index > index && (found < 0 || labels[i].index < found))
+                found = labels[i].index;
+        }
+        return found;
+    }
+
+    for (int i = 0; i < num_labels; i++)
+        if (strcmp(labels[i].name, name) == 0)
+            return labels[i].index;
+    return -1;
+}
+
+// —————— Core ——————
+
+static int reg_index(const char *name)
+{
+    if (strcmp(name, "sp") == 0)
+        return SP;
+    if (strcmp(name, "lr") == 0)
+        return LR;
+    if (strcmp(name, "pc") == 0)
+        return PC;
+    if (name[0] == 'r' && isdigit((unsigned char)name[1]))
+        return atoi(name + 1);
+
+    model_broken = true;
+    return 0;
+}
+
+// Comma-separated operands, keeping {...} lists whole
+static int split_args(const char *args, char out[4][TEXT])
+{
+    int count = 0, depth = 0, length = 0;
+
+    for (const char *p = args;; p++)
+    {
+        if (*p == '{')
+            depth++;
+        if (*p == '}')
+            depth--;
+        if ((*p == ',' && depth == 0) || *p == '\0')
+        {
+            out[count][length] = '\0';
+            const char *text = trim(out[count]);
+            memmove(out[count], text, strlen(text) + 1);
+            count++;
+            length = 0;
+            if (*p == '\0' || count == 4)
+                break;
+            continue;
+        }
+        out[count][length++] = *p;
+    }
+
+    return count;
+}
+
+// Register list {r4-r7, lr} as a bit mask
+static uint32_t reg_list(const char *text)
+{
+    char copy[TEXT];
+    snprintf(copy, sizeof(copy), "%s", text);
+    uint32_t mask = 0;
+
+    for (char *token = strtok(copy, "{}, \t"); token; token = strtok(NULL, "{}, \t"))
+    {
+        char *dash = strchr(token, '-');
+        if (dash)
+        {
+            *dash = '\0';
+            for (int r = reg_index(token); r <= reg_index(dash + 1); r++)
+                mask |= 1u << r;
+        }
+        else
+            mask |= 1u << reg_index(token);
+    }
+
+    return mask;
+}
+
+static uint32_t operand(const char *text)
+{
+    return (text[0] == '#' ? (uint32_t)strtol(text + 1, NULL, 0) : regs[reg_index(text)]);
+}
+
+static uint32_t load(uint32_t address)
+{
+    if ((address & 3) || address < MEMORY_BASE || address - MEMORY_BASE > MEMORY_SIZE - 4)
+    {
+        model_broken = true;
+        return 0;
+    }
+
+    const bool input = (address >= allowed_lo[0] && address < allowed_hi[0]) ||
+                       (address >= allowed_lo[1] && address < allowed_hi[1]);
+    stray_loads += (!input && address < MEMORY_BASE + MEMORY_SIZE - 0x400);
+
+    const uint8_t *p = &memory[address - MEMORY_BASE];
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store(uint32_t address, uint32_t value)
+{
+    if ((address & 3) || address < MEMORY_BASE || address - MEMORY_BASE > MEMORY_SIZE - 4)
+    {
+        model_broken = true;
+        return;
+    }
+
+    uint8_t *p = &memory[address - MEMORY_BASE];
+    p[0] = (uint8_t)value, p[1] = (uint8_t)(value >> 8), p[2] = (uint8_t)(value >> 16), p[3] = (uint8_t)(value >> 24);
+}
+
+static void set_nz(uint32_t value)
+{
+    flag_n = (value >> 31) != 0;
+    flag_z = (value == 0);
+}
+
+static uint32_t add_with_carry(uint32_t x, uint32_t y, bool carry)
+{
+    const uint64_t sum = (uint64_t)x + y + carry;
+    const uint32_t result = (uint32_t)sum;
+    flag_c = (sum >> 32) != 0;
+    flag_v = ((~(x ^ y) & (x ^ result)) >> 31) != 0;
+    set_nz(result);
+    return result;
+}
+
+// Executes from the label until the function returns to RETURN_ADDRESS.
+// Cycles as the source's model: ldm, push and pop 1 + N, a taken branch
+// 2, everything else 1
+static void run(const char *function)
+{
+    int pc = find_label(function, 0);
+    regs[LR] = RETURN_ADDRESS;
+    regs[SP] = MEMORY_BASE + MEMORY_SIZE;
+    cycles = 0;
+
+    for (long step = 0; pc >= 0 && step < MAX_STEPS && !model_broken; step++)
+    {
+        const struct line_t *line = &program[pc++];
+        char args[4][TEXT];
+        const int count = split_args(line->args, args);
+        const char *op = line->op;
+        cycles++;
+
+        if (strcmp(op, "push") == 0)
+        {
+            const uint32_t mask = reg_list(args[0]);
+            for (int r = 15; r >= 0; r--)
+                if (mask & (1u << r))
+                {
+                    regs[SP] -= 4;
+                    store(regs[SP], regs[r]);
+                    cycles++;
+                }
+        }
+        else if (strcmp(op, "pop") == 0)
+        {
+            const uint32_t mask = reg_list(args[0]);
+            for (int r = 0; r < 16; r++)
+                if (mask & (1u << r))
+                {
+                    regs[r] = load(regs[SP]);
+                    regs[SP] += 4;
+                    cycles++;
+                }
+            if (mask & (1u << PC))
+                pc = (regs[PC] == RETURN_ADDRESS ? -1 : (model_broken = true, -1));
+        }
+        else if (strcmp(op, "ldm") == 0)
+        {
+            const int base = reg_index(strtok(args[0], "!"));
+            const uint32_t mask = reg_list(args[1]);
+            for (int r = 0; r < 16; r++)
+                if (mask & (1u << r))
+                {
+                    regs[r] = load(regs[base]);
+                    regs[base] += 4;
+                    cycles++;
+                }
+        }
+        else if (strcmp(op, "mov") == 0)
+            regs[reg_index(args[0])] = operand(args[1]);
+        else if (strcmp(op, "movs") == 0)
+            set_nz(regs[reg_index(args[0])] = operand(args[1]));
+        else if (strcmp(op, "add") == 0 && count == 2)
+            regs[reg_index(args[0])] += operand(args[1]);
+        else if (strcmp(op, "adds") == 0 && count == 3)
+            regs[reg_index(args[0])] = add_with_carry(operand(args[1]), operand(args[2]), false);
+        else if (strcmp(op, "adcs") == 0 && count == 3)
+            regs[reg_index(args[0])] = add_with_carry(operand(args[1]), operand(args[2]), flag_c);
+        else if (strcmp(op, "subs") == 0 && count == 3)
+            regs[reg_index(args[0])] = add_with_carry(operand(args[1]), ~operand(args[2]), true);
+        else if (strcmp(op, "cmp") == 0)
+            add_with_carry(operand(args[0]), ~operand(args[1]), true);
+        else if (strcmp(op, "lsls") == 0)
+            set_nz(regs[reg_index(args[0])] = operand(args[1]) << operand(args[2]));
+        else if (strcmp(op, "asrs") == 0)
+            set_nz(regs[reg_index(args[0])] = (uint32_t)((int32_t)operand(args[1]) >> operand(args[2])));
+        else if (strcmp(op, "sxth") == 0)
+            regs[reg_index(args[0])] = (uint32_t)(int32_t)(int16_t)operand(args[1]);
+        else if (strcmp(op, "muls") == 0 && count == 2)
+            set_nz(regs[reg_index(args[0])] *= operand(args[1]));
+        else if (strcmp(op, "bne") == 0)
+        {
+            if (!flag_z)
+            {
+                pc = find_label(args[0], pc - 1);
+                cycles++;
+            }
+        }
+        else if (strcmp(op, "bx") == 0)
+            pc = (operand(args[0]) == RETURN_ADDRESS ? -1 : (model_broken = true, -1));
+        else
+        {
+            printf("model has no %s\n", op);
+            model_broken = true;
+        }
+    }
+}
+
+// Copies n samples at x into the model at base plus x's offset in its
+// word, with the rest of their words; returns the model address
+static uint32_t place(int input, uint32_t base, const sample_t *x, int n)
+{
+    const uintptr_t first = (uintptr_t)x & ~(uintptr_t)3;
+    const uintptr_t last = ((uintptr_t)(x + n) + 3) & ~(uintptr_t)3;
+
+    memcpy(&memory[base - MEMORY_BASE], (const void *)first, last - first);
+    allowed_lo[input] = base;
+    allowed_hi[input] = base + (uint32_t)(last - first);
+    return base + (uint32_t)((uintptr_t)x - first);
+}
+
+static power_t call(const char *function, const sample_t *x, const sample_t *y, int n)
+{
+    // Anything the kernels read beyond their inputs shows up as garbage
+    memset(memory, 0xa5, sizeof(memory));
+    memset(regs, 0, sizeof(regs));
+
+    regs[0] = place(0, A_BASE, x, n);
+    regs[1] = place(1, B_BASE, y, n);
+    regs[2] = (uint32_t)n;
+    run(function);
+
+    return (power_t)(((uint64_t)regs[1] << 32) | regs[0]);
+}
+
+// The kernels dot_product.c declares, here run in the model
+power_t dot_product_m0_aligned8(const sample_t *x, const sample_t *y, int n)
+{
+    return call("dot_product_m0_aligned8", x, y, n);
+}
+
+power_t dot_product_m0_aligned2(const sample_t *x, const sample_t *y, int n)
+{
+    return call("dot_product_m0_aligned2", x, y, n);
+}
+
+power_t dot_product_m0_mixed8(const sample_t *x, const sample_t *y, int n)
+{
+    return call("dot_product_m0_mixed8", x, y, n);
+}
+
+// —————— Checks ——————
+
+struct kernel_t
+{
+    const char *name;
+    power_t (*entry)(const sample_t *, const sample_t *, int);
+    int offset_b;
+    int headroom;
+    int loop_cycles;
+};
+
+// Loop costs as stated at the top of dot_product_m0.S
+static const struct kernel_t kernels[3] = {
+    {"aligned8", dot_product_m0_aligned8, 0, 8, 57},
+    {"mixed8", dot_product_m0_mixed8, 1, 8, 61},
+    {"aligned2", dot_product_m0_aligned2, 0, 2, 59},
+};
+
+static void fill(int peak)
+{
+    for (int i = 0; i < MAX_LENGTH + 4; i++)
+    {
+        a[i] = host_test_sample(peak);
+        b[i] = host_test_sample(peak);
+    }
+}
+
+static int check_kernels(void)
+{
+    // Largest peaks whose products still fit the kernel's headroom
+    static const int peaks[2] = {16383, 32767};
+    int failed = 0;
+
+    printf("kernel   | mismatches | stray loads | cycles per 8 samples | stated\n");
+    for (int k = 0; k < 3; k++)
+    {
+        const struct kernel_t *kernel = &kernels[k];
+        long mismatches = 0;
+
+        stray_loads = 0;
+        for (int t = 0; t < TRIALS / 4; t++)
+        {
+            const int peak = (t & 1 ? peaks[kernel->headroom == 2] : 1000);
+            const int n = 8 * (1 + rand() % (MAX_LENGTH / 8 - 1));
+            fill(peak);
+
+            // a from a word boundary; b there too or a halfword past it
+            const sample_t *x = a + 2;
+            const sample_t *y = b + 2 + kernel->offset_b;
+            mismatches += (kernel->entry(x, y, n) != dot_product_c(x, y, n, kernel->headroom));
+        }
+
+        kernel->entry(a + 2, b + 2 + kernel->offset_b, 8);
+        const long one = cycles;
+        kernel->entry(a + 2, b + 2 + kernel->offset_b, 16);
+        const long per_loop = cycles - one;
+
+        printf("%-8s | %10ld | %11ld | %20ld | %6d\n", kernel->name, mismatches, stray_loads, per_loop,
+               kernel->loop_cycles);
+        failed += (mismatches != 0 || stray_loads != 0 || per_loop != kernel->loop_cycles);
+    }
+
+    return host_test_report("kernels vs dot_product_c, loads and cycles", failed + model_broken, 3);
+}
+
+static int check_dispatch(void)
+{
+    // Headroom of 8 or more, 2 to 7, and 1
+    static const int peaks[4] = {200, 23000, 32768, 3000};
+    long mismatches = 0;
+
+    stray_loads = 0;
+    for (int t = 0; t < TRIALS; t++)
+    {
+        const int n = rand() % MAX_LENGTH;
+        fill(peaks[t % 4]);
+
+        const sample_t *x = a + 2 + (t & 1);
+        const sample_t *y = b + 2 + ((t >> 1) & 1);
+        int32_t peak_x = 0, peak_y = 0;
+        power_t reference = 0;
+        for (int i = 0; i < n; i++)
+        {
+            peak_x = (abs(x[i]) > peak_x ? abs(x[i]) : peak_x);
+            peak_y = (abs(y[i]) > peak_y ? abs(y[i]) : peak_y);
+            reference += (int64_t)x[i] * y[i];
+        }
+
+        mismatches += (dot_product(x, y, n, dot_product_headroom(peak_x, peak_y)) != reference);
+    }
+
+    return host_test_report("dot_product on the kernels vs 64-bit sum", mismatches + stray_loads + model_broken,
+                            TRIALS);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || !assemble(argv[1]))
+        return 1;
+    printf("%d instructions, %d labels from %s\n", num_lines, num_labels, argv[1]);
+
+    srand(34);
+    int failed = check_kernels();
+    failed |= check_dispatch();
+
+    return failed;
+}
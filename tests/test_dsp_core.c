@@ -0,0 +1,132 @@
+// The specialised kernels of dsp_core against the C paths they replace:
+// dsp_core_window against buffer_window, and dsp_core_init_pairs and
+// dsp_core_init_pair against correlations_init_pairs, at peaks that give
+// each blocking. Then the time per frame of both on full-scale ADC
+// samples, raw bytes shifted up by 8, whose headroom is only 1 or 2
+
+#include <host_test.h>
+
+#include <string.h>
+
+#include <components/dot_product.h>
+#include <components/dsp_core.h>
+
+#define FRAMES 3000
+#define BENCH_REPETITIONS 500
+
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+static const int pair_a[3] = {0, 0, 1};
+static const int pair_b[3] = {1, 2, 2};
+
+static struct buffer_t frames[3];
+static struct buffer_t windowed[3];
+static struct correlations_t reference[3];
+static struct correlations_t kernels[3];
+
+static void set_ranges(void)
+{
+    for (int p = 0; p < 3; p++)
+    {
+        correlations_set_range(&reference[p], max_shifts[p]);
+        correlations_set_range(&kernels[p], max_shifts[p]);
+    }
+}
+
+static long compare_pairs(void)
+{
+    long mismatches = 0;
+
+    for (int p = 0; p < 3; p++)
+    {
+        mismatches += (memcmp(reference[p].correlations, kernels[p].correlations, sizeof(reference[p].correlations)) != 0 ||
+                       reference[p].best_shift != kernels[p].best_shift ||
+                       reference[p].best_shift_q8 != kernels[p].best_shift_q8);
+    }
+
+    return mismatches;
+}
+
+static int check_kernels(void)
+{
+    // Headroom 1, 2 to 7, and 8 or more
+    static const int peaks[3] = {32768, 23000, 2000};
+
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const reference_corrs[3] = {&reference[0], &reference[1], &reference[2]};
+    struct correlations_t *const kernel_corrs[3] = {&kernels[0], &kernels[1], &kernels[2]};
+    long window_mismatches = 0;
+    long pairs_mismatches = 0;
+    long pair_mismatches = 0;
+
+    srand(46);
+    for (int t = 0; t < FRAMES; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + rand() % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+
+        for (int c = 0; c < 3; c++)
+        {
+            host_test_frame(&frames[c], size_bits, 0, 1 << size_bits, peaks[t % 3]);
+            windowed[c] = frames[c];
+
+            buffer_window(&windowed[c]);
+            dsp_core_window(&frames[c]);
+            window_mismatches += (memcmp(windowed[c].buffer, frames[c].buffer, frames[c].size * sizeof(sample_t)) != 0);
+        }
+
+        set_ranges();
+        correlations_init_pairs(reference_corrs, bufs);
+        pairs_mismatches += !dsp_core_init_pairs(kernel_corrs, bufs) + compare_pairs();
+
+        set_ranges();
+        correlations_init_pairs(reference_corrs, bufs);
+        for (int p = 0; p < 3; p++)
+            pair_mismatches += !dsp_core_init_pair(&kernels[p], &frames[pair_a[p]], &frames[pair_b[p]]);
+        pair_mismatches += compare_pairs();
+    }
+
+    int failed = host_test_report("dsp_core_window vs buffer_window", window_mismatches, 3L * FRAMES);
+    failed |= host_test_report("dsp_core_init_pairs vs C", pairs_mismatches, 3L * FRAMES);
+    failed |= host_test_report("dsp_core_init_pair vs C", pair_mismatches, 3L * FRAMES);
+    return failed;
+}
+
+static void bench(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const reference_corrs[3] = {&reference[0], &reference[1], &reference[2]};
+    struct correlations_t *const kernel_corrs[3] = {&kernels[0], &kernels[1], &kernels[2]};
+
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            host_test_frame(&frames[c], size_bits, 0, 1 << size_bits, 0);
+            for (int i = 0; i < frames[c].size; i++)
+                frames[c].buffer[i] = (sample_t)((rand() % 256 - 128) * 256);
+        }
+        set_ranges();
+
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlations_init_pairs(reference_corrs, bufs);
+        const double c_us = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            dsp_core_init_pairs(kernel_corrs, bufs);
+
+        printf("n = %4d, headroom %d: C %7.1f us, kernels %7.1f us\n", 1 << size_bits,
+               dot_product_headroom(buffer_peak(&frames[0]), buffer_peak(&frames[1])), c_us,
+               host_test_us(start, BENCH_REPETITIONS));
+    }
+}
+
+int main(void)
+{
+    correlations_tables_init();
+
+    const int failed = check_kernels();
+    bench();
+
+    return failed;
+}
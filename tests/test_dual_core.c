@@ -0,0 +1,179 @@
+// The pieces the dual-core correlation stands on: dual_core_start and
+// dual_core_join handing tasks to the core 1 stand-in and back, with the
+// task's writes seen after the join; parallel_split_lags against the
+// most even split a search over every lag finds, on frames with their
+// own spans; and what both cores save per frame over one, on the host
+
+#include <host_test.h>
+
+#include <components/dual_core.h>
+#include <components/parallel_correlations.h>
+
+#define TASKS 20000
+#define TRIALS 2000
+#define BENCH_REPETITIONS 300
+
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+static struct buffer_t frames[3];
+static struct correlations_t corrs[3];
+static struct spectra_t spectra;
+
+struct counter_t
+{
+    int runs;
+    long sum;
+};
+
+static void count(void *arg)
+{
+    struct counter_t *counter = arg;
+    counter->runs++;
+    counter->sum += counter->runs;
+}
+
+static int check_tasks(void)
+{
+    static struct counter_t counters[2];
+    long mismatches = 0;
+
+    for (int t = 0; t < TASKS; t++)
+    {
+        struct counter_t *counter = &counters[t & 1];
+        const int runs = counter->runs;
+        const struct dual_core_task_t task = {count, counter};
+
+        dual_core_start(&task);
+        dual_core_join();
+        mismatches += (counter->runs != runs + 1 || counter->sum != (long)(runs + 1) * (runs + 2) / 2);
+    }
+
+    return host_test_report("tasks run once each, results seen after the join", mismatches, TASKS);
+}
+
+// Products on lags first..last
+static long products(int first, int last)
+{
+    long total = 0;
+    for (int s = first; s <= last; s++)
+        total += correlations_overlap(&frames[0], &frames[1], s);
+    return total;
+}
+
+static int check_split(void)
+{
+    long mismatches = 0;
+
+    srand(35);
+    for (int t = 0; t < TRIALS; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + t % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+        const int size = 1 << size_bits;
+        const int max_shift = max_shifts[t % 3];
+
+        // Whole frames, or a span such as the onset gate leaves on all
+        const int start = (t & 1 ? rand() % (size / 2) : 0);
+        const int end = (t & 1 ? start + 1 + rand() % (size - start) : size);
+        for (int c = 0; c < 2; c++)
+            host_test_frame(&frames[c], size_bits, start, end, 0);
+
+        const int split = parallel_split_lags(&frames[0], &frames[1], max_shift);
+
+        // The most even split of the products, by trying every one
+        long best = -1;
+        for (int s = -max_shift + 1; s <= max_shift; s++)
+        {
+            const long difference = labs(products(-max_shift, s - 1) - products(s, max_shift));
+            best = (best < 0 || difference < best ? difference : best);
+        }
+
+        // One lag's products of slack
+        long widest = 0;
+        for (int s = -max_shift; s <= max_shift; s++)
+            widest = (correlations_overlap(&frames[0], &frames[1], s) > widest ?
+                          correlations_overlap(&frames[0], &frames[1], s) : widest);
+
+        const long difference = labs(products(-max_shift, split - 1) - products(split, max_shift));
+        mismatches += (split <= -max_shift || split > max_shift || difference > best + widest);
+    }
+
+    return host_test_report("lag split within a lag of the most even", mismatches, TRIALS);
+}
+
+static void correlate_single(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+
+    if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT && spectra_compute(&spectra, bufs, 3))
+    {
+        spectra_correlate(&spectra, 0, 1, &corrs[0]);
+        spectra_correlate(&spectra, 0, 2, &corrs[1]);
+        spectra_correlate(&spectra, 1, 2, &corrs[2]);
+    }
+    else if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+    {
+        fft_correlations_init(&corrs[0], &frames[0], &frames[1]);
+        fft_correlations_init(&corrs[1], &frames[0], &frames[2]);
+        fft_correlations_init(&corrs[2], &frames[1], &frames[2]);
+    }
+    else
+    {
+        correlations_init(&corrs[0], &frames[0], &frames[1]);
+        correlations_init(&corrs[1], &frames[0], &frames[2]);
+        correlations_init(&corrs[2], &frames[1], &frames[2]);
+    }
+}
+
+// Wall-clock time since begin, in us per repetition; clock() would add
+// up both threads
+static double wall_us(const struct timespec *begin, int repetitions)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((now.tv_sec - begin->tv_sec) * 1e6 + (now.tv_nsec - begin->tv_nsec) / 1e3) / repetitions;
+}
+
+// A thread stands in for core 1 here, so the hand-off costs more than
+// the multicore FIFO does on the RP2040
+static void bench(void)
+{
+    printf("\n%s engine, us per frame of three mics on the host\n",
+           CORRELATION_ENGINE == CORRELATION_ENGINE_FFT ? "FFT" : "direct");
+    printf("   n | one core | both cores\n");
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            host_test_frame(&frames[c], size_bits, 0, 1 << size_bits, 8000);
+            buffer_window(&frames[c]);
+        }
+
+        struct timespec begin;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlate_single();
+        const double single_us = wall_us(&begin, BENCH_REPETITIONS);
+
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            parallel_correlations(&spectra, &frames[0], &frames[1], &frames[2], &corrs[0], &corrs[1], &corrs[2]);
+        const double dual_us = wall_us(&begin, BENCH_REPETITIONS);
+
+        printf("%4d | %8.1f | %10.1f\n", 1 << size_bits, single_us, dual_us);
+    }
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    fft_init();
+    dual_core_init();
+    for (int p = 0; p < 3; p++)
+        correlations_set_range(&corrs[p], max_shifts[p]);
+
+    int failed = check_tasks();
+    failed |= check_split();
+    bench();
+
+    return failed;
+}
@@ -0,0 +1,256 @@
+// The fixed-point FFT against a DFT in double: complex and real
+// transforms at every size, as the SNR of the output over its error, and
+// the real inverse after the forward. Then the FFT engine against the
+// direct engine on delayed noise: the same best shift, and how far the
+// whole correlation strays from the direct one. Then what each costs
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft.h>
+#include <components/fft_correlation.h>
+
+#define TRIALS 8
+#define FRAMES 300
+#define BENCH_REPETITIONS 200
+
+// Worst SNR of any transform allowed, and worst error of a correlation
+// allowed against the direct one, relative to its peak
+#define MIN_SNR_DB 60.0
+#define MAX_CORRELATION_ERROR 0.01
+
+static complex_q15_t data[FFT_MAX_SIZE];
+static double reference[2 * FFT_MAX_SIZE];
+static double cosines[FFT_MAX_SIZE];
+static double sines[FFT_MAX_SIZE];
+static struct buffer_t frames[2];
+static struct correlations_t direct;
+static struct correlations_t fft;
+static double source[BUFFER_MAX_SIZE + 2 * MAX_SHIFT_SAMPLES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Gaussian data at rms, so some of it reaches full scale
+static void random_data(int count, double rms)
+{
+    for (int i = 0; i < count; i++)
+    {
+        data[i].re = clip(rms * gaussian());
+        data[i].im = clip(rms * gaussian());
+    }
+}
+
+// DFT of count complex values of data into reference, re and im interleaved
+static void dft(int count, int sign)
+{
+    for (int m = 0; m < count; m++)
+    {
+        cosines[m] = cos(2.0 * M_PI * m / count);
+        sines[m] = sign * sin(2.0 * M_PI * m / count);
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        double re = 0.0, im = 0.0;
+        for (int n = 0; n < count; n++)
+        {
+            const int m = (int)((long)k * n % count);
+            re += data[n].re * cosines[m] - data[n].im * sines[m];
+            im += data[n].re * sines[m] + data[n].im * cosines[m];
+        }
+        reference[2 * k] = re;
+        reference[2 * k + 1] = im;
+    }
+}
+
+// Output scaled by 2^exponent over its error from reference[0..2 count)
+static double snr_db(const complex_q15_t *out, int count, int exponent)
+{
+    double signal = 0.0, error = 0.0;
+
+    for (int k = 0; k < count; k++)
+    {
+        const double re = ldexp(out[k].re, exponent) - reference[2 * k];
+        const double im = ldexp(out[k].im, exponent) - reference[2 * k + 1];
+        signal += reference[2 * k] * reference[2 * k] + reference[2 * k + 1] * reference[2 * k + 1];
+        error += re * re + im * im;
+    }
+
+    return 10.0 * log10(signal / fmax(error, 1e-30));
+}
+
+static int check_transforms(void)
+{
+    static complex_q15_t out[FFT_MAX_SIZE];
+    static const double levels[2] = {300.0, 8000.0};
+    int failed = 0;
+
+    printf("worst SNR in dB over %d transforms\n", TRIALS);
+    printf("  n | complex quiet | complex loud | real quiet | real loud | real round trip\n");
+    for (int size_bits = 4; size_bits <= FFT_MAX_SIZE_BITS; size_bits++)
+    {
+        const int n = 1 << size_bits;
+        double worst[5] = {1e9, 1e9, 1e9, 1e9, 1e9};
+
+        for (int t = 0; t < TRIALS; t++)
+        {
+            for (int l = 0; l < 2; l++)
+            {
+                // Complex n points, forward and inverse alternately
+                random_data(n, levels[l]);
+                const int sign = (t & 1 ? 1 : -1);
+                dft(n, sign);
+                for (int i = 0; i < n; i++)
+                    out[i] = data[i];
+                worst[l] = fmin(worst[l], snr_db(out, n, fft_complex(out, size_bits, sign > 0)));
+
+                // Real n samples: bins 0..n/2 of their DFT, with X[N/2]
+                // packed into the imaginary part of bin 0
+                random_data(n / 2, levels[l]);
+                for (int i = 0; i < n / 2; i++)
+                    out[i] = data[i];
+                for (int i = n - 1; i >= 0; i--)
+                {
+                    data[i].re = (i & 1 ? data[i / 2].im : data[i / 2].re);
+                    data[i].im = 0;
+                }
+                dft(n, -1);
+                reference[1] = reference[n];
+                const int exponent = fft_real_forward(out, size_bits);
+                worst[2 + l] = fmin(worst[2 + l], snr_db(out, n / 2, exponent));
+
+                // Inverse of the real transform: n / 2 times the samples
+                const int back = exponent + fft_real_inverse(out, size_bits);
+                for (int i = 0; i < n / 2; i++)
+                {
+                    reference[2 * i] = data[2 * i].re * (n / 2.0);
+                    reference[2 * i + 1] = data[2 * i + 1].re * (n / 2.0);
+                }
+                if (l == 1)
+                    worst[4] = fmin(worst[4], snr_db(out, n / 2, back));
+            }
+        }
+
+        printf("%3d | %13.1f | %12.1f | %10.1f | %9.1f | %15.1f\n", n, worst[0], worst[1], worst[2], worst[3],
+               worst[4]);
+        for (int k = 0; k < 5; k++)
+            failed += (worst[k] < MIN_SNR_DB);
+    }
+
+    return host_test_report("transforms vs double DFT", failed, 5 * (FFT_MAX_SIZE_BITS - 3));
+}
+
+static int check_engines(void)
+{
+    const int range = MAX_SHIFT_AC_SAMPLES;
+    long mismatches = 0;
+    double worst = 0.0;
+
+    for (int t = 0; t < FRAMES; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + t % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+        const int size = 1 << size_bits;
+        const int delay = rand() % (2 * range - 1) - range + 1;
+        const double level = (t % 3 == 0 ? 500.0 : 6000.0);
+
+        for (int i = 0; i < size + 2 * MAX_SHIFT_SAMPLES; i++)
+            source[i] = gaussian();
+
+        for (int c = 0; c < 2; c++)
+        {
+            host_test_frame(&frames[c], size_bits, 0, size, 0);
+            for (int i = 0; i < size; i++)
+            {
+                const double heard = source[i + MAX_SHIFT_SAMPLES - (c ? delay : 0)];
+                frames[c].buffer[i] = clip(level * (heard + 0.5 * gaussian()));
+            }
+            buffer_window(&frames[c]);
+        }
+
+        correlations_init(&direct, &frames[0], &frames[1]);
+        fft_correlations_init(&fft, &frames[0], &frames[1]);
+
+        double peak = 1.0, error = 0.0;
+        for (int s = -range; s <= range; s++)
+            peak = fmax(peak, fabs((double)direct.correlations[s + MAX_SHIFT_SAMPLES]));
+        for (int s = -range; s <= range; s++)
+            error = fmax(error, fabs((double)(fft.correlations[s + MAX_SHIFT_SAMPLES] -
+                                              direct.correlations[s + MAX_SHIFT_SAMPLES])) / peak);
+
+        worst = fmax(worst, error);
+        mismatches += (fft.best_shift != direct.best_shift || error > MAX_CORRELATION_ERROR);
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "FFT engine vs direct, worst error %.4f of the peak", worst);
+    return host_test_report(what, mismatches, FRAMES);
+}
+
+static void bench(void)
+{
+    printf("\nus on the host\n");
+    printf("   n | complex | real forward | real inverse | direct pair | FFT pair\n");
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        const int n = 1 << size_bits;
+        double us[5];
+
+        random_data(n, 4000.0);
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            fft_complex(data, size_bits, r & 1);
+        us[0] = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            fft_real_forward(data, size_bits);
+        us[1] = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            fft_real_inverse(data, size_bits);
+        us[2] = host_test_us(start, BENCH_REPETITIONS);
+
+        for (int c = 0; c < 2; c++)
+            host_test_frame(&frames[c], size_bits, 0, n, 8000);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlations_init(&direct, &frames[0], &frames[1]);
+        us[3] = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            fft_correlations_init(&fft, &frames[0], &frames[1]);
+        us[4] = host_test_us(start, BENCH_REPETITIONS);
+
+        printf("%4d | %7.1f | %12.1f | %12.1f | %11.1f | %8.1f\n", n, us[0], us[1], us[2], us[3], us[4]);
+    }
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    correlations_set_range(&direct, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&fft, MAX_SHIFT_AC_SAMPLES);
+
+    srand(31);
+    int failed = check_transforms();
+    failed |= check_engines();
+    bench();
+
+    return failed;
+}
@@ -0,0 +1,174 @@
+// Frames of every length from the rolling buffers, which keep raw ADC
+// bytes: rolling_buffer_write_out against the last samples pushed minus
+// their mean, and the trigger's half-window powers against a
+// recomputation, after pushes that do and do not fill the ring. Then
+// what each stage of a frame costs at every length, for three mics
+
+#include <host_test.h>
+
+#include <components/rolling_buffer.h>
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+
+#define TRIALS 400
+#define BENCH_REPETITIONS 200
+
+static struct rolling_buffer_t ring;
+static struct buffer_t frames[3];
+static struct correlations_t corrs[3];
+static struct spectra_t spectra;
+static raw_sample_t history[4 * BUFFER_MAX_SIZE];
+
+// (N / 2) * sum x^2 - (sum x)^2 over history[first, first + N / 2)
+static power_t half_power(int first, int size)
+{
+    power_t total = 0;
+    power_t power = 0;
+
+    for (int i = first; i < first + size / 2; i++)
+    {
+        const int64_t sample = (i >= 0 ? history[i] : 0);
+        total += sample;
+        power += sample * sample;
+    }
+
+    return power * (size / 2) - total * total;
+}
+
+static int check_rolling_buffer(void)
+{
+    long mismatches = 0;
+
+    srand(28);
+    for (int t = 0; t < TRIALS; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + t % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+        const int size = 1 << size_bits;
+
+        // Short of, just at and well past a full ring
+        const int count = (t % 3 == 0 ? rand() % size : t % 3 == 1 ? size : size + rand() % (3 * size));
+        const int mid = rand() % 256;
+        const int swing = 1 + rand() % 128;
+
+        rolling_buffer_init(&ring, size_bits);
+        for (int i = 0; i < count; i++)
+        {
+            int sample = mid + rand() % (2 * swing + 1) - swing;
+            sample = (sample < 0 ? 0 : sample > 255 ? 255 : sample);
+            history[i] = (raw_sample_t)sample;
+            rolling_buffer_push(&ring, history[i]);
+        }
+
+        rolling_buffer_write_out(&ring, &frames[0]);
+
+        // The last size samples, oldest first, zero before the first push
+        power_t total = 0;
+        for (int i = 0; i < size; i++)
+        {
+            const int k = count - size + i;
+            total += (k >= 0 ? history[k] : 0);
+        }
+
+        const sample_t offset = (sample_t)(total >> size_bits);
+        power_t power = 0;
+        int sample_mismatches = 0;
+        for (int i = 0; i < size; i++)
+        {
+            const int k = count - size + i;
+            const sample_t expected = (sample_t)((k >= 0 ? history[k] : 0) - offset);
+            sample_mismatches += (frames[0].buffer[i] != expected);
+            power += (power_t)expected * expected;
+        }
+
+        mismatches += (sample_mismatches != 0 || frames[0].size != size || frames[0].size_bits != size_bits ||
+                       frames[0].start != 0 || frames[0].end != size || frames[0].power != power);
+
+        mismatches += (rolling_buffer_get_incoming_power(&ring) != half_power(count - size / 2, size));
+        mismatches += (rolling_buffer_get_outgoing_power(&ring) != half_power(count - size, size));
+        mismatches += (ring.is_full != (count >= size));
+    }
+
+    printf("ring of %d raw bytes per mic, %d with int16 samples\n", (int)sizeof(ring.buffer),
+           (int)(BUFFER_MAX_SIZE * sizeof(sample_t)));
+    return host_test_report("rolling buffer vs recomputation", mismatches, TRIALS);
+}
+
+static void bench(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    struct correlations_t *const pair_corrs[3] = {&corrs[0], &corrs[1], &corrs[2]};
+    static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+    for (int p = 0; p < 3; p++)
+        correlations_set_range(&corrs[p], max_shifts[p]);
+
+    // The write-out includes normalization. On x86-64 hosts the direct
+    // pairs run on the SIMD backend
+    printf("\nus per frame of three mics on the host\n");
+    printf("   n | write-out | window | direct pairs | FFT pairs\n");
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        double us[4];
+
+        rolling_buffer_init(&ring, size_bits);
+        for (int i = 0; i < 2 * ring.size; i++)
+            rolling_buffer_push(&ring, (raw_sample_t)(128 + rand() % 64 - 32));
+
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                rolling_buffer_write_out(&ring, &frames[c]);
+                buffer_normalize_range(&frames[c]);
+            }
+        }
+        us[0] = host_test_us(start, BENCH_REPETITIONS);
+
+        // Independent noise on each mic for the correlations
+        for (int c = 0; c < 3; c++)
+            host_test_frame(&frames[c], size_bits, 0, 1 << size_bits, 8000);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            for (int c = 0; c < 3; c++)
+                buffer_window(&frames[c]);
+        us[1] = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlations_init_pairs(pair_corrs, bufs);
+        us[2] = host_test_us(start, BENCH_REPETITIONS);
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+        {
+            if (spectra_compute(&spectra, bufs, 3))
+            {
+                spectra_correlate(&spectra, 0, 1, &corrs[0]);
+                spectra_correlate(&spectra, 0, 2, &corrs[1]);
+                spectra_correlate(&spectra, 1, 2, &corrs[2]);
+            }
+            else
+            {
+                fft_correlations_init(&corrs[0], &frames[0], &frames[1]);
+                fft_correlations_init(&corrs[1], &frames[0], &frames[2]);
+                fft_correlations_init(&corrs[2], &frames[1], &frames[2]);
+            }
+        }
+        us[3] = host_test_us(start, BENCH_REPETITIONS);
+
+        printf("%4d | %9.1f | %6.1f | %12.1f | %9.1f\n", 1 << size_bits, us[0], us[1], us[2], us[3]);
+    }
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    fft_init();
+
+    const int failed = check_rolling_buffer();
+    bench();
+
+    return failed;
+}
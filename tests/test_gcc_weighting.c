@@ -0,0 +1,250 @@
+// The GCC weighting this build selects, in a reverberant field: a
+// resonant source reaching two mics at a known delay, each through its
+// own exponentially decaying diffuse tail, over direct-to-reverberant
+// ratios. Reports how often the best shift is exact and within a sample.
+// Registered once per weighting; under SCOT, also checks the weighted
+// correlation against |A| |B| / sqrt(Saa Sbb) computed in double
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define FRAMES 200
+
+// Diffuse tail: this many taps, decaying by e every TAIL_DECAY samples
+#define TAIL 1024
+#define TAIL_DECAY 250.0
+
+// Within-a-sample rate each weighting must reach at the mildest tail;
+// unweighted peaks are as broad as the source's resonance
+#define MIN_WITHIN_ONE (GCC_WEIGHTING == GCC_WEIGHTING_NONE ? 0.8 : 0.9)
+
+// The SCOT check: frames of this length fit one transform; its band and
+// weight cap as in fft_correlation.c, and the error allowed for the
+// magnitude approximations, relative to the peak
+#define SCOT_FRAME_BITS 9
+#define SCOT_FRAME_SIZE (1 << SCOT_FRAME_BITS)
+#define SCOT_BAND 4
+#define SCOT_MAX_WEIGHT 15.0
+#define MAX_SCOT_ERROR 0.05
+#define TRIALS 20
+
+static const char *const names[4] = {"none", "PHAT", "SCOT", "ML"};
+
+static struct buffer_t frames[2];
+static struct correlations_t corr;
+static double source[FRAME_SIZE + TAIL + 2 * MAX_SHIFT_SAMPLES];
+static double tails[2][TAIL];
+static double spectrum_a[FFT_CORRELATION_MAX_SIZE / 2][2];
+static double spectrum_b[FFT_CORRELATION_MAX_SIZE / 2][2];
+static double expected[CORRELATION_BUFFER_SIZE];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Noise through a resonance at f_hz of pole radius r, at unit power
+static void resonant_source(double f_hz, double r)
+{
+    const double a1 = 2.0 * r * cos(2.0 * M_PI * f_hz / SAMPLE_RATE_HZ);
+    const double a2 = -r * r;
+    const int count = FRAME_SIZE + TAIL + 2 * MAX_SHIFT_SAMPLES;
+    double y1 = 0.0, y2 = 0.0, power = 0.0;
+
+    for (int i = -2000; i < count; i++)
+    {
+        const double y = a1 * y1 + a2 * y2 + gaussian();
+        y2 = y1, y1 = y;
+        if (i >= 0)
+        {
+            source[i] = y;
+            power += y * y;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        source[i] /= sqrt(power / count);
+}
+
+// Each mic hears the source delays[c] samples late, then its own tail at
+// the given direct-to-reverberant ratio
+static void make_frames(const int delays[2], double drr_db)
+{
+    double energy = 0.0;
+    for (int n = 1; n < TAIL; n++)
+        energy += exp(-2.0 * n / TAIL_DECAY);
+    const double gain = pow(10.0, -drr_db / 20.0) / sqrt(energy);
+
+    for (int c = 0; c < 2; c++)
+    {
+        for (int n = 1; n < TAIL; n++)
+            tails[c][n] = gain * gaussian() * exp(-n / TAIL_DECAY);
+
+        host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+        for (int i = 0; i < FRAME_SIZE; i++)
+        {
+            const double *heard = &source[i + TAIL + MAX_SHIFT_SAMPLES - delays[c]];
+            double sum = heard[0];
+            for (int n = 1; n < TAIL; n++)
+                sum += tails[c][n] * heard[-n];
+            frames[c].buffer[i] = clip(3000.0 * (sum + 0.03 * gaussian()));
+        }
+        buffer_window(&frames[c]);
+    }
+}
+
+static int check_reverberation(void)
+{
+    static const double drrs_db[4] = {6.0, 0.0, -6.0, -12.0};
+    const int range = MAX_SHIFT_AC_SAMPLES - 2;
+    int failed = 0;
+
+    printf("%s weighting, tail decaying by e every %.0f samples\n", names[GCC_WEIGHTING], TAIL_DECAY);
+    printf("DRR    | exact | within 1\n");
+    for (int k = 0; k < 4; k++)
+    {
+        long exact = 0;
+        long within = 0;
+
+        srand(132);
+        for (int t = 0; t < FRAMES; t++)
+        {
+            const int delays[2] = {0, rand() % (2 * range + 1) - range};
+
+            resonant_source(300.0 + rand() % 4000, 0.9 + 0.09 * rand() / RAND_MAX);
+            make_frames(delays, drrs_db[k]);
+
+            fft_correlations_init(&corr, &frames[0], &frames[1]);
+            exact += (corr.best_shift == delays[1]);
+            within += (abs(corr.best_shift - delays[1]) <= 1);
+        }
+
+        printf("%3.0f dB | %4.0f%% | %7.0f%%\n", drrs_db[k], 100.0 * exact / FRAMES, 100.0 * within / FRAMES);
+        if (k == 0)
+            failed += (within < MIN_WITHIN_ONE * FRAMES);
+    }
+
+    return host_test_report("best shift within a sample at the mildest tail", failed, 1);
+}
+
+// SCOT on noise frames against the same weighting in double: the
+// transform the engine builds for one block, bands of GCC_BAND bins
+// weighted |A| |B| / sqrt(Saa Sbb) up to the cap, and the inverse at
+// the engine's output scale of 2^16 per unit weight over the length.
+// Normalising by the mean magnitude rather than the root mean power
+// puts Rayleigh-distributed bins about a quarter high
+static int check_scot(void)
+{
+    if (GCC_WEIGHTING != GCC_WEIGHTING_SCOT)
+        return 0;
+
+    const int max_shift = corr.max_shift;
+    const int size = SCOT_FRAME_SIZE;
+    int m = 1;
+    while (m < size + 2 * max_shift)
+        m <<= 1;
+
+    long mismatches = 0;
+    double worst = 0.0;
+
+    srand(32);
+    for (int t = 0; t < TRIALS; t++)
+    {
+        // The same noise on both, at two levels, with more noise on b
+        const double level = (t % 2 ? 2000.0 : 600.0);
+        for (int i = 0; i < size; i++)
+            source[i] = level * gaussian();
+
+        for (int c = 0; c < 2; c++)
+        {
+            host_test_frame(&frames[c], SCOT_FRAME_BITS, 0, size, 0);
+            for (int i = 0; i < size; i++)
+                frames[c].buffer[i] = clip(source[i] + (c ? 800.0 * gaussian() : 0.0));
+        }
+
+        // Both frames sit at max_shift in the transform
+        for (int k = 0; k < m / 2; k++)
+        {
+            double ar = 0.0, ai = 0.0, br = 0.0, bi = 0.0;
+            for (int i = 0; i < size; i++)
+            {
+                const double w = -2.0 * M_PI * (double)((long)k * (i + max_shift) % m) / m;
+                ar += frames[0].buffer[i] * cos(w);
+                ai += frames[0].buffer[i] * sin(w);
+                br += frames[1].buffer[i] * cos(w);
+                bi += frames[1].buffer[i] * sin(w);
+            }
+            spectrum_a[k][0] = ar, spectrum_a[k][1] = ai;
+            spectrum_b[k][0] = br, spectrum_b[k][1] = bi;
+        }
+
+        for (int s = -max_shift; s <= max_shift; s++)
+            expected[s + MAX_SHIFT_SAMPLES] = 0.0;
+
+        for (int k0 = 1; k0 < m / 2; k0 += SCOT_BAND)
+        {
+            const int k1 = (k0 + SCOT_BAND < m / 2 ? k0 + SCOT_BAND : m / 2);
+            double saa = 0.0, sbb = 0.0;
+            for (int k = k0; k < k1; k++)
+            {
+                saa += spectrum_a[k][0] * spectrum_a[k][0] + spectrum_a[k][1] * spectrum_a[k][1];
+                sbb += spectrum_b[k][0] * spectrum_b[k][0] + spectrum_b[k][1] * spectrum_b[k][1];
+            }
+            const double norm = sqrt(saa / (k1 - k0) * sbb / (k1 - k0));
+
+            for (int k = k0; k < k1; k++)
+            {
+                const double cr = spectrum_a[k][0] * spectrum_b[k][0] + spectrum_a[k][1] * spectrum_b[k][1];
+                const double ci = spectrum_a[k][0] * spectrum_b[k][1] - spectrum_a[k][1] * spectrum_b[k][0];
+                const double magnitude = hypot(cr, ci);
+                const double weight = fmin(magnitude / norm, SCOT_MAX_WEIGHT);
+                for (int s = -max_shift; s <= max_shift; s++)
+                {
+                    const double w = 2.0 * M_PI * (double)((long)k * (s + m) % m) / m;
+                    expected[s + MAX_SHIFT_SAMPLES] +=
+                        2.0 * 65536.0 / m * weight * (cr * cos(w) - ci * sin(w)) / magnitude;
+                }
+            }
+        }
+
+        fft_correlations_init(&corr, &frames[0], &frames[1]);
+
+        double peak = 0.0, error = 0.0;
+        for (int s = -max_shift; s <= max_shift; s++)
+            peak = fmax(peak, fabs(expected[s + MAX_SHIFT_SAMPLES]));
+        for (int s = -max_shift; s <= max_shift; s++)
+            error = fmax(error, fabs(corr.correlations[s + MAX_SHIFT_SAMPLES] - expected[s + MAX_SHIFT_SAMPLES]));
+
+        worst = fmax(worst, error / peak);
+        mismatches += (error > MAX_SCOT_ERROR * peak);
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "SCOT vs double, worst error %.3f of the peak", worst);
+    return host_test_report(what, mismatches, TRIALS);
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    correlations_set_range(&corr, MAX_SHIFT_AC_SAMPLES);
+
+    int failed = check_reverberation();
+    failed |= check_scot();
+
+    return failed;
+}
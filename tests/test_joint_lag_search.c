@@ -0,0 +1,224 @@
+// joint_lag_search against each pair's own best shift. Peaks planted at
+// a feasible triple must come back unchanged, and the closure
+// shift_ab + shift_bc = shift_ac must always hold. Then both are run on
+// simulated sources with reverberation over a range of SNRs, where the
+// joint search must get all three shifts right at least as often
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/biquad.h>
+#include <components/fft_correlation.h>
+#include <components/joint_lag_search.h>
+#include <components/microphones.h>
+
+#define PLANTED_TRIALS 2000
+#define SOURCE_TRIALS 200
+#define FRAME_BITS 10
+#define SOURCE_SAMPLES 8192
+
+// Source placed this far above the mic plane, m
+#define SOURCE_HEIGHT_M 1.2
+
+static struct correlations_t corr_ab;
+static struct correlations_t corr_ac;
+static struct correlations_t corr_bc;
+static struct buffer_t frames[3];
+static struct biquad_cascade_t prefilter;
+static double source[SOURCE_SAMPLES];
+
+static double uniform(void)
+{
+    return 2.0 * rand() / RAND_MAX - 1.0;
+}
+
+static void set_ranges(void)
+{
+    correlations_set_range(&corr_ab, MAX_SHIFT_AB_SAMPLES);
+    correlations_set_range(&corr_ac, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&corr_bc, MAX_SHIFT_BC_SAMPLES);
+}
+
+// Shifts a source at (x, y) puts on each pair, in samples
+static void true_shifts(double x, double y, double shifts[3])
+{
+    const point2d_t *mics[3] = {&mic_a_location, &mic_b_location, &mic_c_location};
+    double delay[3];
+
+    for (int m = 0; m < 3; m++)
+    {
+        const double dx = x - mics[m]->x;
+        const double dy = y - mics[m]->y;
+        delay[m] = sqrt(dx * dx + dy * dy + SOURCE_HEIGHT_M * SOURCE_HEIGHT_M) / SPEED_OF_SOUND_MPS * SAMPLE_RATE_HZ;
+    }
+
+    shifts[0] = delay[1] - delay[0];
+    shifts[1] = delay[2] - delay[0];
+    shifts[2] = shifts[1] - shifts[0];
+}
+
+static void random_source(double shifts[3])
+{
+    const double angle = uniform() * M_PI;
+    const double radius = fabs(uniform()) * 2.0;
+    true_shifts(radius * cos(angle), radius * sin(angle), shifts);
+}
+
+// Low random curve with one tall peak at shift
+static void plant(struct correlations_t *corr, int shift)
+{
+    for (int s = -corr->max_shift; s <= corr->max_shift; s++)
+        corr->correlations[s + MAX_SHIFT_SAMPLES] = rand() % 1000000;
+
+    corr->correlations[shift + MAX_SHIFT_SAMPLES] = 10000000;
+}
+
+static int check_planted(void)
+{
+    long mismatches = 0;
+
+    srand(39);
+    for (int t = 0; t < PLANTED_TRIALS; t++)
+    {
+        double shifts[3];
+        random_source(shifts);
+
+        const int s_ab = (int)lround(shifts[0]);
+        const int s_ac = (int)lround(shifts[1]);
+
+        set_ranges();
+        plant(&corr_ab, s_ab);
+        plant(&corr_ac, s_ac);
+        plant(&corr_bc, s_ac - s_ab);
+
+        joint_lag_search(&corr_ab, &corr_ac, &corr_bc);
+
+        mismatches += (corr_ab.best_shift != s_ab || corr_ac.best_shift != s_ac ||
+                       corr_bc.best_shift != s_ac - s_ab);
+    }
+
+    return host_test_report("planted feasible peaks vs joint search", mismatches, PLANTED_TRIALS);
+}
+
+// Adds gain times the source from sample 3000 on, delayed by a fraction
+// of a sample through a Blackman-windowed sinc, to out[0..n)
+static void add_delayed(double *out, int n, double delay, double gain)
+{
+    const int whole = (int)floor(delay);
+    const double fraction = delay - whole;
+    double taps[65];
+
+    for (int k = -32; k <= 32; k++)
+    {
+        const double t = k - fraction;
+        const double sinc = (t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t));
+        const double window = 0.42 + 0.5 * cos(M_PI * t / 33) + 0.08 * cos(2 * M_PI * t / 33);
+        taps[k + 32] = gain * sinc * window;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        double sum = 0.0;
+        for (int k = -32; k <= 32; k++)
+            sum += source[3000 + i - whole - k] * taps[k + 32];
+        out[i] += sum;
+    }
+}
+
+static bool within_one(const struct correlations_t *corrs[3], const double shifts[3])
+{
+    for (int p = 0; p < 3; p++)
+        if (fabs(corrs[p]->best_shift - shifts[p]) >= 1.5)
+            return false;
+    return true;
+}
+
+static int check_sources(void)
+{
+    static const int snrs_db[] = {-12, -6, 0, 6, 20};
+    int failed = 0;
+
+    for (size_t k = 0; k < sizeof(snrs_db) / sizeof(snrs_db[0]); k++)
+    {
+        const double noise = pow(10.0, -snrs_db[k] / 20.0);
+        int independent = 0;
+        int joint = 0;
+        int closure = 0;
+
+        srand(5);
+        for (int t = 0; t < SOURCE_TRIALS; t++)
+        {
+            double shifts[3];
+            random_source(shifts);
+
+            for (int i = 0; i < SOURCE_SAMPLES; i++)
+                source[i] = uniform();
+
+            // One echo per mic, at its own delay and gain
+            for (int m = 0; m < 3; m++)
+            {
+                const double delay = (m == 0 ? 0.0 : shifts[m - 1]);
+                const int echo_delay = 5 + rand() % 60;
+                const double echo_gain = 0.6 * uniform();
+
+                double mic[1 << FRAME_BITS];
+                for (int i = 0; i < (1 << FRAME_BITS); i++)
+                    mic[i] = noise * uniform();
+                add_delayed(mic, 1 << FRAME_BITS, delay, 1.0);
+                add_delayed(mic, 1 << FRAME_BITS, delay + echo_delay, echo_gain);
+
+                host_test_frame(&frames[m], FRAME_BITS, 0, 1 << FRAME_BITS, 0);
+                for (int i = 0; i < frames[m].size; i++)
+                    frames[m].buffer[i] = (sample_t)(5000 * mic[i]);
+
+                biquad_cascade_reset(&prefilter);
+                biquad_cascade_process(&prefilter, &frames[m]);
+                buffer_window(&frames[m]);
+            }
+
+            set_ranges();
+            if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+            {
+                fft_correlations_init(&corr_ab, &frames[0], &frames[1]);
+                fft_correlations_init(&corr_ac, &frames[0], &frames[2]);
+                fft_correlations_init(&corr_bc, &frames[1], &frames[2]);
+            }
+            else
+            {
+                correlations_init(&corr_ab, &frames[0], &frames[1]);
+                correlations_init(&corr_ac, &frames[0], &frames[2]);
+                correlations_init(&corr_bc, &frames[1], &frames[2]);
+            }
+
+            const struct correlations_t *corrs[3] = {&corr_ab, &corr_ac, &corr_bc};
+            independent += within_one(corrs, shifts);
+
+            joint_lag_search(&corr_ab, &corr_ac, &corr_bc);
+            joint += within_one(corrs, shifts);
+            closure += (corr_ab.best_shift + corr_bc.best_shift == corr_ac.best_shift);
+        }
+
+        const bool ok = (joint >= independent && closure == SOURCE_TRIALS);
+        printf("SNR %3d dB: all three within a sample: independent %3d/%d, joint %3d/%d; closure %d/%d%s\n",
+               snrs_db[k], independent, SOURCE_TRIALS, joint, SOURCE_TRIALS, closure, SOURCE_TRIALS,
+               ok ? "" : "  FAILED");
+        failed |= !ok;
+    }
+
+    return failed;
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    fft_init();
+    microphones_init();
+    joint_lag_search_init();
+    biquad_cascade_init_band(&prefilter, PREFILTER_HIGHPASS_HZ, PREFILTER_LOWPASS_HZ);
+
+    int failed = check_planted();
+    failed |= check_sources();
+
+    return failed;
+}
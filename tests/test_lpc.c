@@ -0,0 +1,255 @@
+// LPC pre-whitening: lpc_estimate against Levinson-Durbin in double on
+// the same pooled autocorrelation, lpc_inverse_filter against the same
+// FIR in double, and then what whitening does for the direct engine on
+// a resonant source reaching two mics at a known delay, alone or with a
+// reflection: the width of the correlation peak and how often its best
+// shift is exact, with and without whitening, over SNRs
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/lpc.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define FRAMES 300
+#define ORDER PREWHITEN_LPC_ORDER
+
+// Coefficient error allowed against the double solution, in Q4.12 steps
+#define MAX_COEFF_ERROR 2
+
+static struct buffer_t frames[3];
+#define SOURCE_MARGIN (2 * MAX_SHIFT_SAMPLES)
+
+static double source[FRAME_SIZE + 2 * SOURCE_MARGIN];
+static struct correlations_t corr;
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Noise through a resonance at f_hz of pole radius r, at unit power
+static void resonant_source(double f_hz, double r)
+{
+    const double a1 = 2.0 * r * cos(2.0 * M_PI * f_hz / SAMPLE_RATE_HZ);
+    const double a2 = -r * r;
+    double y1 = 0.0, y2 = 0.0, power = 0.0;
+    const int count = FRAME_SIZE + 2 * SOURCE_MARGIN;
+
+    // Settle the recursion first
+    for (int i = -2000; i < count; i++)
+    {
+        const double y = a1 * y1 + a2 * y2 + gaussian();
+        y2 = y1, y1 = y;
+        if (i >= 0)
+        {
+            source[i] = y;
+            power += y * y;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        source[i] /= sqrt(power / count);
+}
+
+// Frame c hears the source delays[c] samples late, a reflection of it
+// echoes[c] samples later still, and its own noise
+static void make_frames(const int delays[], const int echoes[], int num_frames, double level, double reflection,
+                        double noise)
+{
+    for (int c = 0; c < num_frames; c++)
+    {
+        const double *direct = &source[SOURCE_MARGIN - delays[c]];
+
+        host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+        for (int i = 0; i < FRAME_SIZE; i++)
+        {
+            frames[c].buffer[i] =
+                clip(level * (direct[i] + reflection * direct[i - echoes[c]] + noise * gaussian()));
+        }
+    }
+}
+
+// Levinson-Durbin in double as lpc_estimate sets it up: pooled
+// autocorrelation, the white-noise correction and bandwidth expansion
+static void reference_coeffs(int num_bufs, double coeffs[])
+{
+    double r[LPC_MAX_ORDER + 1] = {0};
+    double a[LPC_MAX_ORDER + 1] = {0};
+    double next[LPC_MAX_ORDER + 1];
+
+    for (int b = 0; b < num_bufs; b++)
+        for (int k = 0; k <= ORDER; k++)
+            for (int i = k; i < FRAME_SIZE; i++)
+                r[k] += (double)frames[b].buffer[i] * frames[b].buffer[i - k];
+
+    r[0] *= 1.0 + 1.0 / 1024.0;
+
+    double err = r[0];
+    for (int i = 1; i <= ORDER; i++)
+    {
+        double acc = r[i];
+        for (int j = 1; j < i; j++)
+            acc += a[j] * r[i - j];
+
+        const double k = -acc / err;
+        for (int j = 1; j < i; j++)
+            next[j] = a[j] + k * a[i - j];
+        for (int j = 1; j < i; j++)
+            a[j] = next[j];
+        a[i] = k;
+        err *= 1.0 - k * k;
+    }
+
+    for (int j = 1; j <= ORDER; j++)
+        coeffs[j - 1] = a[j] * pow(0.94, j);
+}
+
+static int check_filter(void)
+{
+    static const double resonances[4][2] = {{300.0, 0.9}, {1500.0, 0.97}, {4000.0, 0.99}, {12000.0, 0.8}};
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    static sample_t input[FRAME_SIZE];
+    struct lpc_t lpc;
+    long coeff_mismatches = 0;
+    long filter_mismatches = 0;
+    long filter_checks = 0;
+    double worst_coeff = 0.0;
+
+    srand(27);
+    for (int t = 0; t < FRAMES; t++)
+    {
+        const int delays[3] = {0, rand() % 21 - 10, rand() % 41 - 20};
+        const int echoes[3] = {0, 0, 0};
+        const double level = (t % 3 == 0 ? 2000.0 : 8000.0);
+        double coeffs[LPC_MAX_ORDER];
+
+        resonant_source(resonances[t % 4][0], resonances[t % 4][1]);
+        make_frames(delays, echoes, 3, level, 0.0, 0.05);
+
+        lpc_estimate(&lpc, ORDER, bufs, 3);
+        reference_coeffs(3, coeffs);
+
+        for (int j = 0; j < ORDER; j++)
+        {
+            const double error = fabs(lpc.coeffs[j] - coeffs[j] * (1 << LPC_COEFF_BITS));
+            worst_coeff = fmax(worst_coeff, error);
+            coeff_mismatches += (error > MAX_COEFF_ERROR);
+        }
+
+        for (int i = 0; i < FRAME_SIZE; i++)
+            input[i] = frames[0].buffer[i];
+        lpc_inverse_filter(&lpc, &frames[0]);
+
+        for (int i = 0; i < FRAME_SIZE; i++)
+        {
+            double acc = input[i] * (double)(1 << LPC_COEFF_BITS);
+            for (int j = 0; j < lpc.order && j < i; j++)
+                acc += (double)lpc.coeffs[j] * input[i - 1 - j];
+
+            const double expected = fmax(INT16_MIN, fmin(INT16_MAX, acc / (1 << (LPC_COEFF_BITS - lpc.output_shift))));
+            filter_checks++;
+            filter_mismatches += (fabs(frames[0].buffer[i] - expected) > 0.5);
+        }
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "lpc_estimate vs double, worst %.2f steps", worst_coeff);
+    int failed = host_test_report(what, coeff_mismatches, (long)FRAMES * ORDER);
+    failed |= host_test_report("lpc_inverse_filter vs double", filter_mismatches, filter_checks);
+    return failed;
+}
+
+// Lags around the best shift holding at least half its height
+static int peak_width(void)
+{
+    const power_t half = corr.correlations[corr.best_shift + MAX_SHIFT_SAMPLES] / 2;
+    int width = 1;
+
+    for (int s = corr.best_shift + 1; s <= corr.max_shift && corr.correlations[s + MAX_SHIFT_SAMPLES] >= half; s++)
+        width++;
+    for (int s = corr.best_shift - 1; s >= -corr.max_shift && corr.correlations[s + MAX_SHIFT_SAMPLES] >= half; s--)
+        width++;
+
+    return width;
+}
+
+// Mean peak width and exact rate over SNRs, with and without whitening,
+// where the mics hear the source alone or with one reflection each.
+// Fails where whitening widens the peak
+static int compare_whitening(double reflection)
+{
+    static const double snrs_db[4] = {20.0, 10.0, 0.0, -6.0};
+    const struct buffer_t *const bufs[2] = {&frames[0], &frames[1]};
+    static struct buffer_t saved[2];
+    struct lpc_t lpc;
+    int failed = 0;
+
+    printf("reflection %.1f\n", reflection);
+    printf("SNR    | width plain | width whitened | exact plain | exact whitened\n");
+    for (int k = 0; k < 4; k++)
+    {
+        const double noise = pow(10.0, -snrs_db[k] / 20.0);
+        long width[2] = {0, 0};
+        long exact[2] = {0, 0};
+
+        srand(127);
+        for (int t = 0; t < FRAMES; t++)
+        {
+            const int delays[2] = {0, rand() % (2 * MAX_SHIFT_AC_SAMPLES - 3) - MAX_SHIFT_AC_SAMPLES + 2};
+            const int echoes[2] = {3 + rand() % 8, 3 + rand() % 8};
+
+            resonant_source(500.0 + rand() % 3000, 0.95 + 0.04 * rand() / RAND_MAX);
+            make_frames(delays, echoes, 2, 3000.0, reflection, noise);
+            saved[0] = frames[0];
+            saved[1] = frames[1];
+
+            for (int whiten = 0; whiten < 2; whiten++)
+            {
+                frames[0] = saved[0];
+                frames[1] = saved[1];
+                if (whiten)
+                {
+                    lpc_estimate(&lpc, ORDER, bufs, 2);
+                    lpc_inverse_filter(&lpc, &frames[0]);
+                    lpc_inverse_filter(&lpc, &frames[1]);
+                }
+                buffer_window(&frames[0]);
+                buffer_window(&frames[1]);
+
+                correlations_init(&corr, &frames[0], &frames[1]);
+                width[whiten] += peak_width();
+                exact[whiten] += (corr.best_shift == delays[1] - delays[0]);
+            }
+        }
+
+        printf("%3.0f dB | %11.1f | %14.1f | %10.0f%% | %13.0f%%\n", snrs_db[k], (double)width[0] / FRAMES,
+               (double)width[1] / FRAMES, 100.0 * exact[0] / FRAMES, 100.0 * exact[1] / FRAMES);
+
+        failed += (width[1] > width[0]);
+    }
+
+    return host_test_report("whitened peaks at least as narrow", failed, 4);
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    correlations_set_range(&corr, MAX_SHIFT_AC_SAMPLES);
+
+    int failed = check_filter();
+    failed |= compare_whitening(0.0);
+    failed |= compare_whitening(0.7);
+
+    return failed;
+}
@@ -0,0 +1,275 @@
+// The onset-gated window: buffer_find_onset on steps and on silence, the
+// span and zeroing of buffer_window_onset, and its fallback to the whole
+// frame when there is no onset. Then claps in simulated rooms, built by
+// the image-source method up to third-order reflections, comparing how
+// often each pair's best shift is within a sample of the direct path's
+// with the gated and the whole window
+
+#include <host_test.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define ROOMS 200
+#define MAX_ORDER 3
+#define TAPS 16
+
+// Source samples before the frame starts
+#define SOURCE_LEAD 1024
+
+static const int pair_a[3] = {0, 0, 1};
+static const int pair_b[3] = {1, 2, 2};
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+static struct buffer_t frames[3];
+static struct buffer_t whole[3];
+static struct correlations_t corrs[3];
+static double source[SOURCE_LEAD + FRAME_SIZE + TAPS];
+static double mics[3][FRAME_SIZE];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static double uniform(double low, double high)
+{
+    return low + (high - low) * rand() / RAND_MAX;
+}
+
+static int check_gating(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    long mismatches = 0;
+
+    srand(29);
+    for (int t = 0; t < 1000; t++)
+    {
+        const int onset = rand() % FRAME_SIZE;
+        const int channel = rand() % 3;
+        const int pre = rand() % (ONSET_PRE_SAMPLES + 1);
+
+        // Quiet noise everywhere, a step to full level on one channel
+        for (int c = 0; c < 3; c++)
+        {
+            host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 500);
+            if (c == channel)
+                for (int i = onset; i < FRAME_SIZE; i++)
+                    frames[c].buffer[i] = (sample_t)(i == onset ? 20000 : host_test_sample(20000));
+        }
+
+        mismatches += (buffer_find_onset(bufs, 3) != onset);
+
+        buffer_window_onset(&frames[channel], onset, pre, ONSET_SPAN_SAMPLES);
+        const int start = (onset > pre ? onset - pre : 0);
+        const int end = (start + ONSET_SPAN_SAMPLES < FRAME_SIZE ? start + ONSET_SPAN_SAMPLES : FRAME_SIZE);
+        int outside = 0;
+        for (int i = 0; i < FRAME_SIZE; i++)
+            outside += ((i < start || i >= end) && frames[channel].buffer[i] != 0);
+        mismatches += (frames[channel].start != start || frames[channel].end != end || outside != 0);
+
+        // Silence has no onset, and the gate then keeps the whole frame
+        for (int c = 0; c < 3; c++)
+            host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+        mismatches += (buffer_find_onset(bufs, 3) != -1);
+
+        host_test_frame(&frames[0], FRAME_BITS, 0, FRAME_SIZE, 1000);
+        whole[0] = frames[0];
+        buffer_window(&whole[0]);
+        buffer_window_onset(&frames[0], -1, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+        mismatches += (memcmp(frames[0].buffer, whole[0].buffer, FRAME_SIZE * sizeof(sample_t)) != 0 ||
+                       frames[0].start != 0 || frames[0].end != FRAME_SIZE);
+    }
+
+    return host_test_report("onset search, gated span and fallback", mismatches, 1000);
+}
+
+// Adds gain times the source, delayed by delay samples through a
+// Hann-windowed sinc, to out
+static void add_delayed(double *out, double delay, double gain)
+{
+    const int whole_delay = (int)floor(delay);
+    const double fraction = delay - whole_delay;
+    double taps[2 * TAPS + 1];
+
+    for (int k = -TAPS; k <= TAPS; k++)
+    {
+        const double t = k - fraction;
+        const double sinc = (t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t));
+        taps[k + TAPS] = gain * sinc * (0.5 + 0.5 * cos(M_PI * t / (TAPS + 1)));
+    }
+
+    for (int i = 0; i < FRAME_SIZE; i++)
+    {
+        const int first = SOURCE_LEAD + i - whole_delay;
+        if (first + TAPS < 0 || first - TAPS >= SOURCE_LEAD + FRAME_SIZE)
+            continue;
+
+        double sum = 0.0;
+        for (int k = -TAPS; k <= TAPS; k++)
+        {
+            const int j = first - k;
+            if (j >= 0 && j < SOURCE_LEAD + FRAME_SIZE + TAPS)
+                sum += source[j] * taps[k + TAPS];
+        }
+        out[i] += sum;
+    }
+}
+
+// One image per wall sequence: along each axis the image sits at
+// (1 - 2p) x + 2 m L after |m - p| + |m| reflections. Every path is
+// shortened by the nearest mic's direct path, so the clap lands at the
+// same point of every frame; delays[] are the direct paths after that
+static void simulate_room(const double room[3], const double src[3], const double mic_pos[3][3], double beta,
+                          double delays[3])
+{
+    const double samples_per_m = SAMPLE_RATE_HZ / (double)SPEED_OF_SOUND_MPS;
+    double nearest = 1e9;
+
+    for (int c = 0; c < 3; c++)
+    {
+        const double dx = src[0] - mic_pos[c][0];
+        const double dy = src[1] - mic_pos[c][1];
+        const double dz = src[2] - mic_pos[c][2];
+        nearest = fmin(nearest, sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        for (int i = 0; i < FRAME_SIZE; i++)
+            mics[c][i] = 0.0;
+
+        for (int mx = -2; mx <= 2; mx++)
+        for (int px = 0; px < 2; px++)
+        for (int my = -2; my <= 2; my++)
+        for (int py = 0; py < 2; py++)
+        for (int mz = -2; mz <= 2; mz++)
+        for (int pz = 0; pz < 2; pz++)
+        {
+            const int order = abs(mx - px) + abs(mx) + abs(my - py) + abs(my) + abs(mz - pz) + abs(mz);
+            if (order > MAX_ORDER)
+                continue;
+
+            const double image[3] = {
+                (1 - 2 * px) * src[0] + 2 * mx * room[0],
+                (1 - 2 * py) * src[1] + 2 * my * room[1],
+                (1 - 2 * pz) * src[2] + 2 * mz * room[2],
+            };
+            const double dx = image[0] - mic_pos[c][0];
+            const double dy = image[1] - mic_pos[c][1];
+            const double dz = image[2] - mic_pos[c][2];
+            const double distance = sqrt(dx * dx + dy * dy + dz * dz);
+
+            add_delayed(mics[c], (distance - nearest) * samples_per_m, pow(beta, order) / distance);
+            if (order == 0)
+                delays[c] = (distance - nearest) * samples_per_m;
+        }
+    }
+}
+
+static void correlate(struct correlations_t *corr, const struct buffer_t *a, const struct buffer_t *b)
+{
+    if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+        fft_correlations_init(corr, a, b);
+    else
+        correlations_init(corr, a, b);
+}
+
+static int check_rooms(void)
+{
+    // Mic A at the origin, B along x, C from the three distances
+    const double ab = MIC_DIST_AB_M, bc = MIC_DIST_BC_M, ca = MIC_DIST_CA_M;
+    const double cx = (ca * ca - bc * bc + ab * ab) / (2.0 * ab);
+    const double offsets[3][2] = {{0.0, 0.0}, {ab, 0.0}, {cx, sqrt(ca * ca - cx * cx)}};
+    static const double betas[3] = {0.5, 0.8, 0.95};
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+    int failed = 0;
+
+    printf("wall reflection | gated within 1 | whole within 1 | no onset\n");
+    for (int k = 0; k < 3; k++)
+    {
+        long gated = 0;
+        long full = 0;
+        long missed = 0;
+
+        srand(129);
+        for (int r = 0; r < ROOMS; r++)
+        {
+            const double room[3] = {uniform(3.0, 8.0), uniform(3.0, 6.0), uniform(2.4, 3.5)};
+            const double centre[3] = {uniform(1.0, room[0] - 1.0), uniform(1.0, room[1] - 1.0), 1.0};
+            const double src[3] = {uniform(0.5, room[0] - 0.5), uniform(0.5, room[1] - 0.5), uniform(0.3, 2.0)};
+            double mic_pos[3][3];
+            double delays[3];
+
+            for (int c = 0; c < 3; c++)
+            {
+                mic_pos[c][0] = centre[0] + offsets[c][0];
+                mic_pos[c][1] = centre[1] + offsets[c][1];
+                mic_pos[c][2] = centre[2];
+            }
+
+            // A clap: a decaying burst from a random point in the frame
+            const int clap = SOURCE_LEAD + 200 + rand() % 300;
+            for (int i = 0; i < SOURCE_LEAD + FRAME_SIZE + TAPS; i++)
+                source[i] = (i >= clap ? gaussian() * exp(-(i - clap) / 120.0) : 0.0);
+
+            simulate_room(room, src, mic_pos, betas[k], delays);
+
+            double level = 0.0;
+            for (int c = 0; c < 3; c++)
+                for (int i = 0; i < FRAME_SIZE; i++)
+                    level = fmax(level, fabs(mics[c][i]));
+
+            for (int c = 0; c < 3; c++)
+            {
+                host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+                for (int i = 0; i < FRAME_SIZE; i++)
+                    frames[c].buffer[i] = (sample_t)lrint(20000.0 * mics[c][i] / level + 100.0 * gaussian());
+                whole[c] = frames[c];
+                buffer_window(&whole[c]);
+            }
+
+            const int onset = buffer_find_onset(bufs, 3);
+            missed += (onset < 0);
+            for (int c = 0; c < 3; c++)
+                buffer_window_onset(&frames[c], onset, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+
+            for (int p = 0; p < 3; p++)
+            {
+                const double truth = delays[pair_b[p]] - delays[pair_a[p]];
+
+                correlate(&corrs[p], &frames[pair_a[p]], &frames[pair_b[p]]);
+                gated += (fabs(corrs[p].best_shift - truth) < 1.5);
+
+                correlate(&corrs[p], &whole[pair_a[p]], &whole[pair_b[p]]);
+                full += (fabs(corrs[p].best_shift - truth) < 1.5);
+            }
+        }
+
+        printf("%15.2f | %13.0f%% | %13.0f%% | %8ld\n", betas[k], 100.0 * gated / (3 * ROOMS),
+               100.0 * full / (3 * ROOMS), missed);
+        failed += (gated < full || missed != 0);
+    }
+
+    return host_test_report("gated at least as accurate as the whole window", failed, 3);
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    fft_init();
+    for (int p = 0; p < 3; p++)
+        correlations_set_range(&corrs[p], max_shifts[p]);
+
+    int failed = check_gating();
+    failed |= check_rooms();
+
+    return failed;
+}
@@ -0,0 +1,156 @@
+// Per-pair lag ranges on the geometry this build is given. microphones_init
+// must place the mics at the configured distances, and each pair's range
+// must hold the delay of a source straight along its axis with the margin
+// to spare. Then sources all around the array: the three pair
+// correlations and the joint search must get every shift within a
+// sample, and no pair may hold anything past its own range. Registered
+// on the default triangle and on non-equilateral ones where a different
+// pair is the widest
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+#include <components/joint_lag_search.h>
+#include <components/microphones.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define SOURCES 200
+#define SOURCE_RADIUS_M 2.0
+
+// Placement error allowed, m
+#define MAX_PLACEMENT_ERROR 1e-5
+
+// Rate at which all three shifts must be within a sample
+#define MIN_WITHIN_ONE 0.95
+
+static const int pair_a[3] = {0, 0, 1};
+static const int pair_b[3] = {1, 2, 2};
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+static const double distances_m[3] = {MIC_DIST_AB_M, MIC_DIST_CA_M, MIC_DIST_BC_M};
+
+static struct buffer_t frames[3];
+static struct correlations_t corrs[3];
+static double source[FRAME_SIZE + 4 * MAX_SHIFT_SAMPLES];
+static const point2d_t *mics[3];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Arrival time at mic m of a source at (x, y) in the mic plane, samples
+static double arrival(double x, double y, int m)
+{
+    return hypot(x - mics[m]->x, y - mics[m]->y) / SPEED_OF_SOUND_MPS * SAMPLE_RATE_HZ;
+}
+
+static int check_geometry(void)
+{
+    long mismatches = 0;
+
+    printf("pair | distance mm | endfire delay | range\n");
+    for (int p = 0; p < 3; p++)
+    {
+        const point2d_t *a = mics[pair_a[p]];
+        const point2d_t *b = mics[pair_b[p]];
+        const double placed = hypot(b->x - a->x, b->y - a->y);
+
+        // A far source on the axis beyond a, then beyond b
+        const double ux = (b->x - a->x) / placed;
+        const double uy = (b->y - a->y) / placed;
+        const double endfire = arrival(a->x - 100.0 * ux, a->y - 100.0 * uy, pair_b[p]) -
+                               arrival(a->x - 100.0 * ux, a->y - 100.0 * uy, pair_a[p]);
+        const double opposite = arrival(b->x + 100.0 * ux, b->y + 100.0 * uy, pair_b[p]) -
+                                arrival(b->x + 100.0 * ux, b->y + 100.0 * uy, pair_a[p]);
+
+        printf("  %c%c | %11.1f | %13.2f | %5d\n", "AAB"[p], "BCC"[p], placed * 1000.0, endfire, max_shifts[p]);
+        mismatches += (fabs(placed - distances_m[p]) > MAX_PLACEMENT_ERROR);
+        mismatches += (fabs(endfire) + CORRELATION_LAG_MARGIN_SAMPLES > max_shifts[p] ||
+                       fabs(opposite) + CORRELATION_LAG_MARGIN_SAMPLES > max_shifts[p]);
+        mismatches += (max_shifts[p] > MAX_SHIFT_SAMPLES);
+    }
+
+    return host_test_report("mics placed as configured, endfire delays in range", mismatches, 3);
+}
+
+static int check_sources(void)
+{
+    long within = 0;
+    long mismatches = 0;
+
+    srand(43);
+    for (int t = 0; t < SOURCES; t++)
+    {
+        const double angle = 2.0 * M_PI * t / SOURCES;
+        const double x = SOURCE_RADIUS_M * cos(angle);
+        const double y = SOURCE_RADIUS_M * sin(angle);
+
+        for (int i = 0; i < FRAME_SIZE + 4 * MAX_SHIFT_SAMPLES; i++)
+            source[i] = gaussian();
+
+        // Whole-sample arrivals relative to mic A
+        int delays[3];
+        for (int m = 0; m < 3; m++)
+        {
+            delays[m] = (int)lround(arrival(x, y, m) - arrival(x, y, 0));
+            host_test_frame(&frames[m], FRAME_BITS, 0, FRAME_SIZE, 0);
+            for (int i = 0; i < FRAME_SIZE; i++)
+                frames[m].buffer[i] = clip(4000.0 * (source[i + 2 * MAX_SHIFT_SAMPLES - delays[m]] + 0.3 * gaussian()));
+            buffer_window(&frames[m]);
+        }
+
+        for (int p = 0; p < 3; p++)
+        {
+            if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+                fft_correlations_init(&corrs[p], &frames[pair_a[p]], &frames[pair_b[p]]);
+            else
+                correlations_init(&corrs[p], &frames[pair_a[p]], &frames[pair_b[p]]);
+        }
+
+        joint_lag_search(&corrs[0], &corrs[1], &corrs[2]);
+
+        bool all = true;
+        for (int p = 0; p < 3; p++)
+        {
+            all &= (abs(corrs[p].best_shift - (delays[pair_b[p]] - delays[pair_a[p]])) <= 1);
+
+            for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++)
+                mismatches += ((s < -max_shifts[p] || s > max_shifts[p]) && corrs[p].correlations[s + MAX_SHIFT_SAMPLES] != 0);
+        }
+        within += all;
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "sources all around, %ld of %d with every shift within a sample", within, SOURCES);
+    return host_test_report(what, mismatches + (within < MIN_WITHIN_ONE * SOURCES), SOURCES);
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    microphones_init();
+    joint_lag_search_init();
+
+    mics[0] = &mic_a_location;
+    mics[1] = &mic_b_location;
+    mics[2] = &mic_c_location;
+    for (int p = 0; p < 3; p++)
+        correlations_set_range(&corrs[p], max_shifts[p]);
+
+    int failed = check_geometry();
+    failed |= check_sources();
+
+    return failed;
+}
@@ -0,0 +1,99 @@
+// parallel_correlations on both cores against the single-core engine the
+// build selects, pair by pair on the same frames: the correlations, best
+// shifts and refinements must all match. Built once per way the
+// dual-core engine shares out the work
+
+#include <host_test.h>
+
+#include <string.h>
+
+#include <components/dual_core.h>
+#include <components/parallel_correlations.h>
+
+#define FRAMES 300
+
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+static struct buffer_t frames[3];
+static struct correlations_t single[3];
+static struct correlations_t dual[3];
+static struct spectra_t spectra;
+
+// One source reaching each mic at its own delay, plus independent noise
+static void random_frames(int size_bits)
+{
+    static sample_t source[BUFFER_MAX_SIZE + 2 * MAX_SHIFT_SAMPLES];
+    const int size = 1 << size_bits;
+    const int delays[3] = {0, rand() % 21 - 10, rand() % 41 - 20};
+
+    for (int i = 0; i < size + 2 * MAX_SHIFT_SAMPLES; i++)
+        source[i] = host_test_sample(rand() % 4 ? 1000 : 8000);
+
+    for (int c = 0; c < 3; c++)
+    {
+        host_test_frame(&frames[c], size_bits, 0, size, 300);
+        for (int i = 0; i < size; i++)
+            frames[c].buffer[i] += source[i + MAX_SHIFT_SAMPLES - delays[c]];
+    }
+}
+
+static void correlate_single(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+
+    // As step 8 does on one core
+    if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT && spectra_compute(&spectra, bufs, 3))
+    {
+        spectra_correlate(&spectra, 0, 1, &single[0]);
+        spectra_correlate(&spectra, 0, 2, &single[1]);
+        spectra_correlate(&spectra, 1, 2, &single[2]);
+    }
+    else if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+    {
+        fft_correlations_init(&single[0], &frames[0], &frames[1]);
+        fft_correlations_init(&single[1], &frames[0], &frames[2]);
+        fft_correlations_init(&single[2], &frames[1], &frames[2]);
+    }
+    else
+    {
+        correlations_init(&single[0], &frames[0], &frames[1]);
+        correlations_init(&single[1], &frames[0], &frames[2]);
+        correlations_init(&single[2], &frames[1], &frames[2]);
+    }
+}
+
+int main(void)
+{
+    long mismatches = 0;
+
+    correlations_tables_init();
+    fft_init();
+    dual_core_init();
+
+    for (int p = 0; p < 3; p++)
+    {
+        correlations_set_range(&single[p], max_shifts[p]);
+        correlations_set_range(&dual[p], max_shifts[p]);
+    }
+
+    srand(37);
+    for (int f = 0; f < FRAMES; f++)
+    {
+        random_frames(BUFFER_MIN_SIZE_BITS + f % 3);
+
+        correlate_single();
+        parallel_correlations(&spectra, &frames[0], &frames[1], &frames[2], &dual[0], &dual[1], &dual[2]);
+
+        for (int p = 0; p < 3; p++)
+        {
+            mismatches += (memcmp(single[p].correlations, dual[p].correlations, sizeof(single[p].correlations)) != 0 ||
+                           single[p].best_shift != dual[p].best_shift ||
+                           single[p].best_shift_q8 != dual[p].best_shift_q8);
+        }
+    }
+
+    printf("coarse-to-fine %d, pruned %d, templates %d, engine %s\n", CORRELATION_COARSE_TO_FINE,
+           CORRELATION_PRUNED_SEARCH, DSP_CORE_TEMPLATES, CORRELATION_ENGINE == CORRELATION_ENGINE_FFT ? "FFT" : "direct");
+
+    return host_test_report("dual-core vs single-core pairs", mismatches, 3L * FRAMES);
+}
@@ -0,0 +1,160 @@
+// Sub-sample peak refinement on fractional delays: band-limited noise
+// reaching the second mic a random, non-integer number of samples late
+// through a windowed-sinc delay. Reports the RMS error of the integer
+// peak and of the PEAK_INTERPOLATION this build selects, which must stay
+// under its bound and, unless it is NONE, well under the integer peak's.
+// Registered once per method on the direct engine, and on the defaults.
+// Also checks fixed_log2_q16, which the Gaussian fit runs on
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+#include <components/fixed_math.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define FRAMES 300
+#define SOURCE_SAMPLES (FRAME_SIZE + 2 * MAX_SHIFT_SAMPLES + 2 * DELAY_TAPS)
+
+// Half-length of the fractional delay filter
+#define DELAY_TAPS 32
+
+// RMS error allowed per method, in samples; the integer peak's is about
+// 0.29, and the weighted engine's sharp peaks leave less to fit
+static const double max_rms_error[4] = {0.35, 0.12, 0.12, 0.12};
+
+// Worst fixed_log2_q16 error allowed, in Q16 steps
+#define MAX_LOG2_ERROR 2
+
+static const char *const names[4] = {"none", "parabolic", "Gaussian", "sinc"};
+
+static struct buffer_t frames[2];
+static struct correlations_t corr;
+static double source[SOURCE_SAMPLES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// White noise through two one-pole low-passes, a few kHz wide
+static void lowpass_source(void)
+{
+    double y1 = 0.0, y2 = 0.0;
+
+    for (int i = -200; i < SOURCE_SAMPLES; i++)
+    {
+        y1 = 0.6 * y1 + 0.4 * gaussian();
+        y2 = 0.6 * y2 + 0.4 * y1;
+        if (i >= 0)
+            source[i] = y2;
+    }
+}
+
+// The source delayed by delay samples through a Blackman-windowed sinc
+static double delayed(int i, double delay)
+{
+    const int whole = (int)floor(delay);
+    const double fraction = delay - whole;
+    double sum = 0.0;
+
+    for (int k = -DELAY_TAPS; k <= DELAY_TAPS; k++)
+    {
+        const double t = k - fraction;
+        const double sinc = (t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t));
+        const double window =
+            0.42 + 0.5 * cos(M_PI * t / (DELAY_TAPS + 1)) + 0.08 * cos(2.0 * M_PI * t / (DELAY_TAPS + 1));
+        sum += source[i + MAX_SHIFT_SAMPLES + DELAY_TAPS - whole - k] * sinc * window;
+    }
+
+    return sum;
+}
+
+static int check_delays(void)
+{
+    const int range = MAX_SHIFT_AC_SAMPLES - 2;
+    double integer_sum = 0.0;
+    double refined_sum = 0.0;
+
+    srand(38);
+    for (int t = 0; t < FRAMES; t++)
+    {
+        const double delay = (2.0 * rand() / RAND_MAX - 1.0) * range;
+
+        lowpass_source();
+        for (int c = 0; c < 2; c++)
+        {
+            host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+            for (int i = 0; i < FRAME_SIZE; i++)
+                frames[c].buffer[i] = clip(8000.0 * (delayed(i, c ? delay : 0.0) + 0.01 * gaussian()));
+            buffer_window(&frames[c]);
+        }
+
+        if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+            fft_correlations_init(&corr, &frames[0], &frames[1]);
+        else
+            correlations_init(&corr, &frames[0], &frames[1]);
+
+        integer_sum += (corr.best_shift - delay) * (corr.best_shift - delay);
+        refined_sum += (corr.best_shift_q8 / 256.0 - delay) * (corr.best_shift_q8 / 256.0 - delay);
+    }
+
+    const double integer_rms = sqrt(integer_sum / FRAMES);
+    const double refined_rms = sqrt(refined_sum / FRAMES);
+    const double bound = max_rms_error[PEAK_INTERPOLATION];
+
+    printf("%s engine, %s refinement: RMS error %.3f samples, integer peak %.3f\n",
+           CORRELATION_ENGINE == CORRELATION_ENGINE_FFT ? "FFT" : "direct", names[PEAK_INTERPOLATION], refined_rms,
+           integer_rms);
+
+    const bool failed = (refined_rms > bound ||
+                         (PEAK_INTERPOLATION != PEAK_INTERPOLATION_NONE && refined_rms > integer_rms / 2.0));
+    return host_test_report("refined shift within its RMS bound", failed, 1);
+}
+
+static int check_log2(void)
+{
+    long mismatches = 0;
+    long checks = 0;
+    double worst = 0.0;
+
+    srand(2);
+    for (int bits = 0; bits < 32; bits++)
+    {
+        for (int t = 0; t < 200; t++)
+        {
+            const uint32_t value = (t == 0 ? 1u << bits : ((uint32_t)rand() << 16 ^ (uint32_t)rand()) >> (31 - bits) | 1u << bits);
+            const double error = fabs(fixed_log2_q16(value) - log2((double)value) * 65536.0);
+
+            worst = fmax(worst, error);
+            mismatches += (error > MAX_LOG2_ERROR);
+            checks++;
+        }
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "fixed_log2_q16 vs log2, worst %.2f Q16 steps", worst);
+    return host_test_report(what, mismatches, checks);
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    correlations_set_range(&corr, MAX_SHIFT_AC_SAMPLES);
+
+    int failed = check_delays();
+    failed |= check_log2();
+
+    return failed;
+}
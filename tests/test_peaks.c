@@ -0,0 +1,285 @@
+// The peaks each pair lists and the confidence it reports, on simulated
+// sources. Several uncorrelated sources at their own delays must each
+// show up among the listed peaks, strongest first. After the joint lag
+// search, the peak-to-sidelobe ratio and height must be those of the
+// shift it chose, checked in double, on two sources that pull the pairs
+// apart. Then the ratio over SNRs and on noise alone, which it must rank
+// in order
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+#include <components/joint_lag_search.h>
+#include <components/microphones.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define TRIALS 300
+#define MAX_SOURCES 3
+
+// Planted sources' shifts stay this far apart, and the listed peaks
+// this close to them
+#define MIN_SPACING (2 * CORRELATION_PEAK_SEPARATION)
+#define PEAK_TOLERANCE 1
+
+// Rate at which every source must be listed, at each source count
+#define MIN_ALL_FOUND 0.85
+
+// Peak-to-sidelobe ratio allowed against double, relative, plus a Q8
+// step for rounding; the height to a Q15 step or two
+#define MAX_PSR_ERROR 0.01
+#define MAX_HEIGHT_ERROR 2.0
+
+// Sources placed this far above the mic plane, m
+#define SOURCE_HEIGHT_M 1.2
+
+static const double levels[MAX_SOURCES] = {1.0, 0.7, 0.5};
+
+static struct buffer_t frames[3];
+static struct correlations_t corrs[3];
+static double sources[MAX_SOURCES][FRAME_SIZE + 2 * MAX_SHIFT_SAMPLES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Mic c hears source j delays[j][c] samples late at gains[j][c], over its
+// own noise
+static void make_frames(int mics, int count, const int delays[][3], const double gains[][3], double noise)
+{
+    for (int j = 0; j < count; j++)
+        for (int i = 0; i < FRAME_SIZE + 2 * MAX_SHIFT_SAMPLES; i++)
+            sources[j][i] = gaussian();
+
+    for (int c = 0; c < mics; c++)
+    {
+        host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+        for (int i = 0; i < FRAME_SIZE; i++)
+        {
+            double sum = noise * gaussian();
+            for (int j = 0; j < count; j++)
+                sum += gains[j][c] * sources[j][i + MAX_SHIFT_SAMPLES - delays[j][c]];
+            frames[c].buffer[i] = clip(3000.0 * sum);
+        }
+        buffer_window(&frames[c]);
+    }
+}
+
+static void correlate(struct correlations_t *corr, int a, int b)
+{
+    if (CORRELATION_ENGINE == CORRELATION_ENGINE_FFT)
+        fft_correlations_init(corr, &frames[a], &frames[b]);
+    else
+        correlations_init(corr, &frames[a], &frames[b]);
+}
+
+// The ratio and height at the best shift, in double
+static void expected_peak(const struct correlations_t *corr, double *psr_q8, double *height_q15)
+{
+    const int best = corr->best_shift + MAX_SHIFT_SAMPLES;
+    double sum = 0.0, sum_squares = 0.0;
+    int count = 0;
+
+    for (int i = MAX_SHIFT_SAMPLES - corr->max_shift; i <= MAX_SHIFT_SAMPLES + corr->max_shift; i++)
+    {
+        if (corr->estimated[i] || (i >= best - CORRELATION_PEAK_SEPARATION && i <= best + CORRELATION_PEAK_SEPARATION))
+            continue;
+
+        sum += (double)corr->correlations[i];
+        sum_squares += (double)corr->correlations[i] * corr->correlations[i];
+        count++;
+    }
+
+    const double mean = sum / count;
+    const double deviation = sqrt(fmax(0.0, sum_squares / count - mean * mean));
+    *psr_q8 = (deviation > 0.0 ? 256.0 * ((double)corr->correlations[best] - mean) / deviation : 0.0);
+    *height_q15 = fmin(32767.0, 32768.0 * corr->correlations[best] / (double)corr->coherent_peak);
+}
+
+static int check_sources(void)
+{
+    int failed = 0;
+
+    printf("sources | all listed | strongest first\n");
+    for (int count = 1; count <= MAX_SOURCES; count++)
+    {
+        long all_found = 0;
+        long strongest_first = 0;
+
+        srand(40 + count);
+        for (int t = 0; t < TRIALS; t++)
+        {
+            // Mic A hears every source at once; mic B at shifts apart
+            int delays[MAX_SOURCES][3];
+            double gains[MAX_SOURCES][3];
+            for (int j = 0; j < count; j++)
+            {
+                bool spaced;
+                do
+                {
+                    delays[j][1] = rand() % (2 * MAX_SHIFT_AC_SAMPLES - 3) - MAX_SHIFT_AC_SAMPLES + 2;
+                    spaced = true;
+                    for (int k = 0; k < j; k++)
+                        spaced &= (abs(delays[j][1] - delays[k][1]) >= MIN_SPACING);
+                } while (!spaced);
+
+                delays[j][0] = 0;
+                gains[j][0] = gains[j][1] = levels[j];
+            }
+
+            make_frames(2, count, delays, gains, 0.3);
+            correlate(&corrs[1], 0, 1);
+
+            bool found = true;
+            for (int j = 0; j < count; j++)
+            {
+                bool listed = false;
+                for (int k = 0; k < corrs[1].num_peaks; k++)
+                    listed |= (abs(corrs[1].peaks[k].shift - delays[j][1]) <= PEAK_TOLERANCE);
+                found &= listed;
+            }
+
+            all_found += found;
+            strongest_first += (abs(corrs[1].peaks[0].shift - delays[0][1]) <= PEAK_TOLERANCE);
+        }
+
+        printf("%7d | %9.0f%% | %14.0f%%\n", count, 100.0 * all_found / TRIALS, 100.0 * strongest_first / TRIALS);
+        failed += (all_found < MIN_ALL_FOUND * TRIALS || strongest_first < MIN_ALL_FOUND * TRIALS);
+    }
+
+    return host_test_report("every source listed, strongest first", failed, MAX_SOURCES);
+}
+
+// Shift of mic m against mic A for a source at (x, y), in samples
+static int true_delay(double x, double y, int m)
+{
+    const point2d_t *mics[3] = {&mic_a_location, &mic_b_location, &mic_c_location};
+    double delay[2];
+
+    for (int k = 0; k < 2; k++)
+    {
+        const point2d_t *mic = (k == 0 ? mics[0] : mics[m]);
+        const double dx = x - mic->x;
+        const double dy = y - mic->y;
+        delay[k] = sqrt(dx * dx + dy * dy + SOURCE_HEIGHT_M * SOURCE_HEIGHT_M) / SPEED_OF_SOUND_MPS * SAMPLE_RATE_HZ;
+    }
+
+    return (int)lround(delay[1] - delay[0]);
+}
+
+// Two sources, one louder at mic A and B and the other at mic C, so the
+// pairs' own best shifts disagree and the joint search moves some
+static int check_joint(void)
+{
+    static const int pair_a[3] = {0, 0, 1};
+    static const int pair_b[3] = {1, 2, 2};
+    long mismatches = 0;
+    long moved = 0;
+
+    srand(400);
+    for (int t = 0; t < TRIALS; t++)
+    {
+        int delays[2][3];
+        double gains[2][3];
+        for (int j = 0; j < 2; j++)
+        {
+            const double angle = 2.0 * M_PI * rand() / RAND_MAX;
+            const double radius = 0.5 + 1.5 * rand() / RAND_MAX;
+            for (int m = 0; m < 3; m++)
+            {
+                delays[j][m] = (m == 0 ? 0 : true_delay(radius * cos(angle), radius * sin(angle), m));
+                gains[j][m] = ((j == 0) == (m < 2) ? 1.0 : 0.4);
+            }
+        }
+
+        make_frames(3, 2, delays, gains, 0.5);
+
+        int own[3];
+        for (int p = 0; p < 3; p++)
+        {
+            correlate(&corrs[p], pair_a[p], pair_b[p]);
+            own[p] = corrs[p].best_shift;
+        }
+
+        joint_lag_search(&corrs[0], &corrs[1], &corrs[2]);
+
+        for (int p = 0; p < 3; p++)
+        {
+            double psr_q8, height_q15;
+            expected_peak(&corrs[p], &psr_q8, &height_q15);
+
+            moved += (corrs[p].best_shift != own[p]);
+            mismatches += (fabs(corrs[p].peak_to_sidelobe_q8 - psr_q8) > MAX_PSR_ERROR * fabs(psr_q8) + 1.0 ||
+                           fabs(corrs[p].peak_height_q15 - height_q15) > MAX_HEIGHT_ERROR);
+        }
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "ratio and height at the joint shift, %ld of %d pairs moved", moved, 3 * TRIALS);
+    return host_test_report(what, mismatches + (moved == 0), 3 * TRIALS);
+}
+
+// Mean ratio of one source over SNRs, and of independent noise on both
+// mics; each must rank above the one before
+static int check_confidence(void)
+{
+    static const double snrs_db[4] = {-20.0, -10.0, 0.0, 10.0};
+    double previous = -INFINITY;
+    int failed = 0;
+
+    printf("\nSNR    | mean PSR\n");
+    for (int k = -1; k < 4; k++)
+    {
+        double sum = 0.0;
+
+        srand(4000);
+        for (int t = 0; t < TRIALS; t++)
+        {
+            const int delays[1][3] = {{0, rand() % (2 * MAX_SHIFT_AC_SAMPLES + 1) - MAX_SHIFT_AC_SAMPLES, 0}};
+            const double gains[1][3] = {{k < 0 ? 0.0 : 1.0, k < 0 ? 0.0 : 1.0, 0.0}};
+
+            make_frames(2, 1, delays, gains, k < 0 ? 1.0 : pow(10.0, -snrs_db[k] / 20.0));
+            correlate(&corrs[1], 0, 1);
+            sum += corrs[1].peak_to_sidelobe_q8 / 256.0;
+        }
+
+        const double mean = sum / TRIALS;
+        if (k < 0)
+            printf("noise  | %8.2f\n", mean);
+        else
+            printf("%3.0f dB | %8.2f\n", snrs_db[k], mean);
+
+        failed += (mean <= previous);
+        previous = mean;
+    }
+
+    return host_test_report("mean ratio rising with SNR from noise alone", failed, 5);
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    fft_init();
+    microphones_init();
+    joint_lag_search_init();
+    correlations_set_range(&corrs[0], MAX_SHIFT_AB_SAMPLES);
+    correlations_set_range(&corrs[1], MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&corrs[2], MAX_SHIFT_BC_SAMPLES);
+
+    int failed = check_sources();
+    failed |= check_joint();
+    failed |= check_confidence();
+
+    return failed;
+}
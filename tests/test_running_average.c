@@ -0,0 +1,143 @@
+// correlations_average against the same running average in double,
+// est += (new - est) (1 - exp(-dt / tau)), restarting from the frame once
+// dt reaches CORRELATION_AVERAGE_RESET_US. Frames of a source that
+// drifts across the lags arrive at random intervals, now and then after
+// a gap past the reset; after every update the average must stay within
+// MAX_AVERAGE_ERROR of the double one, relative to its peak, and its best
+// shift must be one the double average rates as highly. Then the gap
+// either side of the reset
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+
+#define SEQUENCES 50
+#define FRAMES 400
+
+// Error allowed relative to the peak: the blend weight's interpolation
+// error of up to about 10 Q16 steps, carried over the tau / dt frames the
+// average remembers
+#define MAX_AVERAGE_ERROR 1e-3
+
+static struct correlations_t estimate;
+static struct correlations_t frame;
+static double reference[CORRELATION_BUFFER_SIZE];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+// A peak at centre over noise, scaled to level
+static void make_frame(double centre, double level)
+{
+    for (int s = -frame.max_shift; s <= frame.max_shift; s++)
+    {
+        const double d = (s - centre) / 3.0;
+        frame.correlations[s + MAX_SHIFT_SAMPLES] = (power_t)llround(level * (exp(-d * d) + 0.2 * gaussian()));
+    }
+}
+
+static uint32_t random_dt(void)
+{
+    if (rand() % 40 == 0)
+        return CORRELATION_AVERAGE_RESET_US + rand() % 1000000;
+    return 5000 + rand() % 100000;
+}
+
+static int check_sequences(void)
+{
+    const double tau_us = CORRELATION_AVERAGE_TAU_S * 1e6;
+    long mismatches = 0;
+    double worst = 0.0;
+
+    srand(42);
+    for (int q = 0; q < SEQUENCES; q++)
+    {
+        const double level = ldexp(1.0, 20 + q % 24);
+        double centre = rand() % 21 - 10;
+
+        // The first frame always restarts the average
+        estimate.last_update = host_time_us - CORRELATION_AVERAGE_RESET_US;
+
+        for (int f = 0; f < FRAMES; f++)
+        {
+            const uint32_t dt = (f == 0 ? 0 : random_dt());
+            centre = fmax(-20.0, fmin(20.0, centre + 0.3 * gaussian()));
+            make_frame(centre, level);
+
+            if (f > 0)
+            {
+                estimate.last_update = host_time_us;
+                host_time_us += dt;
+            }
+            correlations_average(&estimate, &frame);
+
+            const double weight = (f == 0 || dt >= CORRELATION_AVERAGE_RESET_US ? 1.0 : 1.0 - exp(-(double)dt / tau_us));
+            double peak = 1.0, best = -INFINITY;
+            for (int s = -frame.max_shift; s <= frame.max_shift; s++)
+            {
+                double *value = &reference[s + MAX_SHIFT_SAMPLES];
+                *value += (frame.correlations[s + MAX_SHIFT_SAMPLES] - *value) * weight;
+                peak = fmax(peak, fabs(*value));
+                best = fmax(best, *value);
+            }
+
+            double error = 0.0;
+            for (int s = -frame.max_shift; s <= frame.max_shift; s++)
+                error = fmax(error, fabs(estimate.correlations[s + MAX_SHIFT_SAMPLES] - reference[s + MAX_SHIFT_SAMPLES]));
+            error /= peak;
+
+            worst = fmax(worst, error);
+            mismatches += (error > MAX_AVERAGE_ERROR ||
+                           reference[estimate.best_shift + MAX_SHIFT_SAMPLES] < best - 2.0 * MAX_AVERAGE_ERROR * peak);
+        }
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "fixed-point average vs double, worst error %.1e of the peak", worst);
+    return host_test_report(what, mismatches, (long)SEQUENCES * FRAMES);
+}
+
+// One microsecond short of the reset still blends; the reset replaces
+static int check_reset(void)
+{
+    long mismatches = 0;
+
+    for (int k = 0; k < 2; k++)
+    {
+        const uint32_t dt = CORRELATION_AVERAGE_RESET_US - 1 + k;
+
+        for (int i = 0; i < CORRELATION_BUFFER_SIZE; i++)
+        {
+            estimate.correlations[i] = 0;
+            frame.correlations[i] = (power_t)1 << 40;
+        }
+
+        estimate.last_update = host_time_us;
+        host_time_us += dt;
+        correlations_average(&estimate, &frame);
+
+        const bool replaced = (estimate.correlations[MAX_SHIFT_SAMPLES] == frame.correlations[MAX_SHIFT_SAMPLES]);
+        mismatches += (replaced != (k == 1));
+    }
+
+    return host_test_report("average blends up to the reset gap and restarts at it", mismatches, 2);
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    correlations_set_range(&estimate, MAX_SHIFT_AC_SAMPLES);
+    correlations_set_range(&frame, MAX_SHIFT_AC_SAMPLES);
+    host_time_us = 10000000;
+
+    int failed = check_sequences();
+    failed |= check_reset();
+
+    return failed;
+}
@@ -0,0 +1,178 @@
+// sign_correlations_init against a per-sample count of agreeing minus
+// differing signs, scaled to coherent_peak, over random spans; identical
+// frames must peak at exactly coherent_peak. Then its accuracy on noisy
+// impulsive events against the full correlation, with and without the
+// clarity gate, over a range of SNRs
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/biquad.h>
+#include <components/sign_correlation.h>
+
+#define COUNT_TRIALS 2000
+#define EVENT_TRIALS 400
+#define FRAME_BITS 10
+#define SOURCE_SAMPLES 4096
+
+static struct buffer_t frame_a;
+static struct buffer_t frame_b;
+static struct sign_buffer_t signs_a;
+static struct sign_buffer_t signs_b;
+static struct correlations_t sign_corr;
+static struct correlations_t full_corr;
+static struct biquad_cascade_t prefilter;
+static double source[SOURCE_SAMPLES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static int check_counts(void)
+{
+    long mismatches = 0;
+    long checks = 0;
+
+    srand(44);
+    for (int t = 0; t < COUNT_TRIALS; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + rand() % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+        const int size = 1 << size_bits;
+        const int start_a = rand() % (size / 2);
+        const int start_b = rand() % (size / 2);
+
+        host_test_frame(&frame_a, size_bits, start_a, start_a + 1 + rand() % (size - start_a), 1000);
+        host_test_frame(&frame_b, size_bits, start_b, start_b + 1 + rand() % (size - start_b), 1000);
+
+        sign_buffer_pack(&signs_a, &frame_a);
+        sign_buffer_pack(&signs_b, &frame_b);
+        correlations_set_range(&sign_corr, MAX_SHIFT_SAMPLES);
+        sign_correlations_init(&sign_corr, &signs_a, &signs_b);
+
+        const power_t span = frame_a.end - frame_a.start;
+        for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++)
+        {
+            power_t agreement = 0;
+            for (int i = frame_a.start; i < frame_a.end; i++)
+            {
+                const int j = i + s;
+                if (j >= frame_b.start && j < frame_b.end)
+                    agreement += ((frame_a.buffer[i] < 0) == (frame_b.buffer[j] < 0) ? 1 : -1);
+            }
+
+            checks++;
+            mismatches += (sign_corr.correlations[s + MAX_SHIFT_SAMPLES] != agreement * sign_corr.coherent_peak / span);
+        }
+
+        // A frame against itself agrees everywhere at lag 0
+        sign_buffer_pack(&signs_b, &frame_a);
+        correlations_set_range(&sign_corr, MAX_SHIFT_SAMPLES);
+        sign_correlations_init(&sign_corr, &signs_a, &signs_b);
+
+        checks++;
+        mismatches += (sign_corr.correlations[MAX_SHIFT_SAMPLES] != sign_corr.coherent_peak);
+    }
+
+    return host_test_report("packed sign counts vs per-sample count", mismatches, checks);
+}
+
+// A decaying noise burst at onset, and at onset + delay in frame b, in
+// white noise scaled for the SNR over the burst
+static void random_event(int delay, double noise)
+{
+    const int onset = 300 + rand() % 200;
+
+    for (int i = 0; i < SOURCE_SAMPLES; i++)
+        source[i] = 0.0;
+    for (int i = 0; i < 300; i++)
+        source[2000 + i] = gaussian() * exp(-i / 60.0);
+
+    host_test_frame(&frame_a, FRAME_BITS, 0, 1 << FRAME_BITS, 0);
+    host_test_frame(&frame_b, FRAME_BITS, 0, 1 << FRAME_BITS, 0);
+    for (int i = 0; i < frame_a.size; i++)
+    {
+        frame_a.buffer[i] = (sample_t)(3000 * (source[2000 - onset + i] + gaussian() * noise));
+        frame_b.buffer[i] = (sample_t)(3000 * (source[2000 - onset + i - delay] + gaussian() * noise));
+    }
+
+    biquad_cascade_reset(&prefilter);
+    biquad_cascade_process(&prefilter, &frame_a);
+    biquad_cascade_reset(&prefilter);
+    biquad_cascade_process(&prefilter, &frame_b);
+
+    if (ONSET_GATED_WINDOW)
+    {
+        const struct buffer_t *const frames[2] = {&frame_a, &frame_b};
+        const int found = buffer_find_onset(frames, 2);
+        buffer_window_onset(&frame_a, found, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+        buffer_window_onset(&frame_b, found, ONSET_PRE_SAMPLES, ONSET_SPAN_SAMPLES);
+    }
+    else
+    {
+        buffer_window(&frame_a);
+        buffer_window(&frame_b);
+    }
+}
+
+static int check_accuracy(void)
+{
+    static const int snrs_db[] = {-12, -6, 0, 6, 12, 24};
+    int failed = 0;
+
+    printf("SNR dB | sign exact | full exact | pass gate | sign exact when passed\n");
+    for (size_t k = 0; k < sizeof(snrs_db) / sizeof(snrs_db[0]); k++)
+    {
+        const double noise = 0.35 * pow(10.0, -snrs_db[k] / 20.0);
+        int sign_exact = 0;
+        int full_exact = 0;
+        int passed = 0;
+        int passed_exact = 0;
+
+        srand(440);
+        for (int t = 0; t < EVENT_TRIALS; t++)
+        {
+            const int delay = rand() % (2 * MAX_SHIFT_AB_SAMPLES - 3) - (MAX_SHIFT_AB_SAMPLES - 2);
+            random_event(delay, noise);
+
+            correlations_set_range(&sign_corr, MAX_SHIFT_AB_SAMPLES);
+            correlations_set_range(&full_corr, MAX_SHIFT_AB_SAMPLES);
+            sign_buffer_pack(&signs_a, &frame_a);
+            sign_buffer_pack(&signs_b, &frame_b);
+            sign_correlations_init(&sign_corr, &signs_a, &signs_b);
+            correlations_init(&full_corr, &frame_a, &frame_b);
+
+            sign_exact += (sign_corr.best_shift == delay);
+            full_exact += (full_corr.best_shift == delay);
+            if (sign_correlations_clear(&sign_corr))
+            {
+                passed++;
+                passed_exact += (sign_corr.best_shift == delay);
+            }
+        }
+
+        // Frames the gate lets through must be no less reliable than the
+        // full correlation is overall
+        const bool ok = (passed_exact * (long)EVENT_TRIALS >= full_exact * (long)passed);
+        printf("%6d | %9.1f%% | %9.1f%% | %8.1f%% | %9.1f%%%s\n", snrs_db[k], 100.0 * sign_exact / EVENT_TRIALS,
+               100.0 * full_exact / EVENT_TRIALS, 100.0 * passed / EVENT_TRIALS,
+               passed ? 100.0 * passed_exact / passed : 0.0, ok ? "" : "  FAILED");
+        failed |= !ok;
+    }
+
+    return failed;
+}
+
+int main(void)
+{
+    correlations_tables_init();
+    biquad_cascade_init_band(&prefilter, PREFILTER_HIGHPASS_HZ, PREFILTER_LOWPASS_HZ);
+
+    int failed = check_counts();
+    failed |= check_accuracy();
+
+    return failed;
+}
@@ -0,0 +1,166 @@
+// The per-frame spectrum cache against correlating each pair on its own:
+// the same best shift and correlations within 1% of the peak for three
+// mics hearing noise at known delays, over every frame length. Then, per
+// frame length, which transforms each path runs for the three pairs and
+// what they cost on the host
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+
+#define FRAMES 300
+#define BENCH_REPETITIONS 300
+
+// Correlation error allowed against the per-pair path, relative to its peak
+#define MAX_CORRELATION_ERROR 0.01
+
+static const int pair_a[3] = {0, 0, 1};
+static const int pair_b[3] = {1, 2, 2};
+static const int max_shifts[3] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+static struct buffer_t frames[3];
+static struct correlations_t cached[3];
+static struct correlations_t paired[3];
+static struct spectra_t spectra;
+static double source[BUFFER_MAX_SIZE + 2 * MAX_SHIFT_SAMPLES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Three mics hear the same noise at delays within every pair's range
+static void make_frames(int size_bits, double level)
+{
+    const int size = 1 << size_bits;
+    const int delays[3] = {0, rand() % 21 - 10, rand() % 21 - 10};
+
+    for (int i = 0; i < size + 2 * MAX_SHIFT_SAMPLES; i++)
+        source[i] = gaussian();
+
+    for (int c = 0; c < 3; c++)
+    {
+        host_test_frame(&frames[c], size_bits, 0, size, 0);
+        for (int i = 0; i < size; i++)
+            frames[c].buffer[i] = clip(level * (source[i + MAX_SHIFT_SAMPLES - delays[c]] + 0.3 * gaussian()));
+        buffer_window(&frames[c]);
+    }
+}
+
+// False when the frames are too long for the cache
+static bool correlate_cached(void)
+{
+    const struct buffer_t *const bufs[3] = {&frames[0], &frames[1], &frames[2]};
+
+    if (!spectra_compute(&spectra, bufs, 3))
+        return false;
+
+    for (int p = 0; p < 3; p++)
+        spectra_correlate(&spectra, pair_a[p], pair_b[p], &cached[p]);
+    return true;
+}
+
+static void correlate_paired(void)
+{
+    for (int p = 0; p < 3; p++)
+        fft_correlations_init(&paired[p], &frames[pair_a[p]], &frames[pair_b[p]]);
+}
+
+static int check_cache(void)
+{
+    long mismatches = 0;
+    long checks = 0;
+    double worst = 0.0;
+
+    for (int t = 0; t < FRAMES; t++)
+    {
+        const int size_bits = BUFFER_MIN_SIZE_BITS + t % (BUFFER_MAX_SIZE_BITS - BUFFER_MIN_SIZE_BITS + 1);
+
+        make_frames(size_bits, t % 3 == 0 ? 500.0 : 6000.0);
+        if (!correlate_cached())
+            continue;
+        correlate_paired();
+        checks += 3;
+
+        for (int p = 0; p < 3; p++)
+        {
+            double peak = 1.0, error = 0.0;
+            for (int s = -max_shifts[p]; s <= max_shifts[p]; s++)
+                peak = fmax(peak, fabs((double)paired[p].correlations[s + MAX_SHIFT_SAMPLES]));
+            for (int s = -max_shifts[p]; s <= max_shifts[p]; s++)
+                error = fmax(error, fabs((double)(cached[p].correlations[s + MAX_SHIFT_SAMPLES] -
+                                                  paired[p].correlations[s + MAX_SHIFT_SAMPLES])) / peak);
+
+            worst = fmax(worst, error);
+            mismatches += (cached[p].best_shift != paired[p].best_shift || error > MAX_CORRELATION_ERROR);
+        }
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "cached spectra vs per-pair, worst error %.4f of the peak", worst);
+    return host_test_report(what, mismatches, checks);
+}
+
+// Per pair: one complex transform of both channels, split, one real
+// inverse. Cached: one complex transform of two channels, one real
+// transform of the third, one real inverse per pair. Frames too long for
+// one transform take the per-pair path in segments
+static void bench(void)
+{
+    printf("\nper frame of three mics, us on the host\n");
+    printf("   n | points | per pair             | us     | cached                       | us     | saved\n");
+    for (int size_bits = BUFFER_MIN_SIZE_BITS; size_bits <= BUFFER_MAX_SIZE_BITS; size_bits++)
+    {
+        const int size = 1 << size_bits;
+
+        make_frames(size_bits, 6000.0);
+
+        clock_t start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlate_paired();
+        const double paired_us = host_test_us(start, BENCH_REPETITIONS);
+
+        if (!correlate_cached())
+        {
+            printf("%4d | %6d | %-20s | %6.1f | %-28s |\n", size, FFT_CORRELATION_MAX_SIZE, "segments", paired_us,
+                   "too long");
+            continue;
+        }
+
+        start = clock();
+        for (int r = 0; r < BENCH_REPETITIONS; r++)
+            correlate_cached();
+        const double cached_us = host_test_us(start, BENCH_REPETITIONS);
+
+        printf("%4d | %6d | %-20s | %6.1f | %-28s | %6.1f | %4.0f%%\n", size, 1 << spectra.size_bits,
+               "3 complex, 3 inverse", paired_us, "1 complex, 1 real, 3 inverse", cached_us,
+               100.0 * (1.0 - cached_us / paired_us));
+    }
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    for (int p = 0; p < 3; p++)
+    {
+        correlations_set_range(&cached[p], max_shifts[p]);
+        correlations_set_range(&paired[p], max_shifts[p]);
+    }
+
+    srand(33);
+    const int failed = check_cache();
+    bench();
+
+    return failed;
+}
@@ -0,0 +1,171 @@
+// Spectral subtraction after learning stationary noise: the SNR gain on
+// a tone in that noise, measured by projecting the frame on the tone, and
+// that a clap reaching two mics keeps its lag: the exact rate over clap
+// levels against the unprocessed frames, which it may trail only by
+// LAG_TOLERANCE points since a transient loses some of its bins too
+
+#include <host_test.h>
+
+#include <math.h>
+
+#include <components/correlations.h>
+#include <components/fft_correlation.h>
+#include <components/spectral_subtraction.h>
+
+#define FRAME_BITS 10
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define LEARN_FRAMES 32
+#define FRAMES 200
+
+// Exact-rate points subtraction may lose against the plain frames
+#define LAG_TOLERANCE 5
+
+// Tone on a whole bin, so the projection separates it exactly
+#define TONE_BIN 61
+
+static struct noise_spectrum_t noise[2];
+static struct buffer_t frames[2];
+static struct buffer_t plain[2];
+static struct correlations_t corr;
+static double source[FRAME_SIZE + 2 * MAX_SHIFT_SAMPLES];
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static sample_t clip(double value)
+{
+    return (sample_t)fmax(INT16_MIN, fmin(INT16_MAX, lrint(value)));
+}
+
+// Stationary background: white noise plus a low rumble and a hum
+static double background(int channel, int i)
+{
+    static double rumble[2];
+    rumble[channel] = 0.95 * rumble[channel] + 0.3 * gaussian();
+    return 600.0 * gaussian() + 1500.0 * rumble[channel] +
+           800.0 * sin(2.0 * M_PI * 120.0 * i / SAMPLE_RATE_HZ + channel);
+}
+
+static void learn(void)
+{
+    for (int c = 0; c < 2; c++)
+    {
+        spectral_subtraction_init(&noise[c]);
+        for (int f = 0; f < LEARN_FRAMES; f++)
+        {
+            host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+            for (int i = 0; i < FRAME_SIZE; i++)
+                frames[c].buffer[i] = clip(background(c, i));
+            spectral_subtraction_learn(&noise[c], &frames[c]);
+        }
+    }
+}
+
+// Tone power and the rest of the power of a frame, by projection
+static double snr_db(const struct buffer_t *buf)
+{
+    double sc = 0.0, ss = 0.0, total = 0.0;
+
+    for (int i = 0; i < FRAME_SIZE; i++)
+    {
+        const double w = 2.0 * M_PI * TONE_BIN * i / FRAME_SIZE;
+        sc += buf->buffer[i] * cos(w);
+        ss += buf->buffer[i] * sin(w);
+        total += (double)buf->buffer[i] * buf->buffer[i];
+    }
+
+    const double tone = 2.0 * (sc * sc + ss * ss) / FRAME_SIZE;
+    return 10.0 * log10(tone / (total - tone));
+}
+
+static int check_tone(void)
+{
+    static const double amplitudes[3] = {300.0, 1000.0, 3000.0};
+    int failed = 0;
+
+    for (int k = 0; k < 3; k++)
+    {
+        double before = 0.0, after = 0.0;
+
+        for (int f = 0; f < FRAMES; f++)
+        {
+            host_test_frame(&frames[0], FRAME_BITS, 0, FRAME_SIZE, 0);
+            for (int i = 0; i < FRAME_SIZE; i++)
+                frames[0].buffer[i] =
+                    clip(background(0, i) + amplitudes[k] * sin(2.0 * M_PI * TONE_BIN * i / FRAME_SIZE + f));
+
+            before += snr_db(&frames[0]) / FRAMES;
+            spectral_subtraction_apply(&noise[0], &frames[0]);
+            after += snr_db(&frames[0]) / FRAMES;
+        }
+
+        char what[96];
+        snprintf(what, sizeof(what), "tone at %5.1f dB SNR: %5.1f dB after subtraction", before, after);
+        failed |= host_test_report(what, after < before + 6.0, 1);
+    }
+
+    return failed;
+}
+
+static int check_lag(void)
+{
+    static const double levels[4] = {8000.0, 3000.0, 1500.0, 800.0};
+    const int range = MAX_SHIFT_AC_SAMPLES - 2;
+    int failed = 0;
+
+    printf("clap peak | exact plain | exact subtracted\n");
+    for (int k = 0; k < 4; k++)
+    {
+        long exact[2] = {0, 0};
+
+        for (int f = 0; f < FRAMES; f++)
+        {
+            const int delay = rand() % (2 * range + 1) - range;
+            const int onset = 200 + rand() % 300;
+
+            for (int i = 0; i < FRAME_SIZE + 2 * MAX_SHIFT_SAMPLES; i++)
+                source[i] = (i >= onset ? levels[k] * gaussian() * exp(-(i - onset) / 150.0) : 0.0);
+
+            for (int c = 0; c < 2; c++)
+            {
+                host_test_frame(&frames[c], FRAME_BITS, 0, FRAME_SIZE, 0);
+                for (int i = 0; i < FRAME_SIZE; i++)
+                    frames[c].buffer[i] = clip(background(c, i) + source[i + MAX_SHIFT_SAMPLES - (c ? delay : 0)]);
+
+                plain[c] = frames[c];
+                spectral_subtraction_apply(&noise[c], &frames[c]);
+                buffer_window(&frames[c]);
+                buffer_window(&plain[c]);
+            }
+
+            fft_correlations_init(&corr, &plain[0], &plain[1]);
+            exact[0] += (corr.best_shift == delay);
+            fft_correlations_init(&corr, &frames[0], &frames[1]);
+            exact[1] += (corr.best_shift == delay);
+        }
+
+        printf("%9.0f | %10.1f%% | %15.1f%%\n", levels[k], 100.0 * exact[0] / FRAMES, 100.0 * exact[1] / FRAMES);
+        failed += (100 * (exact[0] - exact[1]) > LAG_TOLERANCE * FRAMES);
+    }
+
+    return host_test_report("lag kept after subtraction", failed, 4);
+}
+
+int main(void)
+{
+    fft_init();
+    correlations_tables_init();
+    correlations_set_range(&corr, MAX_SHIFT_AC_SAMPLES);
+
+    srand(30);
+    learn();
+
+    int failed = check_tone();
+    failed |= check_lag();
+
+    return failed;
+}
@@ -0,0 +1,143 @@
+// The streaming sums, as each pair reads them out, against a batch
+// recomputation over the same window of a random stream, pushed in
+// blocks of random length, after every push; lags past a pair's range
+// must read zero. With STREAMING_OVERLAP_SAVE the window ends at the last
+// whole hop. Then the cost per sample of a steady stream of blocks
+
+#include <host_test.h>
+
+#include <components/streaming_correlation.h>
+
+#define STREAM_SAMPLES 20000
+#define MAX_PUSH 300
+#define BENCH_REPETITIONS 20
+
+static const int pair_a[STREAMING_PAIRS] = {0, 0, 1};
+static const int pair_b[STREAMING_PAIRS] = {1, 2, 2};
+static const int max_shifts[STREAMING_PAIRS] = {MAX_SHIFT_AB_SAMPLES, MAX_SHIFT_AC_SAMPLES, MAX_SHIFT_BC_SAMPLES};
+
+static sample_t stream[STREAMING_CHANNELS][STREAM_SAMPLES];
+static struct streaming_correlation_t state;
+static struct correlations_t corr;
+
+// Zero before the stream starts, as the history is
+static power_t at(int channel, long t)
+{
+    return (t < 0 ? 0 : stream[channel][t]);
+}
+
+// Products whose later sample arrived in [end - window, end)
+static power_t batch_sum(int pair, int shift, long end)
+{
+    power_t sum = 0;
+
+    for (long t = end - STREAMING_WINDOW_SIZE; t < end; t++)
+    {
+        if (shift >= 0)
+            sum += at(pair_a[pair], t - shift) * at(pair_b[pair], t);
+        else
+            sum += at(pair_a[pair], t) * at(pair_b[pair], t + shift);
+    }
+
+    return sum;
+}
+
+static power_t batch_energy(int channel, long end)
+{
+    power_t energy = 0;
+
+    for (long t = end - STREAMING_WINDOW_SIZE; t < end; t++)
+        energy += at(channel, t) * at(channel, t);
+
+    return energy;
+}
+
+static void push(long from, int count)
+{
+    const sample_t *const blocks[STREAMING_CHANNELS] = {stream[0] + from, stream[1] + from, stream[2] + from};
+    streaming_correlation_push(&state, blocks, count);
+}
+
+static int check_against_batch(void)
+{
+    long mismatches = 0;
+    long checks = 0;
+
+    // Loud, moderate and quiet stretches, with full-scale extremes
+    srand(48);
+    for (int c = 0; c < STREAMING_CHANNELS; c++)
+    {
+        for (int i = 0; i < STREAM_SAMPLES; i++)
+        {
+            static const int peaks[3] = {32768, 3000, 200};
+            stream[c][i] = host_test_sample(peaks[(i / 3000) % 3]);
+        }
+    }
+
+    streaming_correlation_init(&state);
+
+    long pushed = 0;
+    while (pushed + MAX_PUSH <= STREAM_SAMPLES)
+    {
+        const int count = 1 + rand() % MAX_PUSH;
+        push(pushed, count);
+        pushed += count;
+
+        const long end = (STREAMING_OVERLAP_SAVE ? pushed / STREAMING_BLOCK_SIZE * STREAMING_BLOCK_SIZE : pushed);
+
+        for (int p = 0; p < STREAMING_PAIRS; p++)
+        {
+            streaming_correlation_read(&state, p, &corr);
+
+            for (int s = -MAX_SHIFT_SAMPLES; s <= MAX_SHIFT_SAMPLES; s++)
+            {
+                const bool in_range = (s >= -max_shifts[p] && s <= max_shifts[p]);
+
+                checks++;
+                mismatches += (corr.correlations[s + MAX_SHIFT_SAMPLES] != (in_range ? batch_sum(p, s, end) : 0));
+            }
+        }
+
+        for (int c = 0; c < STREAMING_CHANNELS; c++)
+        {
+            checks++;
+            mismatches += (state.energies[c] != batch_energy(c, end));
+        }
+    }
+
+    return host_test_report("streaming vs batch sums", mismatches, checks);
+}
+
+static void bench(void)
+{
+    for (int c = 0; c < STREAMING_CHANNELS; c++)
+        for (int i = 0; i < STREAM_SAMPLES; i++)
+            stream[c][i] = host_test_sample(3000);
+
+    streaming_correlation_init(&state);
+
+    long samples = 0;
+    const clock_t start = clock();
+    for (int r = 0; r < BENCH_REPETITIONS; r++)
+    {
+        for (long i = 0; i + STREAMING_BLOCK_SIZE <= STREAM_SAMPLES; i += STREAMING_BLOCK_SIZE)
+        {
+            push(i, STREAMING_BLOCK_SIZE);
+            samples += STREAMING_BLOCK_SIZE;
+        }
+    }
+
+    printf("blocks of %d, window %d: %.3f us per sample\n", STREAMING_BLOCK_SIZE, STREAMING_WINDOW_SIZE,
+           host_test_us(start, 1) / samples);
+}
+
+int main(void)
+{
+    printf("overlap-save %s\n", STREAMING_OVERLAP_SAVE ? "on" : "off");
+    correlations_tables_init();
+
+    const int failed = check_against_batch();
+    bench();
+
+    return failed;
+}